@@ -8,10 +8,11 @@
 #ifndef FYP_BRIDGE_H
 #define FYP_BRIDGE_H
 
-#define SAMPLES_PER_SECOND 30
+#define VOLUME_UPDATE_BLOCKS 5 //the meter is updated every few blocks of audio (~30 times a second)
 
 #include "../runtime/init_close.h"
 #include "include/midi/modelToMidi.h"
+#include "../midi/winMidiSink.h"
 #include "../interface/nametile.h"
 #include "../interface/vmeter.h"
 #include "../interface/piano.h"
@@ -33,8 +34,7 @@ private:
     shared_ptr<globalState> currentSystemState;
     shared_ptr<boost::thread> timerThread;
     shared_ptr<boost::thread> updateThread;
-    shared_ptr<HMIDISTRM> outHandle;
-    shared_ptr<HANDLE> event;
+    shared_ptr<WinMidiSink> midiOut;
     vector<pair<unsigned int, const PaDeviceInfo*>> devices;
     IntelliJamErr err; //global error codes
     int sampleCounter; //used for updating volume meter
@@ -56,7 +56,7 @@ public:
     //functions to adjust certain GUI components
     void switchPlayer();
     void volumeUpdate(double newVolume);
-    void pianoUpdate(unsigned long *midiEvents, int arrSize, int ppqn, int tempo);
+    void pianoUpdate(const midiEvent &event);
 
     //setters
     void setTiles(NameTile *newUserTile, NameTile *newAiTile);
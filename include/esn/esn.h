@@ -9,6 +9,7 @@
 #define FYP_ESN_H
 
 #include "../Eigen/Dense"
+#include "../Eigen/Sparse"
 #include <string>
 
 using namespace Eigen;
@@ -31,32 +32,26 @@ private:
     //reservoir
     VectorXd reservoir;
 
+    //scratch space for the reservoir pre-activations
+    //allocated once on construction so updates don't touch the heap
+    VectorXd preActivation;
+
+    //scratch space for batched updates, grown to the widest batch seen
+    MatrixXd preActivationBatch;
+
     //weight matrices
     MatrixXd inResWeights;
-    MatrixXd resResWeights;
+    MatrixXd resResWeights; //only used when the reservoir is kept dense
+
+    //the CRJ reservoir only has ~N + 2N/k non-zero connections
+    //so storing it row-major sparse makes the update roughly linear in N
+    bool sparseReservoir;
+    SparseMatrix<double,RowMajor> resResSparse;
 
     //activation functions
     double (*outputActivation)(double);
 
 
-    /**
-     * an auxillary function for reading in a weight matrix from a file and
-     * formatting it into an eigen matrix
-     * @param matrixPath file path to matrix file
-     * @return the weight matrix in an eigen-usable format
-     */
-    MatrixXd readWeightMatrix(string matrixPath);
-
-    /**
-     * an auxillary function for writing an eigen matrix to a file
-     * so I can load it back in at a later date
-     * @param weightMatrix the eigen matrix of weights
-     * @param path the file path to store the matrix at
-     * @return a status code of whether the operation succeeded
-     * 1 = success, 0 = failure
-     */
-    int writeWeightMatrix(string path, MatrixXd weightMatrix);
-
 public:
 
     /**
@@ -70,9 +65,10 @@ public:
      * @param outNeurons number of output neurons
      * @param oAct output activation function
      * @param cost cost function for network
+     * @param sparse whether to store the reservoir-reservoir weights sparsely
      */
     ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeurons,
-        double(*oAct)(double), double(*cost)(VectorXd,VectorXd));
+        double(*oAct)(double), double(*cost)(VectorXd,VectorXd), bool sparse = true);
 
     /**
      * constructor for situation where network weights already found (i.e. run-time)
@@ -82,16 +78,17 @@ public:
      * @param resOut file path to reservoir-output weights
      * @param oAct output activation function
      * @param cost cost function
+     * @param sparse whether to store the reservoir-reservoir weights sparsely
      */
     ESN(string inRes, string resRes, string resOut,
-        double(*oAct)(double), double(*cost)(VectorXd,VectorXd));
+        double(*oAct)(double), double(*cost)(VectorXd,VectorXd), bool sparse = true);
 
 
     /**
      * takes new input and feeds it into the reservoir
      * @param newInput the new input into the network
      */
-    void updateReservoir(VectorXd newInput);
+    void updateReservoir(const Ref<const VectorXd> &newInput);
 
     /**
      * version of updateReservoir for 1D input
@@ -99,12 +96,28 @@ public:
      */
     void updateReservoir(double newInput);
 
+    /**
+     * advances several independent reservoirs at once
+     * each column of states is a reservoir, each column of inputs
+     * is the new input for the reservoir in the same column
+     * @param states the reservoir states (reservoir size x batch size), updated in place
+     * @param inputs the new inputs (input size x batch size)
+     */
+    void updateReservoirs(Ref<MatrixXd> states, const Ref<const MatrixXd> &inputs);
+
     /**
      * generates a set of predictions for the network
-     * @return
+     * @return the (activated) network outputs
      */
     VectorXd predict();
 
+    /**
+     * version of predict which writes into existing storage
+     * rather than allocating a new vector for each prediction
+     * @param outputs where to write the outputs (must have resOutWeights.rows() rows)
+     */
+    void predictInto(Ref<VectorXd> outputs);
+
     /**
      * saves all weight matrices for the network
      * so they can be re-loaded in the future
@@ -120,10 +133,17 @@ public:
 
     /**
      * gets the reservoir-reservoir connection weight matrix
+     * (always dense, regardless of how it is stored internally)
      * @return the reservoir-reservoir weight matrix
      */
     MatrixXd getResRes();
 
+    /**
+     * is the reservoir-reservoir weight matrix stored sparsely?
+     * @return true if the sparse reservoir update is being used
+     */
+    bool isSparse();
+
     /**
      * get the current reservoir activations
      * @return the current reservoir activations
@@ -134,7 +154,7 @@ public:
      * allows the esn reservoir to be set to a new value
      * @param newRes the new reservoir state
      */
-    void setReservoir(VectorXd newRes);
+    void setReservoir(const Ref<const VectorXd> &newRes);
 
     /**
      * reset all reservoir neurons to initial state
@@ -0,0 +1,150 @@
+/**
+ * this file contains a fixed size version of the echo state network
+ * once a network has been tuned and its sizes are known, baking them
+ * in at compile time lets Eigen drop all size checks and dynamic allocation
+ * from the per-sample update
+ * being a template, the whole implementation lives in this header
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_FIXEDESN_H
+#define FYP_FIXEDESN_H
+
+#include "esn.h"
+#include <memory>
+
+/**
+ * echo state network with a compile-time reservoir size N,
+ * input size In and output size Out
+ * the reservoir-reservoir weights are held in a single heap block and viewed
+ * through a fixed size map, as Eigen refuses fixed size objects over 128KB
+ * (a 200 neuron reservoir is already 320KB); every product still has
+ * its sizes known at compile time
+ */
+template<int N, int In, int Out>
+class FixedESN {
+
+public:
+
+    typedef Matrix<double,N,1> reservoir_t;
+    typedef Matrix<double,In,1> input_t;
+    typedef Matrix<double,Out,1> output_t;
+
+private:
+
+    //weight matrices
+    Matrix<double,N,In> inResWeights;
+    MatrixXd resResStorage;
+    Map<const Matrix<double,N,N>> resResWeights;
+    Matrix<double,Out,N> resOutWeights;
+
+    //reservoir, and scratch space for its pre-activations
+    reservoir_t reservoir;
+    reservoir_t preActivation;
+
+    //activation function
+    double (*outputActivation)(double);
+
+public:
+
+    /**
+     * constructor copies the weights out of a (dynamically sized) network
+     * @param echo a network with matching dimensions
+     * @param oAct output activation function
+     */
+    FixedESN(ESN &echo, double(*oAct)(double)) : resResStorage(N,N), resResWeights(resResStorage.data()) {
+
+        MatrixXd inRes = echo.getInRes();
+        MatrixXd resRes = echo.getResRes();
+
+        if(inRes.rows() != N || inRes.cols() != In || resRes.rows() != N || resRes.cols() != N ||
+           echo.resOutWeights.rows() != Out || echo.resOutWeights.cols() != N) {
+            throw "Weight matrix sizes don't match the FixedESN dimensions";
+        }
+
+        inResWeights = inRes;
+        resResStorage = resRes; //same size, so no reallocation and the map stays valid
+        resOutWeights = echo.resOutWeights;
+
+        outputActivation = oAct;
+
+        reservoir.setZero();
+        preActivation.setZero();
+    }
+
+    /**
+     * takes new input and feeds it into the reservoir
+     * @param newInput the new input into the network
+     */
+    void updateReservoir(const input_t &newInput) {
+        preActivation.noalias() = inResWeights * newInput;
+        preActivation.noalias() += resResWeights * reservoir;
+        reservoir = preActivation.array().tanh();
+    }
+
+    /**
+     * version of updateReservoir for 1D input
+     * @param newInput the new input into the network
+     */
+    void updateReservoir(double newInput) {
+        static_assert(In == 1, "1D updates need a network with a single input");
+        preActivation.noalias() = inResWeights * newInput;
+        preActivation.noalias() += resResWeights * reservoir;
+        reservoir = preActivation.array().tanh();
+    }
+
+    /**
+     * generates a set of predictions for the network
+     * @return the (activated) network outputs
+     */
+    output_t predict() {
+        output_t outputs = resOutWeights * reservoir;
+        if(outputActivation != nullptr) {
+            for(int i = 0; i < Out; i++) {
+                outputs(i) = outputActivation(outputs(i));
+            }
+        }
+        return outputs;
+    }
+
+    /**
+     * reset all reservoir neurons to initial state
+     */
+    void resetReservoir() {
+        reservoir.setZero();
+    }
+
+    /**
+     * get the current reservoir activations
+     * @return the current reservoir activations
+     */
+    const reservoir_t &getReservoir() const {
+        return reservoir;
+    }
+
+    //the map points into this object's own storage, so no copying
+    FixedESN(const FixedESN &) = delete;
+    FixedESN &operator=(const FixedESN &) = delete;
+
+    //fixed size Eigen members need aligned allocation
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * factory for a fixed size network from the usual csv weight files
+ * @param inRes file path to input-reservoir weights
+ * @param resRes file path to reservoir-reservoir weights
+ * @param resOut file path to reservoir-output weights
+ * @param oAct output activation function
+ * @return the fixed size network, throws if the files don't match N, In and Out
+ */
+template<int N, int In, int Out>
+shared_ptr<FixedESN<N,In,Out>> loadFixedESN(string inRes, string resRes, string resOut,
+                                            double(*oAct)(double)) {
+    ESN echo(std::move(inRes),std::move(resRes),std::move(resOut),nullptr,nullptr,false);
+
+    //constructed with new rather than make_shared so the aligned operator new is used
+    return shared_ptr<FixedESN<N,In,Out>>(new FixedESN<N,In,Out>(echo,oAct));
+}
+
+#endif //FYP_FIXEDESN_H
@@ -28,49 +28,61 @@ using namespace std;
  */
 class LSTMLayer {
 
+    //the trainer works directly on the packed weights
+    friend class LSTMTrainer;
+
 private:
     VectorXd h; //the hidden state, or the output of the lstm layer
     VectorXd C; //the cell state (represents the memory)
 
+    //the four gates are packed into single matrices, gate blocks in the order i, f, o, g
+    //so one step is two matrix-vector products rather than eight
+    MatrixXd theta_x; //[4H x In] input weights for all gates
+    MatrixXd theta_h; //[4H x H] recurrent weights for all gates
+    VectorXd bias; //[4H] biases for all gates
+
+    //scratch space for the gate pre-activations/activations
+    VectorXd gates;
+
     /**
      * used to randomly initialise a weight matrix
      * separate function written to improve upon
      * Eigen's default random initialisation
      * @param mat the matrix to initialise (by reference)
-     * @param rows the rows of the matrix
-     * @param cols the columns of the matrix
      */
-    void initialiseWeightMatrix(MatrixXd &mat, unsigned int rows, unsigned int cols);
+    void initialiseWeightMatrix(Ref<MatrixXd> mat);
 
     /**
      * used to initialise one of the bias vectors
      * separate function because Eigen's is terrible
      * @param b the vector to be initialised (by reference)
-     * @param rows the rows in the vector (vector so single column)
      */
-    void initialiseBiasVector(VectorXd &b, unsigned int rows);
+    void initialiseBiasVector(Ref<VectorXd> b);
 
 public:
 
     //any component to be trained has to be kept public
 
+    //the per-gate weights are views into the packed matrices above
+    //so they can still be read, written and trained individually
+
     //input weight matrices (to be trained)
-    MatrixXd theta_xi; //weights from network input to input gate
-    MatrixXd theta_xf; //weights from network input to forget gate
-    MatrixXd theta_xo; //weights from network input to output gate
-    MatrixXd theta_xg; //weights from network input to g (used in C calculation)
+    Block<MatrixXd> theta_xi; //weights from network input to input gate
+    Block<MatrixXd> theta_xf; //weights from network input to forget gate
+    Block<MatrixXd> theta_xo; //weights from network input to output gate
+    Block<MatrixXd> theta_xg; //weights from network input to g (used in C calculation)
 
     //recurrent weight matrices (to be trained)
-    MatrixXd theta_hi; //recurrent weights relative to input gate
-    MatrixXd theta_hf; //recurrent weights relative to forget gate
-    MatrixXd theta_ho; //recurrent weights relative to output gate
-    MatrixXd theta_hg; //recurrent weights relative to g (used in C calculation)
+    Block<MatrixXd> theta_hi; //recurrent weights relative to input gate
+    Block<MatrixXd> theta_hf; //recurrent weights relative to forget gate
+    Block<MatrixXd> theta_ho; //recurrent weights relative to output gate
+    Block<MatrixXd> theta_hg; //recurrent weights relative to g (used in C calculation)
 
     //bias vectors (trained)
-    VectorXd bias_i; //bias vector for input gate
-    VectorXd bias_f; //bias vector for forget gate
-    VectorXd bias_o; //bias vector for output gate
-    VectorXd bias_g; //bias vector for g calculation
+    VectorBlock<VectorXd> bias_i; //bias vector for input gate
+    VectorBlock<VectorXd> bias_f; //bias vector for forget gate
+    VectorBlock<VectorXd> bias_o; //bias vector for output gate
+    VectorBlock<VectorXd> bias_g; //bias vector for g calculation
 
     /**
      * used to reinitialise the lstm layer whenever
@@ -85,6 +97,9 @@ public:
      */
     LSTMLayer(unsigned int inputSize, unsigned int hiddenOutputSize);
 
+    //the views point into this layer's own matrices, so no copying
+    LSTMLayer(const LSTMLayer &) = delete;
+    LSTMLayer &operator=(const LSTMLayer &) = delete;
 
     /**
      * function takes a new input to the layer
@@ -92,7 +107,18 @@ public:
      * @param x_t the new input into the hidden layer
      * @return the new hidden state h (also stored internally)
      */
-    VectorXd update(VectorXd x_t);
+    const VectorXd &update(const Ref<const VectorXd> &x_t);
+
+    /**
+     * advances several independent sequences at once, one per column
+     * the layer's own h and C are left alone, so one layer can be shared between threads
+     * @param hs the hidden states (H x batch), updated in place
+     * @param cs the cell states (H x batch), updated in place
+     * @param x_t the new inputs (input size x batch)
+     * @param gateScratch scratch space for the gates (4H x batch)
+     */
+    void updateBatch(Ref<MatrixXd> hs, Ref<MatrixXd> cs, const Ref<const MatrixXd> &x_t,
+                     Ref<MatrixXd> gateScratch) const;
 
 };
 
@@ -102,6 +128,9 @@ public:
  */
 class LSTMNet {
 
+    //the trainer needs the output function
+    friend class LSTMTrainer;
+
 private:
 
     /**
@@ -113,21 +142,6 @@ private:
      */
     void initialiseWeightMatrix(MatrixXd &mat, int rows, int cols);
 
-    /**
-     * function takes a file path
-     * and reads the matrix in that file into an Eigen matrix
-     * @param path the file path
-     * @return the matrix represented in that file
-     */
-    MatrixXd readWeightMatrix(string path);
-
-    /**
-     * file takes an Eigen matrix and writes it to file
-     * @param weightMatrix the matrix to be written
-     * @param path the path to the write the matrix too
-     */
-    void writeWeightMatrix(MatrixXd weightMatrix, string path);
-
     /**
      * takes the raw output from the network
      * and applies an operation element-wise to it
@@ -165,6 +179,7 @@ public:
 
     /**
      * alternative constructor reads in the weight matrices over initialising them
+     * throws if any matrix doesn't match inputSize and hiddenSize
      * @param inputSize the size of the network input
      * @param hiddenSize the size of the hidden output
      * @param outputFun the output function for the network
@@ -186,7 +201,19 @@ public:
      * @param x_t the newly arrived input data
      * @return the new output of the network
      */
-    VectorXd predict(VectorXd x_t);
+    VectorXd predict(const Ref<const VectorXd> &x_t);
+
+    /**
+     * batched version of predict for independent sequences, one per column
+     * the network's own state is left alone, so it can be shared between threads
+     * @param hs the hidden states (H x batch), updated in place
+     * @param cs the cell states (H x batch), updated in place
+     * @param x_t the newly arrived inputs (input size x batch)
+     * @param gateScratch scratch space for the gates (4H x batch)
+     * @param outputs where to write the network outputs (output size x batch)
+     */
+    void predictBatch(Ref<MatrixXd> hs, Ref<MatrixXd> cs, const Ref<const MatrixXd> &x_t,
+                      Ref<MatrixXd> gateScratch, Ref<MatrixXd> outputs) const;
 
 };
 
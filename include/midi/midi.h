@@ -10,12 +10,11 @@
 
 #include <vector>
 #include <fstream>
+#include <cstdint> //uint16_t and uint32_t
 
 //some types i need made easier
 typedef unsigned char byte;
 typedef std::vector<byte> VLQ;
-typedef unsigned __int32 uint32_t;
-typedef unsigned __int16 uint16_t;
 
 const std::vector<byte> MThd = {'M','T','h','d'}; //two types to identify chunk
 const std::vector<byte> MTrk = {'M','T','r','k'};
@@ -0,0 +1,175 @@
+/**
+ * header file for where the system's midi output goes
+ * responses are scheduled by our own clock and sent a message at a time
+ * to a sink, which may play them, keep them in memory or write them to a file
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_MIDISINK_H
+#define FYP_MIDISINK_H
+
+#include "modelToMidi.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <boost/thread/mutex.hpp>
+
+using namespace std;
+
+#define MIDI_SPIN_MS 2 //the last part of the wait for an event is spent spinning, as sleeps overshoot
+
+/**
+ * interface for anything midi messages can be sent to
+ */
+class MidiSink {
+
+private:
+    chrono::steady_clock::time_point created;
+
+protected:
+
+    /**
+     * @return the seconds since the sink was created
+     */
+    double now() const;
+
+public:
+
+    /**
+     * constructor starts the sink's clock
+     */
+    MidiSink();
+
+    virtual ~MidiSink() = default;
+
+    /**
+     * sends a message straight away
+     * @param event the message (its time is when it was due, not when it's sent)
+     * @return false if the message couldn't be sent
+     */
+    virtual bool send(const midiEvent &event) = 0;
+
+    /**
+     * called at the end of each response
+     * @return false if anything went wrong
+     */
+    virtual bool finish();
+};
+
+/**
+ * sink keeps every message in memory, with when it was actually sent
+ */
+class MemoryMidiSink : public MidiSink {
+
+private:
+    vector<midiEvent> sent; //times are seconds since the sink was created
+    mutable boost::mutex sentMutex; //the playback thread sends while others look
+
+public:
+
+    /**
+     * records a message
+     * @param event the message
+     * @return true
+     */
+    bool send(const midiEvent &event) override;
+
+    /**
+     * @return a copy of every message sent so far
+     */
+    vector<midiEvent> events() const;
+
+    /**
+     * forgets every message sent so far
+     */
+    void clear();
+};
+
+/**
+ * sink writes every message to a standard midi file
+ * the file is rewritten at the end of each response, so it always holds the whole session
+ */
+class SmfMidiSink : public MemoryMidiSink {
+
+private:
+    string fileName;
+
+public:
+
+    /**
+     * constructor sets where the file goes, nothing is written until a response finishes
+     * @param fileName the path of the midi file
+     */
+    explicit SmfMidiSink(string fileName);
+
+    /**
+     * writes the file
+     * @return true
+     */
+    bool finish() override;
+};
+
+/**
+ * function called with each message as it is sent
+ * @param event the message
+ * @param userData whatever was given when the hook was set
+ */
+typedef void (*midiHook)(const midiEvent &event, void *userData);
+
+/**
+ * class plays responses into a sink, sending each message when it's due
+ * how late each message was sent is measured, so the scheduling jitter can be seen
+ */
+class MidiPlayer {
+
+private:
+    MidiSink *sink;
+    midiHook hook;
+    void *hookData;
+
+    long sentCount;
+    double totalLateness; //seconds
+    double worstLateness; //seconds
+
+public:
+
+    /**
+     * constructor sets the sink to play into
+     * @param sink where messages go
+     */
+    explicit MidiPlayer(MidiSink *sink);
+
+    /**
+     * sets a function to be called with each message as it is sent (e.g. to update the gui)
+     * @param newHook the function (nullptr to stop calling it)
+     * @param userData passed to the hook on each call
+     */
+    void setEventHook(midiHook newHook, void *userData = nullptr);
+
+    /**
+     * plays a response, only returning once it has finished
+     * if the system stops part way through, all notes are turned off
+     * @param events the messages, in order, timed from the start of the response
+     * @param running the running state of the system
+     * @return false if the sink failed
+     */
+    bool play(const vector<midiEvent> &events, const atomic<bool> &running);
+
+    /**
+     * @return the number of messages sent
+     */
+    long eventsSent() const;
+
+    /**
+     * @return the mean time in seconds messages were sent after they were due
+     */
+    double meanLateness() const;
+
+    /**
+     * @return the longest time in seconds a message was sent after it was due
+     */
+    double maxLateness() const;
+};
+
+#endif //FYP_MIDISINK_H
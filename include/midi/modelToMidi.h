@@ -11,16 +11,32 @@
 #define FYP_ESNTOMIDI_H
 
 #include "midi.h"
-#include <Windows.h>
-#include <mmsystem.h>
 #include "../Eigen/Dense" //data arrives in form of Eigen vectors
 #include <string>
 #include <memory>
+#include <vector>
 
 using namespace std;
 using namespace Eigen;
 
 #define NOTE_OFFSET 9 //the offset between my note convention and that of MIDI
+#define MIDI_PPQN 96 //pulses per quarter note
+#define MIDI_TEMPO 500000 //microseconds per quarter note (120bpm)
+#define MIDI_PROGRAM 0x01 //the instrument responses are played with
+#define MIDI_VELOCITY 0x7F
+
+/**
+ * a single midi message, with when it should be sent
+ */
+struct midiEvent {
+    double time; //seconds from the start of the response
+    byte status;
+    byte data1;
+    byte data2;
+
+    midiEvent(): time(0.0), status(0), data1(0), data2(0){}
+    midiEvent(double t, byte s, byte d1, byte d2): time(t), status(s), data1(d1), data2(d2){}
+};
 
 /**
  * this function takes the model's output
@@ -33,17 +49,20 @@ using namespace Eigen;
 string naiveMidi(VectorXd prediction);
 
 /**
- * an alternate version of naiveMidi to
- * use Microsoft's MIDI API over my own
- * this is due to the severe time lag in
- * using mcisendstring()
- * @param prediction the model prediction
- * @param out the output handle for the midi device
- * @param ppqn pulses per quarter note
- * @param tempo the tempo in microseconds per quarter note
- * @return an array of midi events, 3 longs represent 1 event
+ * turns the model's prediction into timed midi events
+ * a program change comes first, then a note on and note off for each note
+ * silence (0) doesn't get an event, it just moves the time along
+ * @param prediction the model prediction (notes and durations in seconds)
+ * @return the events, in the order they should be sent
+ */
+vector<midiEvent> predictionToEvents(const MatrixXd &prediction);
+
+/**
+ * converts a time into midi ticks
+ * @param seconds the time in seconds
+ * @return the number of ticks at MIDI_PPQN and MIDI_TEMPO
  */
-unsigned long *naiveMidiWin(MatrixXd prediction, HMIDISTRM *out, int *ppqn, int *tempo);
+unsigned int secondsToTicks(double seconds);
 
 
 /**
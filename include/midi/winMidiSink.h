@@ -0,0 +1,49 @@
+/**
+ * header file for playing midi through the Windows midi api
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_WINMIDISINK_H
+#define FYP_WINMIDISINK_H
+
+#include "midiSink.h"
+#include <Windows.h>
+#include <mmsystem.h>
+
+/**
+ * sink plays each message on the default midi device as soon as it's sent
+ * the timing is done by the midi player, so short messages are used rather than a midi stream
+ */
+class WinMidiSink : public MidiSink {
+
+private:
+    HMIDIOUT out;
+    bool opened;
+
+public:
+
+    /**
+     * constructor opens the default midi device, and raises the timer resolution to 1ms
+     * check isOpen() afterwards
+     */
+    WinMidiSink();
+
+    /**
+     * destructor closes the device and restores the timer resolution
+     */
+    ~WinMidiSink() override;
+
+    /**
+     * @return true if the device was opened
+     */
+    bool isOpen() const;
+
+    /**
+     * plays a message
+     * @param event the message
+     * @return false if the device rejected it
+     */
+    bool send(const midiEvent &event) override;
+};
+
+#endif //FYP_WINMIDISINK_H
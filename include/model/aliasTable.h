@@ -0,0 +1,57 @@
+/**
+ * header file for sampling from a fixed discrete distribution
+ * using Vose's alias method
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_ALIASTABLE_H
+#define FYP_ALIASTABLE_H
+
+#include <vector>
+#include <random>
+#include "../random/rng.h"
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * class allows O(1) sampling from a discrete distribution
+ * the table is built once in O(n), after which each sample
+ * is one uniform integer, one uniform real and one comparison
+ */
+class AliasTable {
+
+private:
+    vector<double> prob; //probability of keeping each column
+    vector<int> alias; //where to go if the column isn't kept
+
+public:
+
+    /**
+     * default constructor leaves an empty table, to be assigned later
+     */
+    AliasTable();
+
+    /**
+     * constructor builds the table for a distribution
+     * the weights don't need to be normalised, if they are all zero
+     * every outcome is treated as equally likely
+     * @param weights the (non-negative) weight of each outcome
+     */
+    explicit AliasTable(const Ref<const RowVectorXd> &weights);
+
+    /**
+     * draws a sample from the distribution
+     * @param gen the random stream to use
+     * @return the index of the outcome drawn
+     */
+    int sample(RngStream &gen) const;
+
+    /**
+     * @return the number of outcomes
+     */
+    int size() const;
+};
+
+#endif //FYP_ALIASTABLE_H
@@ -0,0 +1,104 @@
+/**
+ * header file for the nearest codebook vector search
+ * used by both the note and direction models of the fpm
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_CODEBOOKINDEX_H
+#define FYP_CODEBOOKINDEX_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+//codebooks with at least this many vectors are searched with a k-d tree
+//below it one matrix-vector product over the whole codebook is quicker
+#define CODEBOOK_TREE_THRESHOLD 256
+
+/**
+ * class finds the closest codebook vector to a point
+ * the squared norms of the codebook vectors are worked out once, so
+ * ||x-b||^2 = ||x||^2 - 2b.x + ||b||^2 comes down to a single product B^T x
+ * (||x||^2 is the same for every b, so it is dropped)
+ * large codebooks are instead searched with a k-d tree
+ */
+class CodebookIndex {
+
+private:
+
+    /**
+     * a node of the k-d tree, each node holds one codebook vector
+     */
+    struct kdNode {
+        int index; //column of the codebook vector in B
+        int dim; //dimension split on
+        int left; //child node with a smaller value in dim (-1 if none)
+        int right; //child node with a larger value in dim (-1 if none)
+    };
+
+    MatrixXd B; //the codebook vectors, one per column
+    VectorXd norms; //squared norm of each codebook vector
+
+    vector<kdNode> tree; //empty if the linear search is used
+    int root;
+
+    /**
+     * builds the k-d tree over part of the codebook
+     * @param indices the codebook columns still to be placed
+     * @param start the first index in indices for this subtree
+     * @param end one past the last index in indices for this subtree
+     * @return the node index of the subtree root (-1 if empty)
+     */
+    int buildTree(vector<int> &indices, int start, int end);
+
+    /**
+     * searches the k-d tree for the closest codebook vector
+     * @param x the data point
+     * @param node the current node
+     * @param bestIndex the closest codebook vector so far (updated)
+     * @param bestDistance its squared distance to x (updated)
+     */
+    void searchTree(const Ref<const VectorXd> &x, int node, int &bestIndex, double &bestDistance) const;
+
+    /**
+     * one matrix-vector product over the whole codebook
+     * @param x the data point
+     * @return the index in B of the closest codebook vector
+     */
+    int linearSearch(const Ref<const VectorXd> &x) const;
+
+public:
+
+    /**
+     * default constructor leaves an empty index, to be assigned later
+     */
+    CodebookIndex();
+
+    /**
+     * constructor sets up the index for a codebook
+     * @param B a matrix consisting of all the codebook vectors (one per column)
+     * @param treeThreshold use a k-d tree if there are at least this many codebook vectors
+     */
+    explicit CodebookIndex(const MatrixXd &B, long treeThreshold = CODEBOOK_TREE_THRESHOLD);
+
+    /**
+     * finds the closest codebook vector to a point
+     * @param x the data point
+     * @return the index in B of the closest codebook vector (-1 if the codebook is empty)
+     */
+    int nearest(const Ref<const VectorXd> &x) const;
+
+    /**
+     * @return true if the k-d tree is being used
+     */
+    bool usesTree() const;
+
+    /**
+     * @return the codebook vectors
+     */
+    const MatrixXd &codebook() const;
+};
+
+#endif //FYP_CODEBOOKINDEX_H
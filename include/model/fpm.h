@@ -8,84 +8,207 @@
 #define FYP_FPM_H
 
 #include "keyDetect.h"
+#include "codebookIndex.h"
+#include "aliasTable.h"
 #include <random>
+#include <memory>
+#include <boost/thread/mutex.hpp>
+
+//the upwards interval between two notes is always in [0,12)
+#define NUM_UP_INTERVALS 12
+
+//the trained model loaded by the runtime
+//running WEIGHT_CONVERT over these leaves binary twins which are loaded instead
+#define N_NOTE_PATH "matrices/NNote.csv"
+#define B_NOTE_PATH "matrices/BNote.csv"
+#define T_NOTE_PATH "matrices/tNote.csv"
+#define K_NOTE 0.5
+#define T_NOTE 0.4
+#define N_DIR_PATH "matrices/NDir.csv"
+#define B_DIR_PATH "matrices/BDir.csv"
+#define T_DIR_PATH "matrices/tDir.csv"
+#define K_DIR 0.5
+#define T_DIR 1.9
+
 /**
- * class representing the combined fpm model
- * stores all matrices, and all other internal state
+ * the chaos game representation of a sequence, kept up to date one symbol at a time
+ * the map x <- kx + (1-k)t_i is a contraction, so appending a symbol is O(D)
+ * rather than re-running the whole sequence
  */
-class FPM {
+class ChaosState {
 
 private:
+    MatrixXd t; //corners of the hypercube, one column per symbol
+    double k; //the `shrinking' parameter
+    VectorXd x; //the current point
+
+public:
+
     /**
-     * applies the mapping for the chaos representation conversion
-     * @param t_i the corner on the D dimensional hypercube
-     * @param k the `shrinking' parameter
-     * @param x the point on the D dimensional hypercube
-     * @return the mapped point
+     * default constructor leaves an empty state, to be assigned later
      */
-    VectorXd applyMap(VectorXd t_i, double k, VectorXd x);
+    ChaosState();
 
     /**
-     * forms the chaos block representation for a sequence of notes
+     * constructor sets up a state at the centre of the hypercube
      * @param t all corners of the hypercube
      * @param k the `shrinking' parameter
-     * @param S the sequence of notes
      */
-    VectorXd toChaosRep(MatrixXd t, double k, vector<int> S);
+    ChaosState(const MatrixXd &t, double k);
 
     /**
-     * calculates euclidean distance between two vectors
-     * @param x a vector
-     * @param y a vector
-     * @return the euclidean distance
+     * moves the point towards the corner for a new symbol
+     * @param symbol the symbol appended to the sequence
      */
-    double euclideanDistance(VectorXd x, VectorXd y);
+    void append(int symbol);
 
     /**
-     * function finds the closest codebook vector
-     * to point x, and returns the index in B of
-     * the closest codebook vector
-     * @param x the data point x
-     * @param B a matrix consisting of all the codebook vectors
-     * @return the index in B of the closest codebook vector
+     * moves the point back to the centre of the hypercube (the empty sequence)
      */
-    int findClosestCodebook(VectorXd x, MatrixXd B);
+    void reset();
 
     /**
-     * predicts the next note in the sequence s
-     * @param s the sequence of notes
-     * @param B the matrix of codebook vectors
-     * @param N the matrix of distributions
-     * @param t the matrix of D dimensional hypercube parameters
-     * @param k the `shrinking' parameter
+     * @return the chaos representation of the sequence so far
+     */
+    const VectorXd &point() const;
+};
+
+/**
+ * a cost for a candidate response phrase (lower is better)
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the cost of the response
+ */
+typedef double (*phraseCost)(const vector<int> &userPhrase, const vector<int> &response, const string &key);
+
+/**
+ * scores a response on how well each note follows on from the last
+ * using the interval cost from the esn training
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the average interval cost between consecutive notes
+ */
+double intervalPhraseCost(const vector<int> &userPhrase, const vector<int> &response, const string &key);
+
+/**
+ * scores a response on how well it fits the key the user finished in
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the average shortfall from the key profile's best note
+ */
+double keyPhraseCost(const vector<int> &userPhrase, const vector<int> &response, const string &key);
+
+/**
+ * the sum of the interval and key costs
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the combined cost of the response
+ */
+double combinedPhraseCost(const vector<int> &userPhrase, const vector<int> &response, const string &key);
+
+/**
+ * class representing the combined fpm model
+ * stores all matrices, and all other internal state
+ */
+class FPM {
+
+private:
+
+    /**
+     * everything a response phrase is generated from
+     * shared (read only) between all candidates
+     */
+    struct phraseContext {
+        vector<int> userPhrase; //absolute notes played by the user
+        ChaosState noteStart; //note representation of the user's phrase (transposed to C)
+        ChaosState dirStart; //direction representation of the user's phrase
+        string endKey; //key the user finished in
+        int outputLen; //length of the response
+        int prevNote; //last note the user played
+    };
+
+    /**
+     * predicts the next note in the sequence
+     * @param x the chaos representation of the sequence so far
+     * @param generator the random stream to use
      * @return the next note in the sequence
      */
-    int predictNextNote(vector<int> s, MatrixXd B, MatrixXd N, MatrixXd t, double k);
+    int predictNextNote(const VectorXd &x, RngStream &generator) const;
 
     /**
      * predicts the motion of the next note
-     * @param s a sequence of directions (+/-)
-     * @param B the matrix of codebook vectors
-     * @param N the matrix of distributions
-     * @param t the matric of D dimensional hypercube corners
-     * @param k the `shrinking' parameter
+     * @param x the chaos representation of the directions so far
      * @param upInterval the upwards interval
+     * @param generator the random stream to use
      * @return the next direction in the sequence
      */
-    int predictNextDir(vector<int> s, MatrixXd B, MatrixXd N, MatrixXd t, double k, int upInterval);
+    int predictNextDir(const VectorXd &x, int upInterval, RngStream &generator) const;
+
+    /**
+     * does the key detection and transposition on the queued phrase
+     * @return the context for generating responses
+     */
+    phraseContext preparePhrase();
+
+    /**
+     * generates one response phrase, leaving the model untouched
+     * @param context the context from preparePhrase
+     * @param generator the random stream to use
+     * @return the absolute notes of the response
+     */
+    vector<int> generatePhrase(const phraseContext &context, RngStream &generator) const;
 
     /**
-     * reads in a matrix from a csv file
+     * puts a response into the form for returning and clears the state
+     * @param response the absolute notes of the response
+     * @return a matrix of notes and duration
+     */
+    MatrixXd finishPhrase(const vector<int> &response);
+
+    /**
+     * generates candidates until there are none left
+     * @param context the context from preparePhrase
+     * @param cost the cost function for scoring
+     * @param base each candidate's stream is split off this by its index
+     * @param lock protects nextCandidate
+     * @param nextCandidate the next candidate to be generated
+     * @param responses where each candidate is written
+     * @param costs where each candidate's cost is written
+     */
+    void candidateWorker(const phraseContext &context, phraseCost cost, const RngStream &base,
+                         const shared_ptr<boost::mutex> &lock, unsigned int &nextCandidate,
+                         vector<vector<int>> &responses, vector<double> &costs) const;
+
+    /**
+     * precomputes everything needed for sampling from NNote and NDir
+     * called on loading and whenever the temperature changes
+     */
+    void buildSamplers();
+
+    /**
+     * appends a direction to the direction sequence
+     * and keeps its chaos representation up to date
+     * @param direction the new direction (0 down, 1 up)
+     */
+    void pushDirection(int direction);
+
+    /**
+     * reads in a matrix from a csv file (or its binary twin)
      * @param filePath the path to the matrix file
      * @param rows the number of rows
      * @param cols the number of columns
-     * @return the read-in matrix
+     * @return the read-in matrix, throws if it isn't rows x cols
      */
     MatrixXd readInMat(string filePath, int rows, int cols);
 
     //FIELDS
     MatrixXd BNote;
     MatrixXd NNote;
+    MatrixXd NNoteCounts; //NNote before tilting by the temperature
     MatrixXd tNote;
     double kNote;
     double TNote;
@@ -102,7 +225,28 @@ private:
     vector<int> dirSequence;
     int previousNote;
 
-    default_random_engine gen;
+    //chaos representations of the sequences, updated as they grow
+    ChaosState noteChaos;
+    ChaosState dirChaos;
+
+    //key detection on the queued notes, updated as they arrive
+    KeyTracker keyTracker;
+
+    //nearest codebook search for BNote and BDir
+    CodebookIndex noteIndex;
+    CodebookIndex dirIndex;
+
+    //one sampler per note codebook vector
+    vector<AliasTable> noteSamplers;
+
+    //interval penalties exp(-d/TDir) for each upwards interval
+    double dirTilt[NUM_UP_INTERVALS];
+
+    //tilted direction counts per codebook vector (rows) and upwards interval (cols)
+    MatrixXi dirDown;
+    MatrixXi dirTotal;
+
+    RngStream gen;
 
 public:
 
@@ -137,6 +281,24 @@ public:
      */
     MatrixXd combinedPredict();
 
+    /**
+     * generates several candidate responses in parallel and returns the best
+     * every candidate is always generated, each with its own random stream split off by its index,
+     * so the result depends only on the model's stream and the number of candidates, not on the threads
+     * the work (and so the worst case time) grows with the number of candidates, divided between the threads
+     * @param candidates the number of candidates
+     * @param cost the cost function used to score candidates
+     * @param numThreads the number of threads to use (0 means one per core)
+     * @return a matrix of notes and duration
+     */
+    MatrixXd combinedPredict(unsigned int candidates, phraseCost cost = combinedPhraseCost, unsigned int numThreads = 0);
+
+    /**
+     * changes the temperature NNote is tilted by
+     * @param TNote the new temperature
+     */
+    void setNoteTemperature(double TNote);
+
     /**
      * member function wipes the arrays for the next round of prediction etc.
      */
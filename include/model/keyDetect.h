@@ -16,6 +16,9 @@ using namespace Eigen;
 
 const string keys[] =  {"A","A#","B","C","C#","D","D#","E","F","F#","G","G#","Am","A#m","Bm","Cm","C#m","Dm","D#m","Em","Fm","F#m","Gm","G#m"};
 #define NUM_KEYS 12 // only considering major keys (drawback in the system)
+#define NUM_ALL_KEYS 24 // major and minor keys, in the order of keys[]
+#define NUM_PITCH_CLASSES 12
+#define NUM_PITCH_MASKS 4096 // every set of pitch classes, 2^12
 #define MODULATION_PENALTY 2.0
 #define SEGMENT_LENGTH 2.0
 const double majorProfile[] = {5.0, 2.0, 3.5, 2.0, 4.5, 4.0, 2.0, 4.5, 2.0, 3.5, 1.5, 4.0};
@@ -60,7 +63,7 @@ vector<int> transpose(vector<int> sequence, string srcKey, string dstKey);
  * @param keyIndex the key as an integer
  * @return the dot product with the correct key profile
  */
-double getPitchKeyValue(VectorXd notesPresent, int keyIndex);
+double getPitchKeyValue(const VectorXd &notesPresent, int keyIndex);
 
 /**
  * splits a sequence of notes into a series of smaller segments
@@ -68,14 +71,57 @@ double getPitchKeyValue(VectorXd notesPresent, int keyIndex);
  * @param segmentLength the maximum length of a segment
  * @return the segmented sequence
  */
-vector<vector<int>> splitIntoSegments(vector<pair<int,double>> sequence, double segmentLength);
+vector<vector<int>> splitIntoSegments(const vector<pair<int,double>> &sequence, double segmentLength);
 
 /**
  * gets the pitch key values for each key, for each segment
  * @param segments the segmented note sequence
  * @return a pitch key vector for each segment
  */
-vector<VectorXd> getPitchKeyValues(vector<vector<int>> segments);
+vector<VectorXd> getPitchKeyValues(const vector<vector<int>> &segments);
+
+/**
+ * forms the set of pitch classes present in a segment
+ * @param segment the notes in the segment (1-12, 0 is silence)
+ * @return a mask with bit n-1 set if note n is present
+ */
+int pitchClassMask(const vector<int> &segment);
+
+/**
+ * the pitch key value of every key for every set of pitch classes
+ * worked out once on first use, so scoring a segment is one column lookup
+ * @return a NUM_ALL_KEYS x NUM_PITCH_MASKS table (major keys then minor keys)
+ */
+const MatrixXd &pitchKeyTable();
+
+/**
+ * gets the pitch key values for the major keys, for each segment
+ * @param segments the segmented note sequence
+ * @return a NUM_KEYS x segments matrix of pitch key values
+ */
+MatrixXd getPitchKeyMatrix(const vector<vector<int>> &segments);
+
+/**
+ * moves the dynamic programming on by one segment
+ * the best previous key is either the same key or the best other key
+ * less the penalty, so this is O(keys) rather than O(keys^2)
+ * ties go to the lowest key index, as in getBestSums
+ * @param frontier the best sum ending in each key so far
+ * @param pitchKeyVals the pitch key values for the new segment
+ * @param modulationPenalty the penalty given for switching key
+ * @param newFrontier where to write the new best sums
+ * @param backPointers where to write the best previous key for each key
+ */
+void advanceKeyFrontier(const Ref<const VectorXd> &frontier, const Ref<const VectorXd> &pitchKeyVals,
+                        double modulationPenalty, Ref<VectorXd> newFrontier, Ref<VectorXi> backPointers);
+
+/**
+ * finds the best path of keys through a set of segments
+ * @param pitchKeyMatrix the pitch key values (one column per segment)
+ * @param modulationPenalty the penalty given for switching key
+ * @return the best key index (0 based) for each segment
+ */
+vector<int> getBestKeyIndices(const MatrixXd &pitchKeyMatrix, double modulationPenalty);
 
 /**
  * gets the best sums along the paths
@@ -84,14 +130,14 @@ vector<VectorXd> getPitchKeyValues(vector<vector<int>> segments);
  * @param modulationPenalty the penalty given for switching key
  * @return a vector of pairs listing the sum and the best index
  */
-vector<vector<pair<double,int>>> getBestSums(vector<VectorXd> pitchKeyVectors, double modulationPenalty);
+vector<vector<pair<double,int>>> getBestSums(const vector<VectorXd> &pitchKeyVectors, double modulationPenalty);
 
 /**
  * function backtracks in order to retrieve the best path
  * @param bestSums likely the return value from getBestSums
  * @return the string of keys for each segment
  */
-vector<string> getBestPath(vector<vector<pair<double,int>>> bestSums);
+vector<string> getBestPath(const vector<vector<pair<double,int>>> &bestSums);
 
 /**
  * function detects the key of a number of segments within sequence
@@ -100,7 +146,86 @@ vector<string> getBestPath(vector<vector<pair<double,int>>> bestSums);
  * @param modulationPenalty the cost incurred by switching key
  * @return a vector with elements like (startPoint, endPoint, key) for each segment
  */
-vector<pair<pair<int,int>,string>> detectKey(vector<pair<int,double>> sequence,
+vector<pair<pair<int,int>,string>> detectKey(const vector<pair<int,double>> &sequence,
                                              double segmentLength, double modulationPenalty);
 
+/**
+ * class carries out the same key detection as detectKey, but one note at a time
+ * each segment is scored and put through the dynamic programming as soon as it
+ * is complete, so asking for the keys only has the last segment and the
+ * backtracking left to do
+ */
+class KeyTracker {
+
+private:
+    double segmentLength;
+    double modulationPenalty;
+
+    //the most recent note is held back, so it can still be removed
+    bool hasPending;
+    pair<int,double> pending;
+
+    //the segment currently being filled
+    int openMask; //which notes are present (as in pitchClassMask)
+    int openCount; //number of notes in the segment
+    double segmentTime; //total duration of the segment
+
+    //the dynamic programming frontier (best sum ending in each key)
+    VectorXd frontier;
+    vector<VectorXi> backPointers; //best previous key for each key, per segment after the first
+    vector<int> segmentEnds; //one past the last note of each segment
+    int notesCommitted;
+
+    /**
+     * adds a note to the segments, splitting as splitIntoSegments does
+     * @param note the note (1-12, 0 is silence)
+     * @param duration the duration of the note
+     */
+    void commitNote(int note, double duration);
+
+    /**
+     * adds a note to the open segment
+     * @param note the note (1-12, 0 is silence)
+     */
+    void addToSegment(int note);
+
+    /**
+     * scores the open segment and moves the frontier on by one segment
+     */
+    void closeSegment();
+
+public:
+
+    /**
+     * constructor sets up an empty tracker
+     * @param segmentLength the maximum length of a segment
+     * @param modulationPenalty the cost incurred by switching key
+     */
+    explicit KeyTracker(double segmentLength = SEGMENT_LENGTH, double modulationPenalty = MODULATION_PENALTY);
+
+    /**
+     * adds the next note played
+     * @param note the note (1-12, 0 is silence)
+     * @param duration the duration of the note
+     */
+    void addNote(int note, double duration);
+
+    /**
+     * removes the most recently added note (only that one can be removed)
+     * @return true if there was a note to remove
+     */
+    bool removeLastNote();
+
+    /**
+     * gives the keys for the notes so far, the same as detectKey would
+     * @return a vector with elements like (startPoint, endPoint, key) for each segment
+     */
+    vector<pair<pair<int,int>,string>> detect() const;
+
+    /**
+     * empties the tracker for a new phrase
+     */
+    void reset();
+};
+
 #endif //FYP_KEYDETECT_H
@@ -0,0 +1,103 @@
+/**
+ * file contains the random number generation shared by the whole system
+ * every generator is a stream split off one global seed, so
+ * a run can be repeated exactly by fixing that seed
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_RNG_H
+#define FYP_RNG_H
+
+#include <cstdint>
+#include <limits>
+
+//environment variable read for the global seed (a timestamp is used if it isn't set)
+#define RNG_SEED_ENV "INTELLIJAM_SEED"
+
+//the SplitMix64 increment (2^64 / golden ratio)
+#define RNG_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+/**
+ * the SplitMix64 finaliser, mixes all bits of x into all bits of the result
+ * @param x the value to mix
+ * @return the mixed value
+ */
+inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * a counter-based random stream
+ * the n-th number of a stream is mix64(key + n * gamma), so a stream
+ * is just a key and a counter, and splitting off a new stream is just
+ * choosing a new key, with no shared state between streams
+ * can be used anywhere a standard engine can (distributions, shuffle etc.)
+ */
+class RngStream {
+
+private:
+    uint64_t key; //identifies the stream
+    uint64_t counter; //how far along the stream we are
+
+public:
+
+    typedef uint64_t result_type;
+
+    /**
+     * constructor sets up a stream
+     * @param key identifies the stream (i.e. the seed)
+     */
+    explicit RngStream(uint64_t key = 0) : key(mix64(key)), counter(0) {}
+
+    /**
+     * @return the next number in the stream
+     */
+    result_type operator()() {
+        return mix64(key + (++counter) * RNG_GOLDEN_GAMMA);
+    }
+
+    /**
+     * derives an independent stream, e.g. one per thread or per candidate
+     * the same id always gives the same stream, whatever state this stream is in
+     * @param id the id of the new stream
+     * @return the new stream
+     */
+    RngStream split(uint64_t id) const {
+        return RngStream(key ^ mix64(id + RNG_GOLDEN_GAMMA));
+    }
+
+    /**
+     * @param seed restarts the stream from this seed
+     */
+    void seed(uint64_t seed) {
+        key = mix64(seed);
+        counter = 0;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+};
+
+/**
+ * sets the global seed and restarts the numbering of new streams
+ * should be called before any models are built
+ * @param seed the new global seed
+ */
+void setGlobalSeed(uint64_t seed);
+
+/**
+ * @return the global seed (from RNG_SEED_ENV or a timestamp, unless set)
+ */
+uint64_t getGlobalSeed();
+
+/**
+ * gives out the next stream split off the global seed
+ * streams are numbered in the order they are asked for, so two
+ * generators made in the same instant still get different streams
+ * @return a new, independent stream
+ */
+RngStream newRngStream();
+
+#endif //FYP_RNG_H
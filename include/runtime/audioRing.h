@@ -0,0 +1,210 @@
+/**
+ * this file contains the ring buffer shared by everything
+ * which reads the incoming audio
+ * the callback writes each sample once, and every consumer
+ * (update thread, silence timer, meters...) reads it through its own cursor
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_AUDIORING_H
+#define FYP_AUDIORING_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+/**
+ * a single producer, multiple consumer ring of audio samples
+ * the producer never waits for the consumers, it just keeps writing
+ * so a consumer which falls a whole ring behind loses samples,
+ * which its reader detects and counts as an overrun
+ * all positions are absolute sample counts, so they never wrap
+ */
+class AudioRing {
+
+private:
+    vector<float> data; //the samples themselves
+    uint64_t mask; //size - 1, for wrapping positions into the ring
+    atomic<uint64_t> writeIndex; //how many samples have ever been written
+    atomic<uint64_t> claimIndex; //where the write in progress will finish
+
+    //readers can sleep on a semaphore until there's more data
+    //the producer posts it once per sleeping reader, which never blocks
+    void *dataReady; //a HANDLE on Windows, a sem_t elsewhere
+    mutable atomic<int> waiting;
+
+    /**
+     * sleeps on the semaphore until it's posted or the timeout passes
+     * @param timeoutMs the longest to sleep in milliseconds
+     * @return true if the semaphore was posted
+     */
+    bool sleep(long timeoutMs) const;
+
+public:
+
+    /**
+     * constructor allocates the ring
+     * @param size the number of samples held, must be a power of 2
+     */
+    explicit AudioRing(unsigned long size);
+
+    /**
+     * destructor frees the semaphore
+     */
+    ~AudioRing();
+
+    //the semaphore can't be shared between rings
+    AudioRing(const AudioRing &) = delete;
+    AudioRing &operator=(const AudioRing &) = delete;
+
+    /**
+     * writes one channel of interleaved input into the ring
+     * the samples are only made visible to the readers once all are in
+     * should only ever be called by one thread (the audio callback)
+     * @param in the interleaved input (channel 0 is written)
+     * @param frameCount the number of frames in the input
+     * @param stride the number of interleaved channels
+     */
+    void write(const float *in, unsigned long frameCount, int stride);
+
+    /**
+     * @return the number of samples ever written to the ring
+     */
+    uint64_t written() const;
+
+    /**
+     * @return the number of samples the ring holds
+     */
+    unsigned long capacity() const;
+
+    friend class AudioRingReader;
+};
+
+/**
+ * one consumer's view of an AudioRing
+ * each consumer owns its own reader, so readers never contend with
+ * each other or with the producer
+ */
+class AudioRingReader {
+
+private:
+    const AudioRing *ring; //the ring being read
+    uint64_t readIndex; //the next sample to read
+    uint64_t lost; //samples overwritten before they could be read
+
+    /**
+     * skips any samples the producer has already overwritten
+     * @return the number of samples written so far
+     */
+    uint64_t catchUp();
+
+public:
+
+    /**
+     * constructor starts at the oldest sample still held in the ring
+     * @param ring the ring to read
+     */
+    explicit AudioRingReader(const AudioRing &ring);
+
+    /**
+     * @return the number of samples waiting to be read
+     * (never more than the ring holds, anything older has been lost)
+     */
+    unsigned long available() const;
+
+    /**
+     * reads the next samples from the ring
+     * if this reader has fallen behind, the overwritten samples are skipped
+     * and added to the overrun count before reading
+     * @param dst where to copy the samples
+     * @param count the maximum number of samples to read
+     * @return the number of samples read
+     */
+    unsigned long read(float *dst, unsigned long count);
+
+    /**
+     * skips everything currently in the ring, without counting it as lost
+     */
+    void skipToNow();
+
+    /**
+     * sleeps until enough samples are waiting to be read, or until a timeout
+     * @param count the number of samples wanted
+     * @param timeoutMs the longest to wait in milliseconds
+     * @return true if count samples are now waiting
+     */
+    bool wait(unsigned long count, long timeoutMs) const;
+
+    /**
+     * gives direct access to the next samples, without copying them
+     * the samples may wrap around the end of the ring, giving two regions
+     * finishRead must be called once they've been used
+     * @param count the maximum number of samples wanted
+     * @param region1 set to the first region
+     * @param size1 set to the size of the first region
+     * @param region2 set to the second region (if any)
+     * @param size2 set to the size of the second region (0 if none)
+     * @return the number of samples in the two regions
+     */
+    unsigned long readRegions(unsigned long count, const float *&region1, unsigned long &size1,
+                              const float *&region2, unsigned long &size2);
+
+    /**
+     * moves past samples given out by readRegions
+     * @param count the number of samples used
+     * @return how many of them were overwritten while in use (these are counted as overruns)
+     */
+    unsigned long finishRead(unsigned long count);
+
+    /**
+     * @return the total number of samples lost to overruns
+     */
+    uint64_t overruns() const;
+
+    /**
+     * @return the position of the next sample to read (samples written before it)
+     */
+    uint64_t position() const;
+};
+
+/**
+ * the levels of a block of samples, built up by measureBlock
+ */
+struct blockLevel {
+    long count; //samples measured
+    double sumSquares;
+    float peak; //largest absolute value
+    long aboveQuiet; //samples louder than the quiet threshold
+    long aboveLoud; //samples louder than the loud threshold
+
+    //constructor starts with nothing measured
+    blockLevel(): count(0), sumSquares(0.0), peak(0.0f), aboveQuiet(0), aboveLoud(0){}
+
+    //the root mean square of everything measured
+    double rms() const { return count > 0 ? sqrt(sumSquares / count) : 0.0; }
+};
+
+/**
+ * adds some samples to the levels of a block, four at a time with SSE
+ * can be called once per ring region to measure a block which wraps
+ * @param samples the samples
+ * @param count the number of samples
+ * @param quiet the quiet threshold (on the absolute value)
+ * @param loud the loud threshold (on the absolute value)
+ * @param level the levels to add to
+ */
+void measureBlock(const float *samples, long count, float quiet, float loud, blockLevel &level);
+
+/**
+ * copies every stride-th sample into a contiguous buffer
+ * @param dst where to write the samples
+ * @param src the interleaved samples
+ * @param count the number of samples to copy
+ * @param stride the number of interleaved channels
+ */
+void deinterleave(float *dst, const float *src, long count, int stride);
+
+#endif //FYP_AUDIORING_H
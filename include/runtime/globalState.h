@@ -9,12 +9,12 @@
 #define FYP_GLOBALSTATE_H
 
 #include "port_processing.h"
+#include "noteQueue.h"
 #include "../model/fpm.h"
+#include "../midi/midiSink.h"
 #include <memory>
 #include <atomic>
 #include <boost/thread.hpp>
-#include <Windows.h>
-#include <mmsystem.h>
 
 /**
  * a structure to hold the global state of the system
@@ -23,27 +23,19 @@ struct globalState {
 
     shared_ptr<passToCallback> callbackData; //to go to port audio callback function
 
-    shared_ptr<FPM> fpm; //the combined fractal prediction machine model
+    shared_ptr<FPM> fpm; //the combined fractal prediction machine model, only used by the timer thread
+    shared_ptr<NoteQueue> notes; //notes detected by the update thread, waiting to go into the model
 
     PaStream *stream{}; //the port audio stream
 
     shared_ptr<atomic<bool>> running; //the current running state of the system
 
-    shared_ptr<boost::mutex> modelMutex; //for locking access to the prediction model
-    shared_ptr<boost::mutex> streamMutex;
-    shared_ptr<boost::condition_variable_any> cond;
-
-    //for midi output
-    shared_ptr<HMIDISTRM> outHandle;
-    shared_ptr<HANDLE> event;
+    shared_ptr<MidiSink> midiOut; //where responses are played
 
     //constructor for structure just copies everything in
-    globalState(shared_ptr<passToCallback> cd, shared_ptr<FPM> f, PaStream *s,
-                shared_ptr<atomic<bool>> run, shared_ptr<boost::mutex> mMtx,
-                shared_ptr<boost::mutex> sMtx, shared_ptr<boost::condition_variable_any> cv,
-                shared_ptr<HMIDISTRM> oh, shared_ptr<HANDLE> ev):
-            callbackData(cd), fpm(f), stream(s), running(run), modelMutex(mMtx),
-            streamMutex(sMtx), cond(cv), outHandle(oh), event(ev){}
+    globalState(shared_ptr<passToCallback> cd, shared_ptr<FPM> f, shared_ptr<NoteQueue> nq, PaStream *s,
+                shared_ptr<atomic<bool>> run, shared_ptr<MidiSink> mo):
+            callbackData(cd), fpm(f), notes(nq), stream(s), running(run), midiOut(mo){}
 };
 
 #endif //FYP_GLOBALSTATE_H
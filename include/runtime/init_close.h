@@ -11,20 +11,9 @@
 using namespace std;
 
 #define RING_ELEMENT sizeof(float)
-#define RING_SIZE (1048576 / RING_ELEMENT) //1MB ring buffer
+#define RING_SIZE (1048576 / RING_ELEMENT) //1MB ring buffer, shared by every reader
 #define SAMPLE_JUMP 1
 
-#define N_NOTE_PATH "matrices/NNote.csv"
-#define B_NOTE_PATH "matrices/BNote.csv"
-#define T_NOTE_PATH "matrices/tNote.csv"
-#define K_NOTE 0.5
-#define T_NOTE 0.4
-#define N_DIR_PATH "matrices/NDir.csv"
-#define B_DIR_PATH "matrices/BDir.csv"
-#define T_DIR_PATH "matrices/tDir.csv"
-#define K_DIR 0.5
-#define T_DIR 1.9
-
 
 /**
  * this function should be called prior to any calls to initSystem
@@ -39,13 +28,12 @@ pair<PaError, vector<pair<unsigned int, const PaDeviceInfo*>>> preInitSearch();
  * DO NOT call this function before first calling preInitSearch()
  * @param sampleRate the sample rate to be used with the device
  * @param device the device information as well as its portAudio Identifier
- * @param outHandle the output handle for the midi stream
- * @param event handle for notifications from the midi stream
+ * @param midiOut where responses are played
  * @return an error code (if needed), as well as the newly formed system state
  */
 pair<PaError, shared_ptr<globalState>> initSystem(unsigned int sampleRate,
                                                   pair<unsigned int,const PaDeviceInfo*> device,
-                                                  shared_ptr<HMIDISTRM> outHandle, shared_ptr<HANDLE> event);
+                                                  shared_ptr<MidiSink> midiOut);
 
 
 /**
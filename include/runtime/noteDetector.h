@@ -0,0 +1,65 @@
+/**
+ * header file for turning hops of audio into finished notes
+ * this is the work done by the update thread for each hop, kept apart
+ * from the thread itself so it can be run without a live audio stream
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_NOTEDETECTOR_H
+#define FYP_NOTEDETECTOR_H
+
+#include "pitchTracker.h"
+#include "noteMap.h"
+#include "noteQueue.h"
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * class tracks the pitch hop by hop, splits it into notes
+ * and pushes each note onto a queue once it has finished
+ */
+class NoteDetector {
+
+private:
+    PitchTracker tracker;
+    NoteSegmenter segmenter;
+    NoteMap noteMap;
+    NoteQueue *notes; //where finished notes go
+
+public:
+
+    /**
+     * constructor sets up the tracker
+     * @param notes the queue finished notes are pushed onto
+     * @param config the pitch tracker settings
+     */
+    explicit NoteDetector(NoteQueue *notes, const pitchConfig &config = pitchConfig());
+
+    /**
+     * adds the next hop of audio
+     * @param hop hopSize() new samples
+     * @param endSample the position in the audio ring just after the hop
+     * @return the note heard in this hop (0 for silence)
+     */
+    int addHop(const float *hop, uint64_t endSample);
+
+    /**
+     * forgets everything heard so far
+     */
+    void reset();
+
+    /**
+     * @return the number of samples in a hop
+     */
+    int hopSize() const;
+
+    /**
+     * sets a function to be called with the time taken by each hop's pitch estimate
+     * @param hook the function (nullptr to stop timing)
+     * @param userData passed to the hook on each call
+     */
+    void setTimingHook(analysisHook hook, void *userData = nullptr);
+};
+
+#endif //FYP_NOTEDETECTOR_H
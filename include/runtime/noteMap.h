@@ -0,0 +1,67 @@
+/**
+ * header file for turning frequencies into the note numbers used by the models
+ * notes are numbered in semitones from A0, so A2 (55Hz) is note 24
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_NOTEMAP_H
+#define FYP_NOTEMAP_H
+
+#include <utility>
+
+using namespace std;
+
+#define NOTE_REFERENCE_FREQ 55.0 //A2 in Hz
+#define NOTE_REFERENCE 24 //the number of A2
+#define NOTE_LOWEST 24 //lowest note the models know
+#define NOTE_HIGHEST 79 //highest note the models know
+
+/**
+ * class maps a frequency to the closest note within a range
+ * frequencies outside the range are moved by octaves until they're in it
+ * the note is worked out directly from the log of the frequency,
+ * so a mapping costs one log2 however large the range is
+ */
+class NoteMap {
+
+private:
+    double referenceFreq; //frequency of the reference note
+    int reference; //the reference note
+    int lowest; //lowest note which can be returned
+    int highest; //highest note which can be returned
+
+public:
+
+    /**
+     * constructor sets up the tuning and range
+     * throws an exception if the range is less than an octave
+     * @param referenceFreq frequency of the reference note in Hz
+     * @param reference the number of the reference note
+     * @param lowest lowest note which can be returned
+     * @param highest highest note which can be returned
+     */
+    explicit NoteMap(double referenceFreq = NOTE_REFERENCE_FREQ, int reference = NOTE_REFERENCE,
+                     int lowest = NOTE_LOWEST, int highest = NOTE_HIGHEST);
+
+    /**
+     * finds the closest note to a frequency, and how far out it is
+     * @param freq the frequency in Hz
+     * @return the note (0 if freq isn't positive) and the offset of freq from it in cents
+     */
+    pair<int,double> quantise(double freq) const;
+
+    /**
+     * finds the closest note to a frequency
+     * @param freq the frequency in Hz
+     * @return the note, or 0 if freq isn't positive
+     */
+    int closestNote(double freq) const;
+
+    /**
+     * @param note a note number
+     * @return the frequency of the note in Hz
+     */
+    double frequency(int note) const;
+};
+
+#endif //FYP_NOTEMAP_H
@@ -0,0 +1,101 @@
+/**
+ * header file for handing detected notes from the update thread
+ * to the thread which owns the prediction model
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_NOTEQUEUE_H
+#define FYP_NOTEQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+#define NOTE_QUEUE_SIZE 4096 //notes which can be waiting at once, must be a power of 2
+
+/**
+ * a note which has been detected, ready to go into the model
+ */
+struct noteEvent {
+    int note; //the note played (0 for a rest)
+    double duration; //how long it was played for in seconds
+    uint64_t endSample; //position in the audio ring where the note finished
+
+    noteEvent(): note(0), duration(0.0), endSample(0){}
+    noteEvent(int n, double d, uint64_t end = 0): note(n), duration(d), endSample(end){}
+};
+
+/**
+ * a lock free, single producer single consumer queue of notes
+ * the update thread pushes notes as it detects them, and the timer
+ * thread (which owns the model) pops them, so neither ever waits on the other
+ * the two indices are kept on separate cache lines so the threads don't share one
+ */
+class NoteQueue {
+
+private:
+    vector<noteEvent> events;
+    unsigned long mask; //size - 1
+
+    alignas(64) atomic<unsigned long> head; //next slot to pop, only moved by the consumer
+    alignas(64) atomic<unsigned long> tail; //next slot to push, only moved by the producer
+    alignas(64) atomic<unsigned long> dropped; //pushes which found the queue full
+    alignas(64) atomic<uint64_t> heardUpTo; //how far through the audio the producer has got
+
+public:
+
+    /**
+     * constructor allocates the queue
+     * @param size the number of notes which can be waiting, must be a power of 2
+     */
+    explicit NoteQueue(unsigned long size = NOTE_QUEUE_SIZE);
+
+    /**
+     * adds a note to the queue, only to be called by the producer
+     * @param event the note to add
+     * @return false if the queue was full (the note is dropped and counted)
+     */
+    bool push(const noteEvent &event);
+
+    /**
+     * takes the oldest note off the queue, only to be called by the consumer
+     * @param event set to the note taken off
+     * @return false if the queue was empty
+     */
+    bool pop(noteEvent &event);
+
+    /**
+     * takes the oldest note off the queue only if it finished before a point
+     * in the audio, only to be called by the consumer
+     * @param sample the position in the audio ring
+     * @param event set to the note taken off
+     * @return false if the queue was empty or the oldest note finished later
+     */
+    bool popBefore(uint64_t sample, noteEvent &event);
+
+    /**
+     * records that the producer has listened to all the audio before a point
+     * so every note finishing before it has been pushed
+     * @param sample the position in the audio ring
+     */
+    void markHeard(uint64_t sample);
+
+    /**
+     * @return the position in the audio ring the producer has listened up to
+     */
+    uint64_t heard() const;
+
+    /**
+     * @return the number of notes waiting (may be out of date straight away)
+     */
+    unsigned long size() const;
+
+    /**
+     * @return the number of notes dropped because the queue was full
+     */
+    unsigned long droppedCount() const;
+};
+
+#endif //FYP_NOTEQUEUE_H
@@ -0,0 +1,167 @@
+/**
+ * header file for the pitch tracking used by the update thread
+ * pitch is estimated with YIN over overlapping windows, so a new
+ * estimate is available every hop rather than every block
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_PITCHTRACKER_H
+#define FYP_PITCHTRACKER_H
+
+#include "../../include/Eigen/unsupported/Eigen/FFT"
+#include <vector>
+#include <complex>
+#include <utility>
+
+using namespace std;
+
+#define PITCH_WINDOW 2048 //~46ms at 44.1kHz
+#define PITCH_HOP 256 //~6ms at 44.1kHz
+#define PITCH_RATE 44100.0
+#define PITCH_THRESHOLD 0.15 //YIN's absolute threshold
+#define PITCH_MIN_FREQ 50.0
+#define PITCH_MAX_FREQ 2000.0
+#define PITCH_SILENCE_RMS 0.001 //windows quieter than this are silence
+#define PITCH_STABLE_HOPS 4 //hops a new note must last before it's accepted
+
+/**
+ * called after each hop or block is analysed, e.g. to collect timings
+ * @param seconds how long the analysis took
+ * @param userData whatever was passed in with the hook
+ */
+typedef void (*analysisHook)(double seconds, void *userData);
+
+/**
+ * settings for a pitch tracker
+ */
+struct pitchConfig {
+    int windowSize; //samples analysed for each estimate
+    int hopSize; //samples between estimates
+    double sampleRate;
+    double threshold; //lower finds more pitches, but more octave errors
+    double minFreq;
+    double maxFreq;
+    double silenceRms;
+
+    //constructor sets up the defaults
+    pitchConfig(): windowSize(PITCH_WINDOW), hopSize(PITCH_HOP), sampleRate(PITCH_RATE),
+                   threshold(PITCH_THRESHOLD), minFreq(PITCH_MIN_FREQ), maxFreq(PITCH_MAX_FREQ),
+                   silenceRms(PITCH_SILENCE_RMS){}
+};
+
+/**
+ * class estimates the pitch of a stream of audio, one hop at a time
+ * each hop shifts the window along and runs YIN on the whole window,
+ * with the autocorrelation at the heart of YIN done by FFT
+ * all buffers are allocated once, up front
+ */
+class PitchTracker {
+
+private:
+    pitchConfig config;
+
+    int minLag; //shortest period searched for
+    int maxLag; //longest period searched for
+    int span; //samples summed over for each lag
+
+    vector<float> window; //the most recent windowSize samples
+
+    Eigen::FFT<float> fft;
+    vector<float> padded; //the samples going into the fft
+    vector<complex<float>> windowSpec; //spectrum of the whole window
+    vector<complex<float>> spanSpec; //spectrum of the first span samples
+    vector<float> correlation; //cross correlation of the span with the window
+    vector<double> energy; //running sum of squares over the window
+    vector<double> diff; //the cumulative mean normalised difference
+
+    analysisHook hook;
+    void *hookData;
+
+    /**
+     * runs YIN over the current window
+     * @return the estimated frequency in Hz, or 0 if silent/unpitched
+     */
+    double estimate();
+
+public:
+
+    /**
+     * constructor allocates everything the tracker needs
+     * throws an exception if the window can't hold two periods of the lowest frequency
+     * @param config the settings of the tracker
+     */
+    explicit PitchTracker(const pitchConfig &config = pitchConfig());
+
+    /**
+     * moves the window along by a hop and estimates the pitch
+     * @param hop the hopSize newest samples
+     * @return the estimated frequency in Hz, or 0 if silent/unpitched
+     */
+    double addHop(const float *hop);
+
+    /**
+     * clears the window back to silence
+     */
+    void reset();
+
+    /**
+     * @return the number of samples to pass to each addHop
+     */
+    int hopSize() const;
+
+    /**
+     * @return the length of a hop in seconds
+     */
+    double hopDuration() const;
+
+    /**
+     * sets a function to be called with the time taken by each hop
+     * @param newHook the function (nullptr to stop timing)
+     * @param userData passed to the hook on each call
+     */
+    void setTimingHook(analysisHook newHook, void *userData = nullptr);
+};
+
+/**
+ * class turns a note estimate per hop into a sequence of notes with durations
+ * a change of note is only accepted once it has lasted a few hops, so a
+ * short glitch from the tracker doesn't split a note in two
+ */
+class NoteSegmenter {
+
+private:
+    int stableHops; //hops a new note must last before it's accepted
+    int current; //the note being played (-1 if nothing yet)
+    int currentHops; //how long it has been played for
+    int pending; //a possible new note (-1 if none)
+    int pendingHops; //how long the possible new note has lasted
+
+public:
+
+    /**
+     * constructor starts with nothing played
+     * @param stableHops hops a new note must last before it's accepted
+     */
+    explicit NoteSegmenter(int stableHops = PITCH_STABLE_HOPS);
+
+    /**
+     * adds the next estimate
+     * initial silence is ignored, as in the block based version
+     * @param note the note heard in this hop (0 for silence)
+     * @return the note which has just finished and its length in hops, or (-1,0)
+     */
+    pair<int,int> addNote(int note);
+
+    /**
+     * @return hops heard since the last finished note ended
+     * (the current note plus any possible new one)
+     */
+    int currentLength() const;
+
+    /**
+     * forgets everything, as if nothing had been played
+     */
+    void reset();
+};
+
+#endif //FYP_PITCHTRACKER_H
@@ -8,7 +8,7 @@
 #define FYP_PORT_PROCESSING_H
 
 #include "../port_audio/portaudio.h"
-#include "../port_audio/pa_ringbuffer.h"
+#include "audioRing.h"
 #include <vector>
 #include <utility>
 
@@ -17,21 +17,17 @@ using namespace std;
 
 /**
  * a structure used within the callback function
- * contains information about the ring buffer
- * as well as info about the effective sample rate
+ * contains the ring the audio is written to
+ * as well as how the input channels are interleaved
  */
 struct passToCallback {
 
-    PaUtilRingBuffer ringUpdate{}; //ring buffer for updating esn
-    void *ringDataUpdate;
+    AudioRing ring; //written once by the callback, read by the update thread, timer etc.
 
-    PaUtilRingBuffer ringTimer{}; //ring buffer for keeping timer informed
-    void *ringDataTimer;
+    int channelCount; //interleaved channels in the input, only channel 0 is kept
 
-    //copying constructor
-    passToCallback(PaUtilRingBuffer r, void *rd,
-                   PaUtilRingBuffer rt, void *rdt): ringUpdate(r), ringDataUpdate(rd),
-                                                            ringTimer(rt), ringDataTimer(rdt){}
+    //constructor allocates the ring
+    explicit passToCallback(unsigned long ringSize): ring(ringSize), channelCount(2){}
 };
 
 /**
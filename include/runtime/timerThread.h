@@ -23,12 +23,11 @@ void timerWorker(const shared_ptr<globalState> &state, Bridge *bridge);
 
 /**
  * function deals with the output of MIDI in the system
- * @param prediction the fpm prediction/output
- * @param outHandle the output handle for the MIDI stream
- * @param event the event handler for the midi stream
- * @param bridge the bridge to the interface
- * @return any error codes returned from working with the MIDI stream
+ * @param events the midi messages of the response, from predictionToEvents
+ * @param player plays the response into the system's midi sink
+ * @param running the running state of the system
+ * @return any error codes returned from working with the MIDI sink
  */
-int handleMIDI(MatrixXd prediction,shared_ptr<HMIDISTRM> outHandle,shared_ptr<HANDLE> event, Bridge *bridge);
+int handleMIDI(const vector<midiEvent> &events, MidiPlayer &player, const atomic<bool> &running);
 
 #endif //FYP_TIMERTHREAD_H
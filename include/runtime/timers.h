@@ -1,29 +1,324 @@
 /**
- * This header file contains function prototypes
- * for different timing functions judging when to stop
- * input and output a response
+ * This header file contains the turn taking logic
+ * judging when the user has stopped playing, so that
+ * a response should be output
  * Author: Charlie Street
  */
 
 #ifndef FYP_TIMERS_H
 #define FYP_TIMERS_H
 
-#include "../port_audio/pa_ringbuffer.h"
-#include "../bridge/bridge.h"
+#include "audioRing.h"
+#include "noteQueue.h"
+#include "pitchTracker.h"
+#include "../midi/modelToMidi.h"
+#include "../model/fpm.h"
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
 
 #define SAMPLES_TILL_STOP 9000
 #define SILENCE_THRESHOLD 0.0003
 #define NOISE_THRESHOLD 0.01
-#define ANOMALY_MAX 50 //~1/44 of a second
+#define ANOMALY_MAX 50 //loud samples allowed in a quiet block
 #define START_THRESHOLD 1000
+#define RESPONSE_NOISE_THRESHOLD 0.05 //loud threshold while the response plays, above where the mic picks it up
+#define RESPONSE_START_THRESHOLD 3000 //loud samples needed to start over the response (~100ms of playing)
+#define ONSET_DECAY 0.95 //how much of the loud count is kept from block to block over the response
+#define RESPONSE_ECHO_SAMPLES 4410 //how long after a response note ends the mic may still be picking it up
+#define SILENCE_BLOCK 256 //samples looked at in one go (~6ms)
+#define SILENCE_WAIT_MS 20 //longest sleep before checking the system is still running
+#define PHRASE_END_GRACE 4410 //samples after a phrase ends in which its last note may still finish
+#define PHRASE_WAIT_MS 50 //longest wait for the update thread to catch up with the end of a phrase
+
+/**
+ * a note of the response, placed where it will be heard in the audio
+ */
+struct responseNote {
+    int note; //in our note convention, not midi
+    uint64_t start;
+    uint64_t end;
+
+    responseNote(int n, uint64_t s, uint64_t e): note(n), start(s), end(e){}
+};
+
+/**
+ * whose turn it is
+ */
+enum turnState {waitingForUser, userPlaying, responding};
+
+/**
+ * what happened in a block of audio
+ */
+enum turnEvent {noTurnEvent, userStarted, userFinished};
+
+/**
+ * class decides whose turn it is from the levels of the incoming audio
+ * audio keeps coming in while the response is played, so the user can
+ * start their next phrase before the response has finished
+ * all times are sample positions in the audio ring
+ */
+class TurnTaker {
+
+private:
+    turnState state;
+    bool userAhead; //has the user started again during the response?
+    double loudCount; //loud samples heard while waiting for the user
+    long quietCount; //samples of silence since the user last played
+    uint64_t loudSince; //where the loud samples being counted began
+    uint64_t userStart; //where the user's current phrase began
+    uint64_t phraseEnd; //where the last phrase ended
+
+    /**
+     * counts loud samples until the user is judged to have started
+     * over the response, the count fades between blocks and has to reach a higher threshold,
+     * so a short burst of the response through the mic isn't taken as the user
+     * @param level the levels of the block
+     * @param endSample the position just after the block
+     * @return true if the user has started playing
+     */
+    bool listenForStart(const blockLevel &level, uint64_t endSample);
+
+public:
+
+    /**
+     * constructor starts off waiting for the user
+     */
+    TurnTaker();
+
+    /**
+     * moves the state along with the next block of audio
+     * @param level the levels of the block
+     * @param endSample the position just after the block
+     * @return whether the user started or finished a phrase in this block
+     */
+    turnEvent addBlock(const blockLevel &level, uint64_t endSample);
+
+    /**
+     * tells the turn taker the response has finished playing
+     * it goes back to the user, who may already have started
+     */
+    void responseFinished();
+
+    /**
+     * @return the threshold the next block's loud samples should be measured against
+     * (higher while the response plays and the user hasn't started over it)
+     */
+    float loudThreshold() const;
+
+    /**
+     * @return whose turn it is
+     */
+    turnState getState() const;
+
+    /**
+     * @return the position where the user's current (or last) phrase began
+     */
+    uint64_t getUserStart() const;
+
+    /**
+     * @return the position where the user's last phrase ended (where its silence began)
+     */
+    uint64_t getPhraseEnd() const;
+
+    /**
+     * goes back to waiting for the user
+     */
+    void reset();
+};
+
+/**
+ * takes the notes of the user's phrase off the note queue, up to a point in the audio
+ * called while the user plays, so the notes can go into the model as they're heard
+ * a rest before the first note of the phrase isn't part of it, so is dropped
+ * @param notes the queue of detected notes
+ * @param upTo notes finishing before here are taken
+ * @param phrase the notes taken are added to the end of this
+ * @return the number of notes added
+ */
+int takePhraseNotes(NoteQueue &notes, uint64_t upTo, vector<noteEvent> &phrase);
+
+/**
+ * works out where each note of a response will be heard in the audio
+ * @param events the midi messages of the response, timed from its start
+ * @param start where in the audio the response starts playing
+ * @param sampleRate samples of audio per second of response
+ * @return the notes of the response
+ */
+vector<responseNote> placeResponse(const vector<midiEvent> &events, uint64_t start, double sampleRate);
 
 /**
- * a timer based around the silence of the input channel
- * @param ring the ring buffer to be read from
- * @param bridge the bridge to the GUI
- * @param running is the system still active?
+ * once the response has finished, takes everything heard while it played off the note queue
+ * the mic may have picked up the response, so notes which finished before the user started
+ * playing over it, or which finished while the response was playing the same note, are thrown away
+ * the user's notes are added to their phrase
+ * @param notes the queue of detected notes
+ * @param userStart where the user started playing over the response (responseEnd if they didn't)
+ * @param responseEnd where the response finished in the audio
+ * @param response the notes of the response, from placeResponse
+ * @param phrase the user's notes are added to the end of this
+ * @param dropped if not nullptr, the notes thrown away are added to the end of this
+ * @return the number of notes thrown away
  */
-void silenceTimer(PaUtilRingBuffer *ring, Bridge *bridge, shared_ptr<atomic<bool>> running);
+int dropResponseNotes(NoteQueue &notes, uint64_t userStart, uint64_t responseEnd, const vector<responseNote> &response,
+                      vector<noteEvent> &phrase, vector<noteEvent> *dropped = nullptr);
+
+/**
+ * takes the rest of the user's last phrase off the note queue
+ * notes finishing after the phrase are left in the queue for the next one
+ * @param notes the queue of detected notes
+ * @param phraseEnd where the phrase ended in the audio
+ * @param phrase the notes taken while the user played, the rest of the phrase is added to the end
+ * @param running the running state of the system
+ * @return the number of notes in the phrase
+ */
+int collectPhrase(NoteQueue &notes, uint64_t phraseEnd, vector<noteEvent> &phrase, const atomic<bool> &running);
+
+/**
+ * function asked whether the response being played has finished
+ * @param position how far through the audio the timer has got
+ * @param userData whatever was given with the hook
+ * @return true once the response has finished
+ */
+typedef bool (*responseClock)(uint64_t position, void *userData);
+
+/**
+ * function given each response to play, it shouldn't wait for the response to finish
+ * @param events the midi messages of the response, timed from its start
+ * @param start where in the audio the response starts playing
+ * @param userData whatever was given with the hook
+ */
+typedef void (*responseSink)(const vector<midiEvent> &events, uint64_t start, void *userData);
+
+/**
+ * how the last response came about, for measuring the runtime
+ */
+struct turnRecord {
+    uint64_t phraseEnd; //where the user's phrase ended in the audio
+    uint64_t trigger; //where the end of the phrase was noticed
+    int phraseNotes; //notes and rests in the phrase
+    double collectTime; //seconds spent taking the end of the phrase off the queue
+    double predictTime; //seconds spent in the model
+    double readyTime; //seconds from the trigger to the response being handed to the sink
+    MatrixXd output; //the notes and durations of the response
+
+    turnRecord(): phraseEnd(0), trigger(0), phraseNotes(0), collectTime(0.0), predictTime(0.0), readyTime(0.0){}
+};
+
+/**
+ * the timer thread's work for each block of audio, shared by the runtime and the benchmark
+ * it listens to the audio for whose turn it is, gives the user's notes to the model as they're
+ * heard, and asks the model for a response once they've finished
+ * how the response is played, and how the end of it is noticed, are left to the caller
+ */
+class TurnStep {
+
+private:
+    AudioRingReader reader; //the timer's own cursor into the audio
+    TurnTaker turns;
+    NoteQueue *notes; //notes detected by the update thread
+    FPM *model; //nullptr to echo the user's phrase back
+    unsigned int candidates; //phrases generated for each response, the best is played
+    double sampleRate;
+
+    responseClock clock;
+    void *clockData;
+    responseSink sink;
+    void *sinkData;
+    analysisHook timingHook; //told how long the turn taking took for each block
+    void *timingData;
+    vector<noteEvent> *heardLog; //every note taken off the queue, if not nullptr
+
+    blockLevel level; //the levels of the last block
+    vector<noteEvent> phrase; //the user's phrase so far
+    unsigned long inModel; //notes of the phrase already given to the model
+    vector<responseNote> response; //what's being played, so it can be told apart from the user
+    bool answered; //was the last phrase given a response? (an empty one isn't)
+    turnRecord last;
+
+    /**
+     * gives the model any notes of the phrase it hasn't had yet
+     */
+    void feedModel();
+
+    /**
+     * takes the end of the user's phrase off the queue and hands the response to the sink
+     * @param running the running state of the system
+     */
+    void respond(const atomic<bool> &running);
+
+public:
+
+    /**
+     * constructor starts off waiting for the user
+     * @param ring the audio ring, read through the step's own cursor
+     * @param notes the queue of detected notes
+     * @param model the model, only used by this step (nullptr to echo phrases back)
+     * @param sampleRate the sample rate of the audio
+     * @param clock asked whether the response has finished
+     * @param clockData passed to the clock on each call
+     * @param sink given each response to play
+     * @param sinkData passed to the sink on each call
+     */
+    TurnStep(const AudioRing &ring, NoteQueue *notes, FPM *model, double sampleRate,
+             responseClock clock, void *clockData, responseSink sink, void *sinkData);
+
+    /**
+     * sets a function to be called with the time taken by the turn taking for each block
+     * @param hook the function (nullptr to stop timing)
+     * @param userData passed to the hook on each call
+     */
+    void setTimingHook(analysisHook hook, void *userData = nullptr);
+
+    /**
+     * opts in to generating several candidate responses and playing the best
+     * the time taken grows with the number of candidates, divided between the cores
+     * @param count the number of candidates (1, the default, generates a single phrase)
+     */
+    void setCandidates(unsigned int count);
+
+    /**
+     * sets where to keep every note taken off the queue, whether it went to the model or was thrown away
+     * @param heard the notes are added to the end of this (nullptr to stop keeping them)
+     */
+    void setHeardLog(vector<noteEvent> *heard);
+
+    /**
+     * waits for the next block of audio and moves everything along with it
+     * if the response has finished, the turn goes back to the user first
+     * if the user finished a phrase in the block, the response is handed to the sink before returning
+     * @param running the running state of the system
+     * @return what happened in the block (noTurnEvent if no block was ready in time or it was torn)
+     */
+    turnEvent step(const atomic<bool> &running);
+
+    /**
+     * @return the levels of the block read by the last step (nothing measured if no block was ready)
+     */
+    const blockLevel &getLevel() const;
+
+    /**
+     * @return how the last response came about
+     */
+    const turnRecord &getLastTurn() const;
+
+    /**
+     * @return whose turn it is
+     */
+    turnState getState() const;
+
+    /**
+     * @return the position in the audio the step has got to
+     */
+    uint64_t position() const;
 
+    /**
+     * @return the number of samples the step missed because it fell behind
+     */
+    uint64_t overruns() const;
+};
 
 #endif //FYP_TIMERS_H
@@ -0,0 +1,109 @@
+/**
+ * header file for a virtual audio input device
+ * audio from a file is fed to the port audio callback on its own thread
+ * as if it were coming from a real device, so the runtime can be run
+ * and measured without any audio hardware
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_VIRTUALINPUT_H
+#define FYP_VIRTUALINPUT_H
+
+#include "port_processing.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+#define VIRTUAL_FRAMES_PER_BUFFER 512 //a typical host buffer, ~12ms at 44.1kHz
+
+/**
+ * reads a whole wav file into memory
+ * throws an exception if the file can't be read
+ * @param filePath the path of the wav file
+ * @param channels set to the number of interleaved channels
+ * @param sampleRate set to the sample rate of the file
+ * @return the interleaved samples
+ */
+vector<float> readWavFile(const string &filePath, int &channels, int &sampleRate);
+
+/**
+ * class plays interleaved audio into the audio callback a buffer at a time
+ * buffers are sent on a fixed schedule, so the audio arrives at real time
+ * (or a multiple of it) no matter how long the callback takes
+ */
+class VirtualInput {
+
+private:
+    vector<float> samples; //interleaved
+    int channels;
+    double sampleRate;
+    double speed; //1.0 for real time, 2.0 for twice as fast etc.
+    unsigned long framesPerBuffer;
+    passToCallback *callbackData;
+
+    boost::thread feeder;
+    atomic<bool> stopRequested;
+    atomic<bool> done;
+    atomic<uint64_t> framesSent;
+
+    /**
+     * the feeder thread, sends every buffer on schedule then stops
+     */
+    void feed();
+
+public:
+
+    /**
+     * constructor sets up the device, nothing is sent until start is called
+     * throws an exception if the speed isn't positive
+     * @param samples the interleaved audio to play
+     * @param channels the number of interleaved channels
+     * @param sampleRate the sample rate of the audio
+     * @param callbackData the callback data the audio is written through
+     * @param speed how much faster than real time to play the audio
+     * @param framesPerBuffer frames sent to the callback at a time
+     */
+    VirtualInput(vector<float> samples, int channels, double sampleRate, passToCallback *callbackData,
+                 double speed = 1.0, unsigned long framesPerBuffer = VIRTUAL_FRAMES_PER_BUFFER);
+
+    /**
+     * destructor stops the feeder thread if it's still going
+     */
+    ~VirtualInput();
+
+    /**
+     * starts sending audio to the callback
+     */
+    void start();
+
+    /**
+     * stops sending audio and waits for the feeder thread to finish
+     */
+    void stop();
+
+    /**
+     * @return true once all the audio has been sent
+     */
+    bool finished() const;
+
+    /**
+     * @return the number of frames sent so far
+     */
+    uint64_t sent() const;
+
+    /**
+     * @return the total number of frames to send
+     */
+    uint64_t totalFrames() const;
+
+    /**
+     * @return the length of the audio in seconds (at real time)
+     */
+    double duration() const;
+};
+
+#endif //FYP_VIRTUALINPUT_H
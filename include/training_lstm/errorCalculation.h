@@ -9,13 +9,29 @@
 #include "../lstm/lstm.h"
 #include "readTraining.h"
 
+//number of samples evaluated together as matrix columns
+#define ERROR_BATCH_SIZE 32
+
 /**
  * function calculates total error on lstm network
  * over a particular set of samples
  * @param lstm the network being tested
  * @param samples the samples to be used for testing
- * @return the average error over all samples
+ * @return the average error over all samples (0 if there are none)
+ */
+double getError(shared_ptr<LSTMNet> lstm, const training_set_t &samples);
+
+/**
+ * batched, multi-threaded version of getError
+ * samples are run together as matrix columns, with the batches shared out between threads
+ * the network's own state is not touched
+ * @param lstm the network being tested
+ * @param samples the samples to be used for testing
+ * @param batchSize the number of samples run together
+ * @param numThreads the number of threads to use (0 means one per core)
+ * @return the average error over all samples (the same as getError)
  */
-double getError(shared_ptr<LSTMNet> lstm, training_set_t samples);
+double getErrorBatched(shared_ptr<LSTMNet> lstm, const training_set_t &samples,
+                       unsigned int batchSize = ERROR_BATCH_SIZE, unsigned int numThreads = 0);
 
 #endif //FYP_ERRORCALCULATION_H
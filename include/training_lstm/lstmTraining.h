@@ -0,0 +1,194 @@
+/**
+ * file contains the trainer for the lstm network
+ * training uses truncated back propagation through time
+ * with the Adam optimiser, with minibatches split between threads
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_LSTMTRAINING_H
+#define FYP_LSTMTRAINING_H
+
+#include "../lstm/lstm.h"
+#include "readTraining.h"
+#include "../random/rng.h"
+#include <random>
+
+//Adam parameters, values from the original paper
+#define ADAM_BETA_1 0.9
+#define ADAM_BETA_2 0.999
+#define ADAM_EPSILON 1e-8
+
+//default training parameters
+#define DEFAULT_LEARNING_RATE 0.001
+#define DEFAULT_CLIP_NORM 5.0
+#define DEFAULT_BPTT_STEPS 20
+#define DEFAULT_MINIBATCH_SIZE 16
+#define DEFAULT_TRAINING_THREADS 4
+
+/**
+ * squared error cost between a ground truth and a prediction
+ * @param gt the ground truth
+ * @param prediction the network prediction
+ * @return the squared error
+ */
+double squaredErrorCost(VectorXd gt, VectorXd prediction);
+
+/**
+ * gradient of the squared error cost with respect to the raw network output
+ * (for a network with no output function)
+ * @param gt the ground truth
+ * @param rawOutput the network output before any output function
+ * @return the gradient of the cost
+ */
+VectorXd squaredErrorGradient(VectorXd gt, VectorXd rawOutput);
+
+/**
+ * gradient of the cross entropy cost with respect to the raw network output
+ * for a network with a softmax output function
+ * @param gt the ground truth (a distribution)
+ * @param rawOutput the network output before the softmax
+ * @return the gradient of the cost
+ */
+VectorXd softmaxCrossEntropyGradient(VectorXd gt, VectorXd rawOutput);
+
+/**
+ * all settings for a training run
+ */
+struct trainingConfig {
+    unsigned int epochs;
+    unsigned int minibatchSize;
+    unsigned int bpttSteps; //gradients aren't carried back further than this
+    double learningRate;
+    double clipNorm; //the global gradient norm is clipped to this (<= 0 turns clipping off)
+    unsigned int numThreads;
+    unsigned int checkpointEvery; //call saveNetwork every this many epochs (0 = never)
+
+    //gradient of the network's cost function with respect to its raw output
+    VectorXd (*costGradient)(VectorXd,VectorXd);
+
+    //constructor fills in the defaults
+    trainingConfig() : epochs(50), minibatchSize(DEFAULT_MINIBATCH_SIZE), bpttSteps(DEFAULT_BPTT_STEPS),
+                       learningRate(DEFAULT_LEARNING_RATE), clipNorm(DEFAULT_CLIP_NORM),
+                       numThreads(DEFAULT_TRAINING_THREADS), checkpointEvery(1),
+                       costGradient(squaredErrorGradient) {}
+};
+
+/**
+ * gradients for every trained parameter of an lstm network
+ * the layer gradients are packed in the same way as the layer weights
+ */
+struct lstmGradients {
+    MatrixXd theta_x; //[4H x In]
+    MatrixXd theta_h; //[4H x H]
+    VectorXd bias; //[4H]
+    MatrixXd outputWeights; //[Out x H]
+
+    /**
+     * constructor creates zeroed gradients of the right sizes
+     * @param inputSize the network input size
+     * @param hiddenSize the lstm layer size
+     * @param outputSize the network output size
+     */
+    lstmGradients(long inputSize, long hiddenSize, long outputSize) :
+            theta_x(MatrixXd::Zero(4 * hiddenSize, inputSize)),
+            theta_h(MatrixXd::Zero(4 * hiddenSize, hiddenSize)),
+            bias(VectorXd::Zero(4 * hiddenSize)),
+            outputWeights(MatrixXd::Zero(outputSize, hiddenSize)) {}
+
+    /**
+     * adds another set of gradients onto these
+     * @param other the gradients to add
+     */
+    void add(const lstmGradients &other);
+
+    /**
+     * scales all gradients
+     * @param factor the scale factor
+     */
+    void scale(double factor);
+
+    /**
+     * @return the norm of all gradients together
+     */
+    double norm() const;
+};
+
+/**
+ * class trains an lstm network in place
+ * the Adam moments are kept between calls, so a trainer should stay with one network
+ */
+class LSTMTrainer {
+
+private:
+
+    shared_ptr<LSTMNet> lstm;
+    trainingConfig config;
+
+    //Adam first and second moment estimates
+    lstmGradients firstMoment;
+    lstmGradients secondMoment;
+    unsigned long adamSteps;
+
+    /**
+     * runs forward and backward over one shard of samples
+     * @param samples the training set
+     * @param shard the indices of the samples in this shard
+     * @param grads where the (summed) gradients are added
+     * @param loss where the summed cost is added
+     * @param count where the number of predictions made is added
+     */
+    void shardGradients(const training_set_t &samples, vector<unsigned int> shard,
+                        lstmGradients &grads, double &loss, unsigned long &count) const;
+
+    /**
+     * applies one Adam update to the network
+     * @param grads the (averaged, clipped) gradients
+     */
+    void applyAdam(const lstmGradients &grads);
+
+public:
+
+    /**
+     * constructor sets up the trainer
+     * @param lstm the network to train
+     * @param config the training settings
+     */
+    LSTMTrainer(shared_ptr<LSTMNet> lstm, trainingConfig config);
+
+    /**
+     * calculates the average gradient over a set of samples
+     * the minibatch is split between config.numThreads threads
+     * @param samples the training set
+     * @param batch the indices of the samples to use
+     * @param grads where to write the averaged gradients
+     * @return the average cost per prediction over the batch
+     */
+    double computeGradients(const training_set_t &samples, const vector<unsigned int> &batch,
+                            lstmGradients &grads) const;
+
+    /**
+     * carries out a single update of the network on a minibatch
+     * @param samples the training set
+     * @param batch the indices of the samples in the minibatch
+     * @return the average cost per prediction over the minibatch (before the update)
+     */
+    double trainMinibatch(const training_set_t &samples, const vector<unsigned int> &batch);
+
+    /**
+     * carries out one pass over the training set in shuffled minibatches
+     * @param samples the training set
+     * @param gen the random stream used for shuffling
+     * @return the average cost per prediction over the epoch
+     */
+    double trainEpoch(const training_set_t &samples, RngStream &gen);
+
+    /**
+     * trains for config.epochs epochs, reporting the training and validation error
+     * and checkpointing the network through saveNetwork
+     * @param trainingSet the samples to train on
+     * @param validationSet the samples to test on (may be empty)
+     */
+    void train(const training_set_t &trainingSet, const training_set_t &validationSet);
+};
+
+#endif //FYP_LSTMTRAINING_H
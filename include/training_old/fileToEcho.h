@@ -19,6 +19,9 @@ using namespace Eigen;
 typedef pair<VectorXd,VectorXd> training_sample_t;
 typedef vector<training_sample_t> training_set_t;
 
+//how many files are pushed through the reservoir together
+#define BATCH_SIZE 64
+
 
 /**
  * function takes a (mono) wav file, inputs into an echo state network
@@ -39,6 +42,19 @@ VectorXd wavToEcho(ESN echo, const string &filePath, unsigned int sampleJump);
  */
 shared_ptr<training_set_t> formTrainingSet(shared_ptr<ESN> echo, string samplesAndOuts, unsigned int sampleJump);
 
+/**
+ * batched version of formTrainingSet
+ * rather than one file at a time, batchSize files are fed through
+ * the network together, with each reservoir stored as a matrix column
+ * @param echo the echo state network to construct reservoir states from
+ * @param samplesAndOuts a file containing a list of all training files as well as the ground truth values
+ * @param sampleJump represents an artificial decrease in sample rate
+ * @param batchSize how many files to process at once
+ * @return the entire training set, in the same order as samplesAndOuts
+ */
+shared_ptr<training_set_t> formTrainingSetBatched(shared_ptr<ESN> echo, string samplesAndOuts,
+                                                  unsigned int sampleJump, unsigned int batchSize = BATCH_SIZE);
+
 /**
  * this function reads from a csv file
  * and takes the file paths of input samples and ground truth values
@@ -5,6 +5,7 @@
  */
 
 #include "trainNetwork.h"
+#include "../random/rng.h"
 #include <random>
 
 #define MAX_ITERATIONS 100000
@@ -19,7 +20,7 @@
  * @return the new solution
  */
 MatrixXd generateNeighbour(MatrixXd currentSolution,
-                           std::default_random_engine &gen, std::uniform_real_distribution<double> &dis);
+                           RngStream &gen, std::uniform_real_distribution<double> &dis);
 
 /**
  * simultaneously the temperature schedule and the stopping condition for siumulated annealing
@@ -38,7 +39,7 @@ double temperatureSchedule(unsigned int iteration);
  * @return the minimum error found
  */
 double simulatedAnnealing(double (*schedule)(unsigned int),MatrixXd(*neighbour)(MatrixXd,
-                                                                                std::default_random_engine &,
+                                                                                RngStream &,
                                                                                 std::uniform_real_distribution<double> &),
                         shared_ptr<ESN> echo, training_set_t trainingSet);
 
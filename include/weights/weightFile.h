@@ -0,0 +1,168 @@
+/**
+ * this file contains the shared weight matrix storage used by
+ * the ESN, the LSTM and the FPM model
+ * matrices can be stored as csv (human readable, slow to parse)
+ * or in a binary container which can be mapped straight into memory
+ * Author: Charlie Street
+ */
+
+#ifndef FYP_WEIGHTFILE_H
+#define FYP_WEIGHTFILE_H
+
+#include "../Eigen/Dense"
+#include <string>
+#include <cstdint>
+
+using namespace Eigen;
+using namespace std;
+
+#define WEIGHT_FILE_MAGIC "IJWM"
+#define WEIGHT_FILE_VERSION 1
+#define WEIGHT_FILE_ENDIAN_TAG 0x01020304u
+#define WEIGHT_FILE_EXTENSION ".wgt"
+#define WEIGHT_DTYPE_FLOAT64 1
+
+/**
+ * header at the start of every binary weight file
+ * it is 32 bytes long, so the data which follows it stays aligned
+ * the data itself is the matrix in column major order (Eigen's default)
+ */
+struct weightFileHeader {
+    char magic[4]; //always WEIGHT_FILE_MAGIC
+    uint32_t endianTag; //WEIGHT_FILE_ENDIAN_TAG as written by the saving machine
+    uint16_t version;
+    uint16_t dtype;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t checksum; //crc32 of the data section
+    uint32_t sourceSize; //size in bytes of the csv this was converted from (0 if none)
+    uint32_t sourceStamp; //low bits of that csv's modification time, so a stale twin is never loaded
+};
+
+/**
+ * a read-only view of a binary weight file mapped into memory
+ * the matrix is only valid while this object is alive
+ */
+class MappedWeightFile {
+
+private:
+
+    const weightFileHeader *header;
+    const double *data;
+
+    //platform specific handles for the mapping
+    void *fileHandle;
+    void *mapHandle;
+    const void *view;
+    size_t viewSize;
+
+    /**
+     * releases the mapping and any open handles
+     */
+    void unmap();
+
+public:
+
+    /**
+     * maps the file and validates its header and checksum
+     * throws if the file can't be mapped or isn't a valid native-endian weight file
+     * @param path the path to the binary weight file
+     */
+    explicit MappedWeightFile(const string &path);
+
+    /**
+     * destructor removes the mapping
+     */
+    ~MappedWeightFile();
+
+    //the mapping is owned by this object, so no copying
+    MappedWeightFile(const MappedWeightFile &) = delete;
+    MappedWeightFile &operator=(const MappedWeightFile &) = delete;
+
+    /**
+     * gets the mapped matrix, no copy is made
+     * @return the matrix stored in the file
+     */
+    Map<const MatrixXd> matrix() const;
+};
+
+/**
+ * reads a matrix from a csv file (one row per line, values comma separated)
+ * parsing always uses the classic locale, so it doesn't matter where the file was written
+ * throws if the file can't be read, a value is malformed or the rows have different lengths
+ * @param path the path to the csv file
+ * @return the matrix in the file
+ */
+MatrixXd readCsvMatrix(const string &path);
+
+/**
+ * writes a matrix to a csv file with enough digits for every value to read back exactly
+ * @param path the path to write to
+ * @param weightMatrix the matrix to write
+ * @return a status code, 1 = success, 0 = failure
+ */
+int writeCsvMatrix(const string &path, const Ref<const MatrixXd> &weightMatrix);
+
+/**
+ * reads a binary weight file into a new matrix
+ * native files are mapped and copied straight out of the mapping,
+ * files written on a machine of the other endianness are read and byte swapped
+ * throws if the file is missing, malformed or fails its checksum
+ * @param path the path to the binary weight file
+ * @return the matrix in the file
+ */
+MatrixXd readWeightFile(const string &path);
+
+/**
+ * writes a matrix into a binary weight file
+ * @param path the path to write to
+ * @param weightMatrix the matrix to write
+ * @param sourcePath the csv the matrix came from, if the file is its binary twin
+ * @return a status code, 1 = success, 0 = failure
+ */
+int writeWeightFile(const string &path, const Ref<const MatrixXd> &weightMatrix, const string &sourcePath = "");
+
+/**
+ * checks whether a file starts with the binary weight file magic
+ * @param path the path to check
+ * @return true if the file is a binary weight file
+ */
+bool isWeightFile(const string &path);
+
+/**
+ * gets the path of the binary twin of a csv weight file
+ * i.e. the same path with the .csv extension swapped for .wgt
+ * @param path the path to a csv weight file
+ * @return the path of its binary twin
+ */
+string binaryTwinPath(const string &path);
+
+/**
+ * loads a weight matrix from whichever format is available
+ * if the path is a binary weight file it is read directly,
+ * if it has a binary twin made from the csv as it is now, that is read instead,
+ * otherwise the csv is parsed
+ * the twin is judged current from the csv's size and modification time, so loading never reads the csv itself
+ * @param path the path to the weight matrix
+ * @return the weight matrix
+ */
+MatrixXd loadWeightMatrix(const string &path);
+
+/**
+ * loads a weight matrix straight into existing storage, e.g. part of a larger matrix
+ * the format is chosen as above, and binary files are copied straight out of their mapping
+ * throws if the matrix in the file isn't the same shape as the storage
+ * @param path the path to the weight matrix
+ * @param weights where the weights go
+ */
+void loadWeightMatrix(const string &path, Ref<MatrixXd> weights);
+
+/**
+ * saves a weight matrix as csv along with its binary twin
+ * @param path the path of the csv file
+ * @param weightMatrix the matrix to save
+ * @return a status code, 1 = success, 0 = failure
+ */
+int saveWeightMatrix(const string &path, const Ref<const MatrixXd> &weightMatrix);
+
+#endif //FYP_WEIGHTFILE_H
@@ -28,31 +28,18 @@ Bridge::Bridge() {
     err = noError;
     sampleCounter = 0; //used to reduce how many GUI updates we force
 
-    //create the event for midi stream notifications
-    event = make_shared<HANDLE>();
-    *event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if(!(*event)) {
-        err = midiError; //1 = event problem
+    //open the default MIDI device
+    midiOut = make_shared<WinMidiSink>();
+    if(!midiOut->isOpen()) {
+        err = midiError; //1 = midi problem
         return;
     }
 
-    //open the midi stream on the default MIDI device
-    outHandle = make_shared<HMIDISTRM>();
-    unsigned long midiOpenError = 0;
-    midiOpenError = midiStreamOpen(outHandle.get(), (LPUINT)&err, 1, (DWORD)(*event), 0, CALLBACK_EVENT);
-    if(midiOpenError) {
-        err = midiError;
-        CloseHandle(*event);
-        return;
-    }
-    ResetEvent(*event); //event gets notified after opening, clear this
-
     //Initialise portAudio and get devices list
     pair<PaError, vector<pair<unsigned int, const PaDeviceInfo*>>> devicesPaired = preInitSearch();
 
     if(devicesPaired.first != paNoError) {
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
+        midiOut = nullptr; //closes the midi device
         err = portAudioError; //2 = port audio problem
         return;
     }
@@ -98,12 +85,8 @@ void Bridge::closeApp() {
     //Terminate Port Audio
     if(Pa_Terminate() != paNoError) err = portAudioError;
 
-    //Close the MIDI Stream
-    midiStreamClose(*outHandle);
-
-    //Close the Event Handle
-    CloseHandle(*event);
-
+    //Close the MIDI device
+    midiOut = nullptr;
 }
 
 /**
@@ -133,7 +116,7 @@ void Bridge::startApp(string deviceName) {
     //Initialise the System
     pair<PaError, shared_ptr<globalState>> global = initSystem(44100,
                                                                devices.at(static_cast<unsigned int>(deviceNum)),
-                                                               outHandle, event);
+                                                               midiOut);
     if(global.first != paNoError) {
         err = portAudioError;
         return;
@@ -173,7 +156,7 @@ void Bridge::switchPlayer() {
  * @param newVolume the new volume value to be used
  */
 void Bridge::volumeUpdate(double newVolume) {
-    if(sampleCounter != SAMPLES_PER_SECOND) {
+    if(sampleCounter != VOLUME_UPDATE_BLOCKS) {
         sampleCounter++;
     } else {
         sampleCounter = 0;
@@ -182,34 +165,19 @@ void Bridge::volumeUpdate(double newVolume) {
 }
 
 /**
- * function is used to send periodic events to
- * have the keyboard repainted with the right note selected
- * @param events the midi events being played
- * @param arrSize the size of the events array
- * @param ppqn the timebase (pulses per quarter note)
- * @param tempo the midi tempo
+ * function is called as each midi message of a response is played
+ * to have the keyboard repainted with the right note selected
+ * @param event the midi message just sent
  */
-void Bridge::pianoUpdate(unsigned long *events, int arrSize, int ppqn, int tempo) {
+void Bridge::pianoUpdate(const midiEvent &event) {
 
-    //loop round in 3s and mimic the midi events
-    for(int i = 3; i < arrSize; i+=3) {
-
-        //carry out any sleep if necessary
-        auto millisecondsToSleep = static_cast<unsigned long>((((double)events[i] / (double)ppqn) * tempo) / 1000);
-        if(millisecondsToSleep != 0) {
-            boost::this_thread::sleep_for(boost::chrono::milliseconds(millisecondsToSleep));
-        }
-
-        //examine the midi event, and find the appropriate note to set on the keyboard
-        unsigned long event = events[i+2];
-        bool noteOn = (event & 0xFF) == 0x90;
-        if(noteOn) {
-            auto note = (unsigned int)((event & 0xFF00) >> 8); //note is the second byte of the event
-            piano->setNoteOn(note-NOTE_OFFSET);
-        } else {
-            piano->setNoteOff();
-        }
+    if(piano == nullptr) return;
 
+    //find the appropriate note to set on the keyboard
+    if((event.status & 0xF0) == NOTE_ON) {
+        piano->setNoteOn(event.data1-NOTE_OFFSET);
+    } else if((event.status & 0xF0) == NOTE_OFF) {
+        piano->setNoteOff();
     }
 }
 
@@ -8,10 +8,9 @@
 #include <random>
 #include <iostream>
 #include <fstream>
-#include <iomanip>
-#include <limits>
-#include <chrono>
 #include "../../include/esn/esn.h"
+#include "../../include/weights/weightFile.h"
+#include "../../include/random/rng.h"
 
 //either random or zero initial values
 //in network states seem to be reasonable
@@ -24,14 +23,20 @@
  * @param resOut file path to reservoir-output weights
  * @param oAct output activation function
  * @param cost cost function for the network
+ * @param sparse whether to store the reservoir-reservoir weights sparsely
  */
 ESN::ESN(string inRes, string resRes, string resOut,
-         double(*oAct)(double), double(*cost)(VectorXd,VectorXd)) {
+         double(*oAct)(double), double(*cost)(VectorXd,VectorXd), bool sparse) {
 
     //read in the weight matrices
-    inResWeights = readWeightMatrix(move(inRes));
-    resResWeights = readWeightMatrix(move(resRes));
-    resOutWeights = readWeightMatrix(move(resOut));
+    sparseReservoir = sparse;
+    inResWeights = loadWeightMatrix(inRes);
+    if(sparseReservoir) { //the saved matrix is always dense, only keep the non-zero entries
+        resResSparse = loadWeightMatrix(resRes).sparseView();
+    } else {
+        resResWeights = loadWeightMatrix(resRes);
+    }
+    resOutWeights = loadWeightMatrix(resOut);
 
     //set all hyper parameters to -1, we won't be needing them
     //this value at least tells us not to use them
@@ -44,8 +49,10 @@ ESN::ESN(string inRes, string resRes, string resOut,
     numOutputNeurons = -1;
 
     //initialise the reservoir
-    //resResWeights is a square matrix, using rows or cols is fine
-    reservoir = MatrixXd::Constant(resResWeights.cols(),1, INITIAL_RESERVOIR_VALUE);
+    //the reservoir weights are a square matrix, using rows or cols is fine
+    long resSize = (sparseReservoir) ? resResSparse.cols() : resResWeights.cols();
+    reservoir = MatrixXd::Constant(resSize,1, INITIAL_RESERVOIR_VALUE);
+    preActivation = VectorXd::Zero(resSize);
 
     //initialise activation functions
     outputActivation = oAct;
@@ -63,9 +70,10 @@ ESN::ESN(string inRes, string resRes, string resOut,
  * @param outNeurons number of output neurons
  * @param oAct the output activation function
  * @param cost the cost function for the network
+ * @param sparse whether to store the reservoir-reservoir weights sparsely
  */
 ESN::ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeurons,
-         double(*oAct)(double), double(*cost)(VectorXd,VectorXd)){
+         double(*oAct)(double), double(*cost)(VectorXd,VectorXd), bool sparse){
 
     //firstly initialise hyper-parameters
     inResWeight = v;
@@ -76,6 +84,7 @@ ESN::ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeuro
 
     numInputNeurons = inNeurons;
     numOutputNeurons = outNeurons;
+    sparseReservoir = sparse;
 
     //initialise the function pointers
     outputActivation = oAct;
@@ -83,13 +92,13 @@ ESN::ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeuro
 
     //now initialise the reservoir
     reservoir = MatrixXd::Constant(reservoirSize,1,INITIAL_RESERVOIR_VALUE);
+    preActivation = VectorXd::Zero(reservoirSize);
 
     //set-up the weight matrices
 
     inResWeights = MatrixXd::Constant(reservoirSize,numInputNeurons,inResWeight);
     //set +/- signs on these values with an average pseudo-random number generator
-    default_random_engine gen;
-    gen.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count()); //use a timestamp as seed
+    RngStream gen = newRngStream();
     bernoulli_distribution dis(0.5); //make a 'heads or tails' choice from bernoulli distribution with p = 0.5
 
     //efficiency isn't really an issue here, this is a one off operation on the start of a training cycle.
@@ -99,8 +108,8 @@ ESN::ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeuro
         }
     }
 
-    //initially set to all zeroes, and then add the sparse connections in
-    resResWeights = MatrixXd::Zero(reservoirSize,reservoirSize);
+    //collect the sparse connections as (row, col, weight) triplets
+    vector<Triplet<double>> connections;
    /* //first cycle
     for(int i = 0; i < reservoirSize; i++) {
         resResWeights(i,(i+1)%reservoirSize) = resWeight;
@@ -116,95 +125,36 @@ ESN::ESN(double v, double r, double a, int N, int k, int inNeurons, int outNeuro
 
     //the simple cycle reservoir part of the reservoir
     for(int i = 0; i < reservoirSize - 1; i++) { //the 'lower' sub-diagonal
-        resResWeights(i+1,i) = resWeight;
+        connections.emplace_back(i+1,i,resWeight);
     }
-    resResWeights(0,reservoirSize-1) = resWeight; //the 'upper-right corner'
+    connections.emplace_back(0,reservoirSize-1,resWeight); //the 'upper-right corner'
 
     //the jumps for the CRJ
     for(int i = 0; i <= reservoirSize-jumpSize; i += jumpSize) {
-        resResWeights(i,(i+jumpSize) % reservoirSize) = biResWeight;
-        resResWeights((i+jumpSize) % reservoirSize,i) = biResWeight;
+        connections.emplace_back(i,(i+jumpSize) % reservoirSize,biResWeight);
+        connections.emplace_back((i+jumpSize) % reservoirSize,i,biResWeight);
     }
 
-    resOutWeights = MatrixXd::Random(numOutputNeurons,reservoirSize);
-
-}
-
-/**
- * reads csv file into eigen matrix
- * @param matrixPath the path where the matrix is stored
- * @return the new eigen matrix
- */
-MatrixXd ESN::readWeightMatrix(string matrixPath) {
-    vector<vector<double>> temp;
-
-    ifstream matFile(matrixPath);
-    string item;
-
-    vector<double> currentVector;
-
-    //read item by item
-    while(getline(matFile,item,',')) {
-
-        if(!item.compare("\n")) { //exit condition, item only has a newline
-            temp.push_back(currentVector);
-            currentVector.clear();
-            break;
-        }
-
-        if (item.find('\n') != string::npos) { //if we reach a new line
-            temp.push_back(currentVector);
-            currentVector.clear();
-        }
-
-
-        double currentVal = stod(item,nullptr);
-        currentVector.push_back(currentVal);
-
+    //where connections overlap, the later one wins (as it would when writing into a dense matrix)
+    resResSparse.resize(reservoirSize,reservoirSize);
+    resResSparse.setFromTriplets(connections.begin(),connections.end(),
+                                 [](const double &, const double &b) { return b; });
 
+    if(!sparseReservoir) { //dense path, keep the full matrix instead
+        resResWeights = MatrixXd(resResSparse);
+        resResSparse = SparseMatrix<double,RowMajor>();
     }
 
-    //now put into an eigen matrix
-
-    MatrixXd newMat = MatrixXd::Random(temp.size(),temp.at(0).size());
-
-    for (unsigned int i = 0; i < temp.size(); i++) {
-        for (unsigned int j = 0; j < temp.at(0).size(); j++) {
-            newMat(i,j) = temp.at(i).at(j);
+    //output weights get their own stream, so they're reproducible from the global seed too
+    RngStream outGen = newRngStream();
+    uniform_real_distribution<double> outDis(-1.0,1.0); //the same range MatrixXd::Random gave
+    resOutWeights = MatrixXd(numOutputNeurons,reservoirSize);
+    for(int i = 0; i < resOutWeights.rows(); i++) {
+        for(int j = 0; j < resOutWeights.cols(); j++) {
+            resOutWeights(i,j) = outDis(outGen);
         }
     }
 
-    return newMat;
-
-
-}
-
-/**
- * write a matrix to csv file
- * @param path the file path to store matrix at
- * @param weightMatrix the weight matrix to save
- * @return an error code for whether write was successful
- */
-int ESN::writeWeightMatrix(string path, MatrixXd weightMatrix) {
-    //first, open the file
-    ofstream csvFile;
-    csvFile.open(path);
-    for (int i = 0; i < weightMatrix.rows(); i++) {
-        for (int j = 0; j < weightMatrix.cols(); j++) { //we want to retain the level of precision
-            if(!csvFile.is_open()) return 0; //a small level of error checking
-            csvFile << setprecision(numeric_limits<double>::digits10 + 1) << weightMatrix(i,j);
-
-            if(!csvFile.is_open()) return 0;
-            csvFile << ",";
-        }
-        if(!csvFile.is_open()) return 0;
-        csvFile << "\n";
-    }
-
-    csvFile.close();
-
-    return 1;
-
 }
 
 /**
@@ -212,9 +162,9 @@ int ESN::writeWeightMatrix(string path, MatrixXd weightMatrix) {
  */
 void ESN::saveNetwork(){
 
-    int write1 = writeWeightMatrix("inputReservoirWeights.csv", inResWeights);
-    int write2 = writeWeightMatrix("reservoirReservoirWeights.csv", resResWeights);
-    int write3 = writeWeightMatrix("reservoirOutputWeights.csv", resOutWeights);
+    int write1 = saveWeightMatrix("inputReservoirWeights.csv", inResWeights);
+    int write2 = saveWeightMatrix("reservoirReservoirWeights.csv", getResRes());
+    int write3 = saveWeightMatrix("reservoirOutputWeights.csv", resOutWeights);
 
     //why not do a little error checking to prevent something really bad happening...
     if(!(write1 && write2 && write3)) {
@@ -222,7 +172,7 @@ void ESN::saveNetwork(){
         cout << "Input-Reservoir weights:" << endl;
         cout << inResWeights << endl;
         cout << "Reservoir-Reservoir weights:" << endl;
-        cout << resResWeights << endl;
+        cout << getResRes() << endl;
         cout << "Reservoir-Output weights:" << endl;
         cout << resOutWeights << endl;
     }
@@ -230,10 +180,17 @@ void ESN::saveNetwork(){
 
 /**
  * updates ESN reservoir on the arrival of new data
+ * all products are written straight into preallocated storage
  * @param newInput the new input to be fed into the network
  */
-void ESN::updateReservoir(VectorXd newInput) {
-    reservoir = tanh(((inResWeights * newInput) + (resResWeights * reservoir)).array());
+void ESN::updateReservoir(const Ref<const VectorXd> &newInput) {
+    preActivation.noalias() = inResWeights * newInput;
+    if(sparseReservoir) {
+        preActivation.noalias() += resResSparse * reservoir;
+    } else {
+        preActivation.noalias() += resResWeights * reservoir;
+    }
+    reservoir = preActivation.array().tanh();
 }
 
 /**
@@ -241,7 +198,35 @@ void ESN::updateReservoir(VectorXd newInput) {
  * @param newInput the new input to be fed into the network
  */
 void ESN::updateReservoir(double newInput) {
-    reservoir = tanh(((inResWeights * newInput) + (resResWeights * reservoir)).array());
+    preActivation = inResWeights.col(0) * newInput;
+    if(sparseReservoir) {
+        preActivation.noalias() += resResSparse * reservoir;
+    } else {
+        preActivation.noalias() += resResWeights * reservoir;
+    }
+    reservoir = preActivation.array().tanh();
+}
+
+/**
+ * implemented from esn.h
+ * updates a batch of reservoirs stored as columns, so the
+ * update becomes a matrix-matrix product rather than one mat-vec per reservoir
+ * @param states the reservoir states, one per column
+ * @param inputs the new inputs, one per column
+ */
+void ESN::updateReservoirs(Ref<MatrixXd> states, const Ref<const MatrixXd> &inputs) {
+    if(preActivationBatch.cols() < states.cols()) { //only allocates the first time a batch this wide is seen
+        preActivationBatch.resize(reservoir.rows(),states.cols());
+    }
+
+    auto batch = preActivationBatch.leftCols(states.cols());
+    batch.noalias() = inResWeights * inputs;
+    if(sparseReservoir) {
+        batch.noalias() += resResSparse * states;
+    } else {
+        batch.noalias() += resResWeights * states;
+    }
+    states = batch.array().tanh();
 }
 
 /**
@@ -249,15 +234,23 @@ void ESN::updateReservoir(double newInput) {
  * @return the new set of outputs from the readout network
  */
 VectorXd ESN::predict() {
+    VectorXd outputs(resOutWeights.rows());
+    predictInto(outputs);
+    return outputs;
+}
 
-    VectorXd rawOutputs =  resOutWeights * reservoir;
+/**
+ * implemented from esn.h
+ * generates the outputs of the network in place
+ * @param outputs where the outputs are written to
+ */
+void ESN::predictInto(Ref<VectorXd> outputs) {
+    outputs.noalias() = resOutWeights * reservoir;
     if(outputActivation != nullptr) {
-        for (int i = 0; i < rawOutputs.rows(); i++) {
-            rawOutputs(i,0) = outputActivation(rawOutputs(i,0));
+        for (int i = 0; i < outputs.rows(); i++) {
+            outputs(i) = outputActivation(outputs(i));
         }
     }
-
-    return rawOutputs;
 }
 
 /**
@@ -265,7 +258,7 @@ VectorXd ESN::predict() {
  * is all the initial reservoir value
  */
 void ESN::resetReservoir() {
-    reservoir = MatrixXd::Constant(resResWeights.cols(),1, INITIAL_RESERVOIR_VALUE);
+    reservoir.setConstant(INITIAL_RESERVOIR_VALUE);
 }
 
 
@@ -284,9 +277,18 @@ MatrixXd ESN::getInRes() {
  * @return reservoir-reservoir weights
  */
 MatrixXd ESN::getResRes() {
+    if(sparseReservoir) return MatrixXd(resResSparse);
     return resResWeights;
 }
 
+/**
+ * implemented from esn.h
+ * @return true if the reservoir weights are stored sparsely
+ */
+bool ESN::isSparse() {
+    return sparseReservoir;
+}
+
 
 /**
  * implemented from esn.h
@@ -300,6 +302,6 @@ VectorXd ESN::getReservoir() {
  * implemented from esn.h
  * @param newRes the new reservoir
  */
-void ESN::setReservoir(VectorXd newRes) {
-    reservoir = std::move(newRes);
+void ESN::setReservoir(const Ref<const VectorXd> &newRes) {
+    reservoir = newRes; //same size as before, so copied into the existing storage
 }
@@ -12,6 +12,8 @@
 
 #include "../../include/lstm/lstm.h"
 #include "../../include/lstm/auxillary_functions.h"
+#include "../../include/weights/weightFile.h"
+#include "../../include/random/rng.h"
 
 
 //****LSTMLayer Functions****
@@ -20,22 +22,18 @@
  * implemented from lstm.h
  * randomly initialises weight matrix (by reference)
  * @param mat the matrix to be initialised
- * @param rows the number of rows in the matrix
- * @param cols the number of columns in the matric
  */
-void LSTMLayer::initialiseWeightMatrix(MatrixXd &mat, unsigned int rows, unsigned int cols) {
-    mat = MatrixXd::Zero(rows,cols);
+void LSTMLayer::initialiseWeightMatrix(Ref<MatrixXd> mat) {
 
-    //initialise random generator with seed based on timestamp
-    std::default_random_engine generator;
-    generator.seed((unsigned int)chrono::system_clock::now().time_since_epoch().count());
+    //each matrix gets its own stream
+    RngStream generator = newRngStream();
 
     //create a normal distribution for initialisation
     std::normal_distribution<double> distribution(0.0,INITIAL_STD_DEV);
 
     //randomly initialise each matrix item
-    for(int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
+    for(int i = 0; i < mat.rows(); i++) {
+        for (int j = 0; j < mat.cols(); j++) {
             mat(i,j) = distribution(generator);
         }
     }
@@ -46,24 +44,18 @@ void LSTMLayer::initialiseWeightMatrix(MatrixXd &mat, unsigned int rows, unsigne
  * a different function is used in case I decide to initialise
  * these vector differently at some point
  * @param b the vector to be initialised
- * @param rows the rows in the vector b
  */
-void LSTMLayer::initialiseBiasVector(VectorXd &b, unsigned int rows) {
-    b = VectorXd::Zero(rows);
+void LSTMLayer::initialiseBiasVector(Ref<VectorXd> b) {
 
-    std::default_random_engine generator;
-    generator.seed((unsigned int)chrono::system_clock::now().time_since_epoch().count());
+    RngStream generator = newRngStream();
 
     //set up the distribution
     std::normal_distribution<double> distribution(0.0,INITIAL_STD_DEV);
 
     //initialise each value in the vector
-    for(int i = 0; i < rows; i++) {
-        b(i,0) = distribution(generator);
+    for(int i = 0; i < b.rows(); i++) {
+        b(i) = distribution(generator);
     }
-
-
-
 }
 
 /**
@@ -72,40 +64,40 @@ void LSTMLayer::initialiseBiasVector(VectorXd &b, unsigned int rows) {
  */
 void LSTMLayer::resetState() {
 
-
     //reset all values of h and C to 0.0 (for now)
-    for(int i = 0; i < h.rows(); i++) {
-        h(i,0) = 0.0;
-        C(i,0) = 0.0;
-    }
+    h.setZero();
+    C.setZero();
 }
 
 /**
  * constructor sets up the state of the lstm layer
+ * the packed matrices are allocated first, then the per-gate views are taken from them
  * @param inputSize the size of the input data
  * @param hiddenOutputSize the desired size of the output from the hidden layer
  */
-LSTMLayer::LSTMLayer(unsigned int inputSize, unsigned int hiddenOutputSize) {
+LSTMLayer::LSTMLayer(unsigned int inputSize, unsigned int hiddenOutputSize) :
+        h(hiddenOutputSize), C(hiddenOutputSize),
+        theta_x(4 * hiddenOutputSize, inputSize), theta_h(4 * hiddenOutputSize, hiddenOutputSize),
+        bias(4 * hiddenOutputSize), gates(4 * hiddenOutputSize),
+        theta_xi(theta_x.middleRows(0, hiddenOutputSize)),
+        theta_xf(theta_x.middleRows(hiddenOutputSize, hiddenOutputSize)),
+        theta_xo(theta_x.middleRows(2 * hiddenOutputSize, hiddenOutputSize)),
+        theta_xg(theta_x.middleRows(3 * hiddenOutputSize, hiddenOutputSize)),
+        theta_hi(theta_h.middleRows(0, hiddenOutputSize)),
+        theta_hf(theta_h.middleRows(hiddenOutputSize, hiddenOutputSize)),
+        theta_ho(theta_h.middleRows(2 * hiddenOutputSize, hiddenOutputSize)),
+        theta_hg(theta_h.middleRows(3 * hiddenOutputSize, hiddenOutputSize)),
+        bias_i(bias.segment(0, hiddenOutputSize)),
+        bias_f(bias.segment(hiddenOutputSize, hiddenOutputSize)),
+        bias_o(bias.segment(2 * hiddenOutputSize, hiddenOutputSize)),
+        bias_g(bias.segment(3 * hiddenOutputSize, hiddenOutputSize)) {
 
     resetState(); //reset/initialise the internal state of the lstm layer
 
-    //initialise input weight matrices
-    initialiseWeightMatrix(theta_xi,hiddenOutputSize,inputSize);
-    initialiseWeightMatrix(theta_xf,hiddenOutputSize,inputSize);
-    initialiseWeightMatrix(theta_xo,hiddenOutputSize,inputSize);
-    initialiseWeightMatrix(theta_xg,hiddenOutputSize,inputSize);
-
-    //initialise recurrent weight matrices
-    initialiseWeightMatrix(theta_hi,hiddenOutputSize,hiddenOutputSize);
-    initialiseWeightMatrix(theta_hf,hiddenOutputSize,hiddenOutputSize);
-    initialiseWeightMatrix(theta_ho,hiddenOutputSize,hiddenOutputSize);
-    initialiseWeightMatrix(theta_hg,hiddenOutputSize,hiddenOutputSize);
-
-    //initialise bias vectors
-    initialiseBiasVector(bias_i,hiddenOutputSize);
-    initialiseBiasVector(bias_f,hiddenOutputSize);
-    initialiseBiasVector(bias_o,hiddenOutputSize);
-    initialiseBiasVector(bias_g,hiddenOutputSize);
+    //initialise all input and recurrent weights, and the biases
+    initialiseWeightMatrix(theta_x);
+    initialiseWeightMatrix(theta_h);
+    initialiseBiasVector(bias);
 
 }
 
@@ -113,38 +105,59 @@ LSTMLayer::LSTMLayer(unsigned int inputSize, unsigned int hiddenOutputSize) {
  * implemented from lstm.h
  * function takes a new input to the layer
  * and uses it to update the hidden state of the lstm 'cell'
+ * all four gates are calculated together and written into preallocated storage
  * @param x_t the new input into the hidden layer
  * @return the new hidden state h (also stored internally)
  */
-VectorXd LSTMLayer::update(VectorXd x_t) {
-
+const VectorXd &LSTMLayer::update(const Ref<const VectorXd> &x_t) {
 
-    //input gate calculations
-    VectorXd i_t = (theta_xi * x_t) + (theta_hi * h) + bias_i;
-    i_t = applyToAll(sigmoid,i_t);
+    long H = h.rows();
 
-    //forget gate calculations
-    VectorXd f_t = (theta_xf * x_t) + (theta_hf * h) + bias_f;
-    f_t = applyToAll(sigmoid,f_t);
+    //pre-activations for every gate at once
+    gates.noalias() = theta_x * x_t;
+    gates.noalias() += theta_h * h;
+    gates += bias;
 
-    //output gate calculations
-    VectorXd o_t = (theta_xo * x_t) + (theta_ho * h) + bias_o;
-    o_t = applyToAll(sigmoid,o_t);
-
-    //g calculations
-    VectorXd g_t = (theta_xg * x_t) + (theta_hg * h) + bias_g;
-    g_t = applyToAll(tanh,g_t);
+    //sigmoid for the input, forget and output gates, tanh for g
+    gates.head(3 * H) = (1.0 + (-gates.head(3 * H).array()).exp()).inverse();
+    gates.tail(H) = gates.tail(H).array().tanh();
 
     //update cell state C value
-    C = f_t.cwiseProduct(C) + i_t.cwiseProduct(g_t);
+    C.array() = gates.segment(H, H).array() * C.array() + gates.head(H).array() * gates.tail(H).array();
 
     //update hidden output state
-    h = o_t.cwiseProduct(applyToAll(tanh,C));
+    h.array() = gates.segment(2 * H, H).array() * C.array().tanh();
 
     return h;
 
 }
 
+/**
+ * implemented from lstm.h
+ * the same calculation as update, with one sequence per column
+ * @param hs the hidden states, updated in place
+ * @param cs the cell states, updated in place
+ * @param x_t the new inputs
+ * @param gateScratch scratch space for the gates
+ */
+void LSTMLayer::updateBatch(Ref<MatrixXd> hs, Ref<MatrixXd> cs, const Ref<const MatrixXd> &x_t,
+                            Ref<MatrixXd> gateScratch) const {
+
+    long H = h.rows();
+
+    gateScratch.noalias() = theta_x * x_t;
+    gateScratch.noalias() += theta_h * hs;
+    gateScratch.colwise() += bias;
+
+    gateScratch.topRows(3 * H) = (1.0 + (-gateScratch.topRows(3 * H).array()).exp()).inverse();
+    gateScratch.bottomRows(H) = gateScratch.bottomRows(H).array().tanh();
+
+    cs.array() = gateScratch.middleRows(H, H).array() * cs.array() +
+                 gateScratch.topRows(H).array() * gateScratch.bottomRows(H).array();
+
+    hs.array() = gateScratch.middleRows(2 * H, H).array() * cs.array().tanh();
+}
+
 //****LSTMNet Functions****
 
 /**
@@ -160,9 +173,8 @@ void LSTMNet::initialiseWeightMatrix(MatrixXd &mat, int rows, int cols) {
     //allocate space for the matrix
     mat = MatrixXd::Zero(rows,cols);
 
-    //initialise random generator with a timestamped seed
-    default_random_engine generator;
-    generator.seed((unsigned int)chrono::system_clock::now().time_since_epoch().count());
+    //each matrix gets its own stream
+    RngStream generator = newRngStream();
 
     //create the normal distribution used to initialise the matrix
     normal_distribution<double> distribution(0.0,INITIAL_STD_DEV);
@@ -175,82 +187,6 @@ void LSTMNet::initialiseWeightMatrix(MatrixXd &mat, int rows, int cols) {
     }
 }
 
-/**
- * implemented from lstm.h
- * function takes a file path (to a csv file)
- * and reads the matrix in that file into an Eigen matrix
- * @param path the file path
- * @return the matrix represented in that file
- */
-MatrixXd LSTMNet::readWeightMatrix(string path) {
-    vector<vector<double>> temp;
-
-    ifstream matFile(path);
-    string item;
-
-    vector<double> currentVector;
-
-    //read item by item
-    while(getline(matFile,item,',')) {
-
-        if(item == "\n") { //exit condition, item only has a newline
-            temp.push_back(currentVector);
-            currentVector.clear();
-            break;
-        }
-
-        if(item.find('\n') != string::npos) { //if we reach a new line
-            temp.push_back(currentVector);
-            currentVector.clear();
-        }
-
-        double currentVal = stod(item,nullptr);
-        currentVector.push_back(currentVal);
-    }
-
-    //now put into an eigen matrix
-
-    MatrixXd newMat = MatrixXd::Random(temp.size(), temp.at(0).size());
-
-    for(unsigned int i = 0; i < temp.size(); i++) {
-        for(unsigned int j = 0; j < temp.at(0).size(); j++) {
-            newMat(i,j) = temp.at(i).at(j);
-        }
-    }
-
-    return newMat;
-}
-
-/**
- * implemented from lstm.h
- * file takes an Eigen matrix and writes it to file
- * @param weightMatrix the matrix to be written
- * @param path the path to the write the matrix too
- */
-void LSTMNet::writeWeightMatrix(MatrixXd weightMatrix, string path) {
-
-    //first, open the file
-    ofstream csvFile;
-    csvFile.open(path);
-
-    for(int i = 0; i < weightMatrix.rows(); i++) {
-        for(int j = 0; j < weightMatrix.cols(); j++) { //we want to retain the level of precision
-
-            if(!csvFile.is_open()) return; //a small level of error checking
-            csvFile << setprecision(numeric_limits<double>::digits10 + 1) << weightMatrix(i,j);
-
-            if(!csvFile.is_open()) return;
-            csvFile << ",";
-        }
-
-        if(!csvFile.is_open()) return;
-        csvFile << "\n";
-    }
-
-    csvFile.close();
-}
-
-
 /**
  * implemented from lstm.h
  * constructor sets up network of appropriate size
@@ -293,22 +229,24 @@ LSTMNet::LSTMNet(unsigned int inputSize, unsigned int hiddenSize, VectorXd(*out)
     lstmLayer = std::make_shared<LSTMLayer>(inputSize,hiddenSize);
 
     //now read in all the matrices
-    lstmLayer->theta_xi = readWeightMatrix(filePrefix + "theta_xi.csv");
-    lstmLayer->theta_xf = readWeightMatrix(filePrefix + "theta_xf.csv");
-    lstmLayer->theta_xo = readWeightMatrix(filePrefix + "theta_xo.csv");
-    lstmLayer->theta_xg = readWeightMatrix(filePrefix + "theta_xg.csv");
+    loadWeightMatrix(filePrefix + "theta_xi.csv",lstmLayer->theta_xi);
+    loadWeightMatrix(filePrefix + "theta_xf.csv",lstmLayer->theta_xf);
+    loadWeightMatrix(filePrefix + "theta_xo.csv",lstmLayer->theta_xo);
+    loadWeightMatrix(filePrefix + "theta_xg.csv",lstmLayer->theta_xg);
 
-    lstmLayer->bias_i = readWeightMatrix(filePrefix + "bias_i.csv");
-    lstmLayer->bias_f = readWeightMatrix(filePrefix + "bias_f.csv");
-    lstmLayer->bias_o = readWeightMatrix(filePrefix + "bias_o.csv");
-    lstmLayer->bias_g = readWeightMatrix(filePrefix + "bias_g.csv");
+    loadWeightMatrix(filePrefix + "bias_i.csv",lstmLayer->bias_i);
+    loadWeightMatrix(filePrefix + "bias_f.csv",lstmLayer->bias_f);
+    loadWeightMatrix(filePrefix + "bias_o.csv",lstmLayer->bias_o);
+    loadWeightMatrix(filePrefix + "bias_g.csv",lstmLayer->bias_g);
 
-    lstmLayer->theta_hi = readWeightMatrix(filePrefix + "theta_hi.csv");
-    lstmLayer->theta_hf = readWeightMatrix(filePrefix + "theta_hf.csv");
-    lstmLayer->theta_ho = readWeightMatrix(filePrefix + "theta_ho.csv");
-    lstmLayer->theta_hg = readWeightMatrix(filePrefix + "theta_hg.csv");
+    loadWeightMatrix(filePrefix + "theta_hi.csv",lstmLayer->theta_hi);
+    loadWeightMatrix(filePrefix + "theta_hf.csv",lstmLayer->theta_hf);
+    loadWeightMatrix(filePrefix + "theta_ho.csv",lstmLayer->theta_ho);
+    loadWeightMatrix(filePrefix + "theta_hg.csv",lstmLayer->theta_hg);
 
-    outputWeights = readWeightMatrix(filePrefix + "outputWeights.csv");
+    //the output size isn't given, but the output weights must still take the hidden output
+    outputWeights = loadWeightMatrix(filePrefix + "outputWeights.csv");
+    if(outputWeights.cols() != hiddenSize) throw "Weight matrix file doesn't match the LSTM dimensions";
 
 }
 
@@ -320,24 +258,24 @@ LSTMNet::LSTMNet(unsigned int inputSize, unsigned int hiddenSize, VectorXd(*out)
 void LSTMNet::saveNetwork() {
     string filePrefix = "lstmWeightMatrix_";
 
-    //whole function is really just a load of calls to writeWeightMatrix
+    //whole function is really just a load of calls to saveWeightMatrix
 
-    writeWeightMatrix(lstmLayer->theta_xi,filePrefix + "theta_xi.csv");
-    writeWeightMatrix(lstmLayer->theta_xf,filePrefix + "theta_xf.csv");
-    writeWeightMatrix(lstmLayer->theta_xo,filePrefix + "theta_xo.csv");
-    writeWeightMatrix(lstmLayer->theta_xg,filePrefix + "theta_xg.csv");
+    saveWeightMatrix(filePrefix + "theta_xi.csv",lstmLayer->theta_xi);
+    saveWeightMatrix(filePrefix + "theta_xf.csv",lstmLayer->theta_xf);
+    saveWeightMatrix(filePrefix + "theta_xo.csv",lstmLayer->theta_xo);
+    saveWeightMatrix(filePrefix + "theta_xg.csv",lstmLayer->theta_xg);
 
-    writeWeightMatrix(lstmLayer->bias_i,filePrefix + "bias_i.csv");
-    writeWeightMatrix(lstmLayer->bias_f,filePrefix + "bias_f.csv");
-    writeWeightMatrix(lstmLayer->bias_o,filePrefix + "bias_o.csv");
-    writeWeightMatrix(lstmLayer->bias_g,filePrefix + "bias_g.csv");
+    saveWeightMatrix(filePrefix + "bias_i.csv",lstmLayer->bias_i);
+    saveWeightMatrix(filePrefix + "bias_f.csv",lstmLayer->bias_f);
+    saveWeightMatrix(filePrefix + "bias_o.csv",lstmLayer->bias_o);
+    saveWeightMatrix(filePrefix + "bias_g.csv",lstmLayer->bias_g);
 
-    writeWeightMatrix(lstmLayer->theta_hi,filePrefix + "theta_hi.csv");
-    writeWeightMatrix(lstmLayer->theta_hf,filePrefix + "theta_hf.csv");
-    writeWeightMatrix(lstmLayer->theta_ho,filePrefix + "theta_ho.csv");
-    writeWeightMatrix(lstmLayer->theta_hg,filePrefix + "theta_hg.csv");
+    saveWeightMatrix(filePrefix + "theta_hi.csv",lstmLayer->theta_hi);
+    saveWeightMatrix(filePrefix + "theta_hf.csv",lstmLayer->theta_hf);
+    saveWeightMatrix(filePrefix + "theta_ho.csv",lstmLayer->theta_ho);
+    saveWeightMatrix(filePrefix + "theta_hg.csv",lstmLayer->theta_hg);
 
-    writeWeightMatrix(outputWeights,filePrefix + "outputWeights.csv");
+    saveWeightMatrix(filePrefix + "outputWeights.csv",outputWeights);
 }
 
 /**
@@ -347,11 +285,34 @@ void LSTMNet::saveNetwork() {
  * @param x_t the newly arrived input data
  * @return the new output of the network
  */
-VectorXd LSTMNet::predict(VectorXd x_t) {
-    VectorXd output =  outputWeights * lstmLayer->update(std::move(x_t));
+VectorXd LSTMNet::predict(const Ref<const VectorXd> &x_t) {
+    VectorXd output = outputWeights * lstmLayer->update(x_t);
 
     //if an output function provided, then use it!
     if(outputFun != nullptr) output = outputFun(output);
 
     return output;
-}
\ No newline at end of file
+}
+
+/**
+ * implemented from lstm.h
+ * batched version of predict, one sequence per column
+ * @param hs the hidden states, updated in place
+ * @param cs the cell states, updated in place
+ * @param x_t the newly arrived inputs
+ * @param gateScratch scratch space for the gates
+ * @param outputs where to write the network outputs
+ */
+void LSTMNet::predictBatch(Ref<MatrixXd> hs, Ref<MatrixXd> cs, const Ref<const MatrixXd> &x_t,
+                           Ref<MatrixXd> gateScratch, Ref<MatrixXd> outputs) const {
+
+    lstmLayer->updateBatch(hs,cs,x_t,gateScratch);
+    outputs.noalias() = outputWeights * hs;
+
+    //the output function works on one vector at a time
+    if(outputFun != nullptr) {
+        for(long i = 0; i < outputs.cols(); i++) {
+            outputs.col(i) = outputFun(outputs.col(i));
+        }
+    }
+}
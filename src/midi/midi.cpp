@@ -366,7 +366,7 @@ void MidiFile::writeChunk(MidiChunk chunk) {
 
 //needs a name for the file, and a header file and an initial track (can have more)
 MidiFile::MidiFile(std::string fileName, MidiHeader hd, MidiTrack trk) {
-    midiFile.open(fileName, std::ofstream::out | std::ofstream::trunc);
+    midiFile.open(fileName, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary); //no newline translation
     writeChunk(std::move(hd));
     writeChunk(std::move(trk));
 }
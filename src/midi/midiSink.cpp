@@ -0,0 +1,193 @@
+/**
+ * file implements the functionality found within midiSink.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/midi/midiSink.h"
+#include <boost/thread.hpp>
+#include <algorithm>
+
+/**
+ * implemented from midiSink.h
+ * constructor starts the sink's clock
+ */
+MidiSink::MidiSink() : created(chrono::steady_clock::now()) {}
+
+/**
+ * implemented from midiSink.h
+ * @return the seconds since the sink was created
+ */
+double MidiSink::now() const {
+    return chrono::duration<double>(chrono::steady_clock::now() - created).count();
+}
+
+/**
+ * implemented from midiSink.h
+ * nothing needs doing at the end of a response by default
+ * @return true
+ */
+bool MidiSink::finish() {
+    return true;
+}
+
+/**
+ * implemented from midiSink.h
+ * records a message
+ * @param event the message
+ * @return true
+ */
+bool MemoryMidiSink::send(const midiEvent &event) {
+    midiEvent stamped = event;
+    stamped.time = now();
+
+    boost::mutex::scoped_lock lock(sentMutex);
+    sent.push_back(stamped);
+    return true;
+}
+
+/**
+ * implemented from midiSink.h
+ * @return a copy of every message sent so far
+ */
+vector<midiEvent> MemoryMidiSink::events() const {
+    boost::mutex::scoped_lock lock(sentMutex);
+    return sent;
+}
+
+/**
+ * implemented from midiSink.h
+ * forgets every message sent so far
+ */
+void MemoryMidiSink::clear() {
+    boost::mutex::scoped_lock lock(sentMutex);
+    sent.clear();
+}
+
+/**
+ * implemented from midiSink.h
+ * @param fileName the path of the midi file
+ */
+SmfMidiSink::SmfMidiSink(string fileName) : fileName(std::move(fileName)) {}
+
+/**
+ * implemented from midiSink.h
+ * writes every message so far to the file, at the times they were sent
+ * @return true
+ */
+bool SmfMidiSink::finish() {
+    vector<midiEvent> all = events();
+
+    MidiHeader hd(0,1,MIDI_PPQN);
+    MidiTrack trk;
+    trk.setTempo(0,MIDI_TEMPO);
+
+    //delta times are worked out from the total so rounding doesn't build up
+    unsigned int lastTick = 0;
+    for(const midiEvent &event : all) {
+        byte type = event.status & (byte)0xF0;
+        if(type != NOTE_ON && type != NOTE_OFF && type != PROGRAM_CHANGE && type != CONTROLLER_CHANGE) {
+            continue; //the player never sends anything else
+        }
+
+        unsigned int tick = max(secondsToTicks(event.time), lastTick);
+        unsigned int delta = tick - lastTick;
+        lastTick = tick;
+
+        if(type == NOTE_ON) {
+            trk.noteOn(delta,event.data1,event.data2);
+        } else if(type == NOTE_OFF) {
+            trk.noteOff(delta,event.data1,event.data2);
+        } else if(type == PROGRAM_CHANGE) {
+            trk.programChange(delta,event.data1);
+        } else {
+            trk.controllerChange(delta,event.data1,event.data2);
+        }
+    }
+    trk.endOfTrack(0);
+
+    MidiFile output(fileName,hd,trk);
+    output.closeFile();
+    return true;
+}
+
+/**
+ * implemented from midiSink.h
+ * @param sink where messages go
+ */
+MidiPlayer::MidiPlayer(MidiSink *sink) : sink(sink), hook(nullptr), hookData(nullptr),
+                                         sentCount(0), totalLateness(0.0), worstLateness(0.0) {}
+
+/**
+ * implemented from midiSink.h
+ * @param newHook the function (nullptr to stop calling it)
+ * @param userData passed to the hook on each call
+ */
+void MidiPlayer::setEventHook(midiHook newHook, void *userData) {
+    hook = newHook;
+    hookData = userData;
+}
+
+/**
+ * implemented from midiSink.h
+ * plays a response, only returning once it has finished
+ * @param events the messages, in order, timed from the start of the response
+ * @param running the running state of the system
+ * @return false if the sink failed
+ */
+bool MidiPlayer::play(const vector<midiEvent> &events, const atomic<bool> &running) {
+
+    auto start = chrono::steady_clock::now();
+
+    for(const midiEvent &event : events) {
+
+        //sleep until just before the message is due, then spin the rest of the way
+        auto due = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(event.time));
+        auto wake = due - chrono::milliseconds(MIDI_SPIN_MS);
+        while(running && chrono::steady_clock::now() < wake) {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+        }
+        while(running && chrono::steady_clock::now() < due) {
+            boost::this_thread::yield();
+        }
+
+        if(!running) { //stopped part way through, don't leave anything ringing
+            sink->send(midiEvent(0.0, CONTROLLER_CHANGE, 0x7B, 0x00)); //all notes off
+            return sink->finish();
+        }
+
+        if(!sink->send(event)) return false;
+
+        double late = chrono::duration<double>(chrono::steady_clock::now() - due).count();
+        sentCount++;
+        totalLateness += late;
+        worstLateness = max(worstLateness, late);
+
+        if(hook != nullptr) hook(event, hookData);
+    }
+
+    return sink->finish();
+}
+
+/**
+ * implemented from midiSink.h
+ * @return the number of messages sent
+ */
+long MidiPlayer::eventsSent() const {
+    return sentCount;
+}
+
+/**
+ * implemented from midiSink.h
+ * @return the mean time in seconds messages were sent after they were due
+ */
+double MidiPlayer::meanLateness() const {
+    return sentCount == 0 ? 0.0 : totalLateness / sentCount;
+}
+
+/**
+ * implemented from midiSink.h
+ * @return the longest time in seconds a message was sent after it was due
+ */
+double MidiPlayer::maxLateness() const {
+    return worstLateness;
+}
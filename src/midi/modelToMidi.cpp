@@ -50,86 +50,44 @@ string naiveMidi(VectorXd prediction) {
 
 /**
  * implemented from esnToMidi.h
- * assumes output stream already opened
- * @param prediction the model prediction
- * @param out the output handle for the midi device
- * @param ppqn pulses per quarter note (to be stored here)
- * @param tempo the tempo in microseconds per quarter note
- * @return an array of midi events, where 3 longs represent one event
+ * turns the model's prediction into timed midi events
+ * @param prediction the model prediction (notes and durations in seconds)
+ * @return the events, in the order they should be sent
  */
-unsigned long *naiveMidiWin(MatrixXd prediction, HMIDISTRM *out, int *ppqn, int *tempo) {
+vector<midiEvent> predictionToEvents(const MatrixXd &prediction) {
 
-    unsigned long err; //error variable for problems in midi
+    vector<midiEvent> events;
+    events.reserve((unsigned long)(prediction.rows() * 2 + 1));
 
-    //set division value of midi track (PPQN)
-    MIDIPROPTIMEDIV prop1{};
-    prop1.cbStruct = sizeof(MIDIPROPTIMEDIV);
-    prop1.dwTimeDiv = 96;
-    err = midiStreamProperty(*out, (LPBYTE)&prop1, MIDIPROP_SET|MIDIPROP_TIMEDIV);
-    if(err) {
-        return nullptr;
-    }
-
-    //set the tempo
-    MIDIPROPTEMPO prop2{};
-    prop2.cbStruct = sizeof(MIDIPROPTIMEDIV);
-    prop2.dwTempo = 500000;
-    err = midiStreamProperty(*out, (LPBYTE)&prop2, MIDIPROP_SET|MIDIPROP_TEMPO);
-    if(err) {
-        return nullptr;
-    }
-
-    *ppqn = 96;
-    *tempo = 500000;
-
-    //0 (silence) doesn't get an event
-    int predictionNotZero = 0;
-    for(int i  = 0; i < prediction.rows(); i ++) {
-        if(prediction(i,0) != 0) predictionNotZero++;
-    }
-
-
-    //number of messages = 1 program change message + however many notes predicted
-    auto *events = new unsigned long[((predictionNotZero * 2) + 1) * 3];
+    events.emplace_back(0.0, PROGRAM_CHANGE, MIDI_PROGRAM, 0); //set the instrument
 
-    events[0] = 0;
-    events[1] = 0; //stupid Windows and its redundant parameters
-    events[2] = ((unsigned long)MEVT_SHORTMSG << 24) | 0x000001C0; //set to guitar sound (1E)
-    //bit shifting tip from http://midi.teragonaudio.com/tech/stream.htm
-
-    int arrStart = 0;
-    double startTime = 0;
     //note on and note off message for each note played
+    double time = 0.0;
     for(int i = 0; i < prediction.rows(); i++) {
 
-        if(prediction(i, 0) == 0) {
-            startTime += prediction(i,1);
+        if(prediction(i, 0) == 0) { //silence just moves time along
+            time += prediction(i,1);
             continue;
         }
 
-        int noteOn = ((arrStart * 2) + 1) * 3;
-        int noteOff = ((arrStart * 2) + 2) * 3;
-        arrStart++; //should keep array intact properly
-
-
-        auto currentNote = static_cast<unsigned char>(prediction(i, 0) + NOTE_OFFSET);
-        DWORD event = 0x007F0090;
-        event |= (currentNote << 8);
-
-        events[noteOn] = static_cast<unsigned long>(round(((double)(*ppqn) * (startTime * 1000000.0)) / ((double)(*tempo))));
-        events[noteOn + 1] = 0;
-        events[noteOn + 2] = ((unsigned long)MEVT_SHORTMSG << 24) | event;
-
-        events[noteOff] = static_cast<unsigned long>(round(((double)(*ppqn) * (prediction(i,1) * 1000000.0)) / ((double)(*tempo))));
-        events[noteOff + 1] = 0;
-        events[noteOff + 2] = ((unsigned long)MEVT_SHORTMSG << 24) | (event & 0xFFFFFF80);
-
-        startTime = 0;
+        auto currentNote = static_cast<byte>(prediction(i, 0) + NOTE_OFFSET);
+        events.emplace_back(time, NOTE_ON, currentNote, MIDI_VELOCITY);
+        time += prediction(i,1);
+        events.emplace_back(time, NOTE_OFF, currentNote, MIDI_VELOCITY);
     }
 
     return events;
 }
 
+/**
+ * implemented from esnToMidi.h
+ * @param seconds the time in seconds
+ * @return the number of ticks at MIDI_PPQN and MIDI_TEMPO
+ */
+unsigned int secondsToTicks(double seconds) {
+    return static_cast<unsigned int>(round(((double)MIDI_PPQN * (seconds * 1000000.0)) / ((double)MIDI_TEMPO)));
+}
+
 /**
  * implemented from esnToMidi.h
  * @return an integer timestamp as a string
@@ -0,0 +1,51 @@
+/**
+ * file implements the functionality found within winMidiSink.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/midi/winMidiSink.h"
+
+/**
+ * implemented from winMidiSink.h
+ * constructor opens the default midi device
+ * the timer resolution defaults to 15.6ms, far coarser than the player's spin window,
+ * so it's raised to 1ms while the sink exists to keep the player's sleeps from overshooting
+ */
+WinMidiSink::WinMidiSink() : out(nullptr) {
+    timeBeginPeriod(1);
+    opened = midiOutOpen(&out, MIDI_MAPPER, 0, 0, CALLBACK_NULL) == MMSYSERR_NOERROR;
+}
+
+/**
+ * implemented from winMidiSink.h
+ * destructor closes the device
+ */
+WinMidiSink::~WinMidiSink() {
+    if(opened) {
+        midiOutReset(out); //make sure nothing is left ringing
+        midiOutClose(out);
+    }
+    timeEndPeriod(1); //give the timer resolution back
+}
+
+/**
+ * implemented from winMidiSink.h
+ * @return true if the device was opened
+ */
+bool WinMidiSink::isOpen() const {
+    return opened;
+}
+
+/**
+ * implemented from winMidiSink.h
+ * plays a message
+ * @param event the message
+ * @return false if the device rejected it
+ */
+bool WinMidiSink::send(const midiEvent &event) {
+    if(!opened) return false;
+
+    //a short message is packed status first, from the least significant byte
+    DWORD message = (DWORD)event.status | ((DWORD)event.data1 << 8) | ((DWORD)event.data2 << 16);
+    return midiOutShortMsg(out, message) == MMSYSERR_NOERROR;
+}
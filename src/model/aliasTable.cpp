@@ -0,0 +1,94 @@
+/**
+ * file implements the functionality found within aliasTable.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/model/aliasTable.h"
+
+/**
+ * implemented from aliasTable.h
+ * default constructor leaves an empty table
+ */
+AliasTable::AliasTable() = default;
+
+/**
+ * implemented from aliasTable.h
+ * builds the table using Vose's method
+ * @param weights the (non-negative) weight of each outcome
+ */
+AliasTable::AliasTable(const Ref<const RowVectorXd> &weights) {
+    auto n = (int)weights.cols();
+    prob.assign((unsigned long)n,1.0);
+    alias.assign((unsigned long)n,0);
+    if(n == 0) return;
+
+    double total = weights.sum();
+    if(total <= 0.0) { //nothing to go on, so all equally likely
+        for(int i = 0; i < n; i++) alias.at(i) = i;
+        return;
+    }
+
+    //scale so the average weight is 1
+    vector<double> scaled((unsigned long)n);
+    vector<int> small;
+    vector<int> large;
+    for(int i = 0; i < n; i++) {
+        scaled.at(i) = weights(i) * n / total;
+        if(scaled.at(i) < 1.0) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
+        }
+    }
+
+    //pair each under-full column with an over-full one
+    while(!small.empty() && !large.empty()) {
+        int less = small.back();
+        small.pop_back();
+        int more = large.back();
+        large.pop_back();
+
+        prob.at(less) = scaled.at(less);
+        alias.at(less) = more;
+
+        scaled.at(more) = (scaled.at(more) + scaled.at(less)) - 1.0;
+        if(scaled.at(more) < 1.0) {
+            small.push_back(more);
+        } else {
+            large.push_back(more);
+        }
+    }
+
+    //anything left over is full (up to rounding error)
+    for(int i : large) {
+        prob.at(i) = 1.0;
+        alias.at(i) = i;
+    }
+    for(int i : small) {
+        prob.at(i) = 1.0;
+        alias.at(i) = i;
+    }
+}
+
+/**
+ * implemented from aliasTable.h
+ * draws a sample from the distribution
+ * @param gen the random stream to use
+ * @return the index of the outcome drawn
+ */
+int AliasTable::sample(RngStream &gen) const {
+    uniform_int_distribution<int> column(0,(int)prob.size()-1);
+    uniform_real_distribution<double> coin(0.0,1.0);
+
+    int i = column(gen);
+    if(coin(gen) < prob[i]) return i;
+    return alias[i];
+}
+
+/**
+ * implemented from aliasTable.h
+ * @return the number of outcomes
+ */
+int AliasTable::size() const {
+    return (int)prob.size();
+}
@@ -0,0 +1,155 @@
+/**
+ * file implements the functionality found within codebookIndex.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/model/codebookIndex.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * implemented from codebookIndex.h
+ * default constructor leaves an empty index
+ */
+CodebookIndex::CodebookIndex() : root(-1) {}
+
+/**
+ * implemented from codebookIndex.h
+ * sets up the index for a codebook
+ * @param B a matrix consisting of all the codebook vectors (one per column)
+ * @param treeThreshold use a k-d tree if there are at least this many codebook vectors
+ */
+CodebookIndex::CodebookIndex(const MatrixXd &B, long treeThreshold) : B(B), root(-1) {
+    norms = this->B.colwise().squaredNorm().transpose();
+
+    if(B.cols() > 0 && B.cols() >= treeThreshold) {
+        vector<int> indices((unsigned long)B.cols());
+        for(int i = 0; i < (int)indices.size(); i++) indices.at(i) = i;
+        tree.reserve(indices.size());
+        root = buildTree(indices,0,(int)indices.size());
+    }
+}
+
+/**
+ * implemented from codebookIndex.h
+ * splits on the widest dimension at the median
+ * @param indices the codebook columns still to be placed
+ * @param start the first index in indices for this subtree
+ * @param end one past the last index in indices for this subtree
+ * @return the node index of the subtree root (-1 if empty)
+ */
+int CodebookIndex::buildTree(vector<int> &indices, int start, int end) {
+    if(start >= end) return -1;
+
+    //find the dimension with the largest spread
+    int dim = 0;
+    double widest = -1.0;
+    for(int d = 0; d < B.rows(); d++) {
+        double lo = std::numeric_limits<double>::infinity();
+        double hi = -std::numeric_limits<double>::infinity();
+        for(int i = start; i < end; i++) {
+            double v = B(d,indices.at(i));
+            lo = min(lo,v);
+            hi = max(hi,v);
+        }
+        if(hi - lo > widest) {
+            widest = hi - lo;
+            dim = d;
+        }
+    }
+
+    //median split
+    int mid = start + (end - start) / 2;
+    nth_element(indices.begin() + start, indices.begin() + mid, indices.begin() + end,
+                [this,dim](int a, int b) { return B(dim,a) < B(dim,b); });
+
+    auto node = (int)tree.size();
+    tree.push_back({indices.at(mid),dim,-1,-1});
+
+    int left = buildTree(indices,start,mid);
+    int right = buildTree(indices,mid + 1,end);
+    tree.at(node).left = left;
+    tree.at(node).right = right;
+
+    return node;
+}
+
+/**
+ * implemented from codebookIndex.h
+ * searches the k-d tree for the closest codebook vector
+ * ties go to the lowest index, the same as the linear search
+ * @param x the data point
+ * @param node the current node
+ * @param bestIndex the closest codebook vector so far (updated)
+ * @param bestDistance its squared distance to x (updated)
+ */
+void CodebookIndex::searchTree(const Ref<const VectorXd> &x, int node, int &bestIndex, double &bestDistance) const {
+    if(node == -1) return;
+
+    const kdNode &current = tree.at(node);
+    double distance = (x - B.col(current.index)).squaredNorm();
+    if(distance < bestDistance || (distance == bestDistance && current.index < bestIndex)) {
+        bestDistance = distance;
+        bestIndex = current.index;
+    }
+
+    double diff = x(current.dim) - B(current.dim,current.index);
+    int nearSide = (diff < 0) ? current.left : current.right;
+    int farSide = (diff < 0) ? current.right : current.left;
+
+    searchTree(x,nearSide,bestIndex,bestDistance);
+
+    //only cross the split if the other side could be closer
+    if(diff * diff <= bestDistance) {
+        searchTree(x,farSide,bestIndex,bestDistance);
+    }
+}
+
+/**
+ * implemented from codebookIndex.h
+ * one matrix-vector product over the whole codebook
+ * @param x the data point
+ * @return the index in B of the closest codebook vector
+ */
+int CodebookIndex::linearSearch(const Ref<const VectorXd> &x) const {
+    VectorXd scores(B.cols());
+    scores.noalias() = B.transpose() * x;
+    scores = norms - 2.0 * scores;
+
+    int minIndex = -1;
+    scores.minCoeff(&minIndex);
+    return minIndex;
+}
+
+/**
+ * implemented from codebookIndex.h
+ * finds the closest codebook vector to a point
+ * @param x the data point
+ * @return the index in B of the closest codebook vector (-1 if the codebook is empty)
+ */
+int CodebookIndex::nearest(const Ref<const VectorXd> &x) const {
+    if(B.cols() == 0) return -1;
+
+    if(root == -1) return linearSearch(x);
+
+    int bestIndex = -1;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    searchTree(x,root,bestIndex,bestDistance);
+    return bestIndex;
+}
+
+/**
+ * implemented from codebookIndex.h
+ * @return true if the k-d tree is being used
+ */
+bool CodebookIndex::usesTree() const {
+    return root != -1;
+}
+
+/**
+ * implemented from codebookIndex.h
+ * @return the codebook vectors
+ */
+const MatrixXd &CodebookIndex::codebook() const {
+    return B;
+}
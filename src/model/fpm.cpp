@@ -8,203 +8,219 @@
 #include <limits>
 #include <chrono>
 #include <fstream>
+#include <algorithm>
 #include "../../include/model/fpm.h"
+#include "../../include/weights/weightFile.h"
+#include "../../include/esn/esn_costs.h"
+#include <boost/thread.hpp>
 #include <iostream>
 
 /**
- * applies the mapping for the chaos representation conversion
- * @param t_i the corner on the D dimensional hypercube
+ * implemented from fpm.h
+ * default constructor leaves an empty state
+ */
+ChaosState::ChaosState() : k(0.0) {}
+
+/**
+ * implemented from fpm.h
+ * sets up a state at the centre of the hypercube
+ * @param t all corners of the hypercube
  * @param k the `shrinking' parameter
- * @param x the point on the D dimensional hypercube
- * @return the mapped point
  */
-VectorXd FPM::applyMap(VectorXd t_i, double k, VectorXd x) {
-    return (k * x) + ((1.0 - k) * t_i);
+ChaosState::ChaosState(const MatrixXd &t, double k) : t(t), k(k) {
+    reset();
 }
 
+/**
+ * implemented from fpm.h
+ * applies the mapping for the chaos representation conversion
+ * @param symbol the symbol appended to the sequence
+ */
+void ChaosState::append(int symbol) {
+    x = (k * x) + ((1.0 - k) * t.col(symbol));
+}
 
 /**
-  * forms the chaos block representation for a sequence of notes
-  * @param t all corners of the hypercube
-  * @param k the `shrinking' parameter
-  * @param S the sequence of notes
-  */
-VectorXd FPM::toChaosRep(MatrixXd t, double k, vector<int> S) {
-    int D = t.rows();
-
-    //initialise to centre of hypercube
-    VectorXd x = MatrixXd::Constant(D,1,0.5);
-
-    //now do the conversion to CBR
-    for(auto note : S) {
-       x = applyMap(t.col(note),k,x); //TODO: Test this works properly!
-    }
+ * implemented from fpm.h
+ * back to the centre of the hypercube
+ */
+void ChaosState::reset() {
+    x = VectorXd::Constant(t.rows(),0.5);
+}
 
+/**
+ * implemented from fpm.h
+ * @return the current point
+ */
+const VectorXd &ChaosState::point() const {
     return x;
 }
 
 /**
- * calculates euclidean distance between two vectors
- * @param x a vector
- * @param y a vector
- * @return the euclidean distance
+ * implemented from fpm.h
+ * scores a response on how well each note follows on from the last
+ * silences are skipped over
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in (not needed here)
+ * @return the average interval cost between consecutive notes
  */
-double FPM::euclideanDistance(VectorXd x, VectorXd y) {
-    double distance = 0.0;
-    for(int i = 0; i < x.rows(); i++) {
-        distance += pow((x(i,0)-y(i,0)),2);
+double intervalPhraseCost(const vector<int> &userPhrase, const vector<int> &response, const string &) {
+
+    //the response follows on from the user's last note
+    int prevNote = 0;
+    for(int note : userPhrase) {
+        if(note != 0) prevNote = note;
     }
-    return distance;
+
+    vector<double> from;
+    vector<double> to;
+    for(int note : response) {
+        if(note == 0) continue;
+        if(prevNote != 0) {
+            from.push_back(prevNote);
+            to.push_back(note);
+        }
+        prevNote = note;
+    }
+
+    if(from.empty()) return 0.0;
+
+    VectorXd gt = Map<VectorXd>(from.data(),from.size());
+    VectorXd prediction = Map<VectorXd>(to.data(),to.size());
+    return intervalCost(gt,prediction) / from.size();
 }
 
 /**
- * function finds the closest codebook vector
- * to point x, and returns the index in B of
- * the closest codebook vector
- * @param x the data point x
- * @param B a matrix consisting of all the codebook vectors
- * @return the index in B of the closest codebook vector
+ * implemented from fpm.h
+ * scores a response on how well it fits the key the user finished in
+ * uses the same key profile as the key detection
+ * @param userPhrase the absolute notes the user played (not needed here)
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the average shortfall from the key profile's best note
  */
-int FPM::findClosestCodebook(VectorXd x, MatrixXd B) {
-    double minDistance = std::numeric_limits<double>::infinity(); //set to inifinitely high value
-    int minIndex = -1; //nothing found yet
-
-    //loop through the codebook vectors
-    for(int i = 0; i < B.cols(); i++) {
-        double newDistance = euclideanDistance(x,B.col(i));
-        if(newDistance < minDistance) {
-            minDistance = newDistance;
-            minIndex = i;
-        }
+double keyPhraseCost(const vector<int> &, const vector<int> &response, const string &key) {
+
+    int keyIndex = keyToVal(key);
+    double bestProfile = *max_element(majorProfile,majorProfile + NUM_KEYS);
+
+    double cost = 0.0;
+    int notes = 0;
+    for(int note : response) {
+        if(note == 0) continue;
+        int pitchClass = (note % 12) + 1; //as in queueNote
+        cost += bestProfile - majorProfile[mod(pitchClass - keyIndex,12)];
+        notes++;
     }
 
-    //return the index of the closest codebook vector
-    return minIndex;
+    if(notes == 0) return 0.0;
+    return cost / notes;
 }
 
 /**
- * predicts the next note in the sequence s
- * @param s the sequence of notes
- * @param B the matrix of codebook vectors
- * @param N the matrix of distributions
- * @param t the matrix of D dimensional hypercube parameters
- * @param k the `shrinking' parameter
- * @return the next note in the sequence
+ * implemented from fpm.h
+ * the sum of the interval and key costs
+ * @param userPhrase the absolute notes the user played
+ * @param response the absolute notes of the candidate response
+ * @param key the key the user finished in
+ * @return the combined cost of the response
  */
-int FPM::predictNextNote(vector<int> s, MatrixXd B, MatrixXd N, MatrixXd t, double k) {
+double combinedPhraseCost(const vector<int> &userPhrase, const vector<int> &response, const string &key) {
+    return intervalPhraseCost(userPhrase,response,key) + keyPhraseCost(userPhrase,response,key);
+}
 
-    //bring sequence to chaos representation
-    VectorXd x = toChaosRep(std::move(t),k,std::move(s));
+/**
+ * predicts the next note in the sequence
+ * @param x the chaos representation of the sequence so far
+ * @param generator the random stream to use
+ * @return the next note in the sequence
+ */
+int FPM::predictNextNote(const VectorXd &x, RngStream &generator) const {
 
     //now find the closest codebook vector
-    int i = findClosestCodebook(x,std::move(B));
-
-    RowVectorXd distribution = N.row(i);
+    int i = noteIndex.nearest(x);
 
-    double maxVal = distribution.maxCoeff();
-
-    distribution /= maxVal;
-
-    double totalSamples = 0;
-    for(int j = 0; j < distribution.cols(); j++) {
-        totalSamples += distribution(0,j);
-    }
-
-    //set up a random generator
-    uniform_real_distribution<double> rng(0,totalSamples);
-
-    //do some random sampling to generate the note
-    double randNo = rng(gen);
-
-    double total = 0;
-    for(int j = 0; j < distribution.cols(); j++) {
-        total += distribution(0,j);
-        if(randNo <= total) return j;
-    }
+    //and sample from its distribution
+    return noteSamplers.at(i).sample(generator);
 }
 
 /**
  * predicts the motion of the next note
- * @param s a sequence of directions (+/-)
- * @param B the matrix of codebook vectors
- * @param N the matrix of distributions
- * @param t the matric of D dimensional hypercube corners
- * @param k the `shrinking' parameter
+ * @param x the chaos representation of the directions so far
  * @param upInterval the upwards interval
+ * @param generator the random stream to use
  * @return the next direction in the sequence
  */
-int FPM::predictNextDir(vector<int> s, MatrixXd B, MatrixXd N, MatrixXd t, double k, int upInterval) {
-    //bring sequence to chaos representation
-    VectorXd x = toChaosRep(std::move(t),k, std::move(s));
+int FPM::predictNextDir(const VectorXd &x, int upInterval, RngStream &generator) const {
 
     //now find the closest codebook vector
-    int i = findClosestCodebook(x, std::move(B));
-
-    //apply interval based cost
-    RowVectorXd distribution = N.row(i);
-    if(upInterval > 6 && upInterval != 12) {
-        distribution(0,1) = round(distribution(0,1) * exp(-(upInterval-6.0)/TDir));
-    } else if(upInterval < 6 && upInterval != 0){
-        distribution(0,0) = round(distribution(0,0) * exp(-(6.0-upInterval)/TDir));
-    }
+    int i = dirIndex.nearest(x);
 
-    auto totalSamples = (int)distribution.sum();
-
-    //set up a random generator
-    //default_random_engine gen;
-   // gen.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
-    uniform_int_distribution<int> rng(1,totalSamples);
+    //the interval based cost is already applied to the counts
+    uniform_int_distribution<int> rng(1,dirTotal(i,upInterval));
 
     //actually generate a random number and use that to determine value
-    int randNo = rng(gen);
-    if(randNo <= distribution(0,0)) return 0;
+    int randNo = rng(generator);
+    if(randNo <= dirDown(i,upInterval)) return 0;
 
     return 1;
 
 }
 
 /**
- * reads in a matrix from a csv file
- * @param filePath the path to the matrix file
- * @param rows the number of rows
- * @param cols the number of columns
- * @return the read-in matrix
+ * precomputes everything needed for sampling from NNote and NDir
  */
-MatrixXd FPM::readInMat(string filePath, int rows, int cols) {
-    vector<vector<double>> temp; //temporary storage for matrix values
+void FPM::buildSamplers() {
 
-    ifstream matFile(filePath);
-    string item;
+    //tilt the note counts by the temperature
+    NNote = Eigen::pow(NNoteCounts.array(),1.0/TNote);
 
-    vector<double> currentVector;
-
-    //read item by item
-    while(getline(matFile,item,',')) {
+    noteSamplers.clear();
+    for(int i = 0; i < NNote.rows(); i++) {
+        noteSamplers.emplace_back(NNote.row(i));
+    }
 
-        if (!item.compare("\n")) { //exit condition, item only has a newline
-            temp.push_back(currentVector);
-            currentVector.clear();
-            break;
+    //large intervals are penalised in the direction which causes them
+    for(int upInterval = 0; upInterval < NUM_UP_INTERVALS; upInterval++) {
+        if(upInterval > 6) {
+            dirTilt[upInterval] = exp(-(upInterval-6.0)/TDir);
+        } else if(upInterval < 6 && upInterval != 0) {
+            dirTilt[upInterval] = exp(-(6.0-upInterval)/TDir);
+        } else {
+            dirTilt[upInterval] = 1.0;
         }
+    }
 
-        if (item.find('\n') != string::npos) { //if we reach a new line
-            temp.push_back(currentVector);
-            currentVector.clear();
+    dirDown = MatrixXi::Zero(NDir.rows(),NUM_UP_INTERVALS);
+    dirTotal = MatrixXi::Zero(NDir.rows(),NUM_UP_INTERVALS);
+    for(int i = 0; i < NDir.rows(); i++) {
+        for(int upInterval = 0; upInterval < NUM_UP_INTERVALS; upInterval++) {
+            double down = NDir(i,0);
+            double up = NDir(i,1);
+            if(upInterval > 6) {
+                up = round(up * dirTilt[upInterval]);
+            } else if(upInterval < 6 && upInterval != 0) {
+                down = round(down * dirTilt[upInterval]);
+            }
+            dirDown(i,upInterval) = (int)down;
+            dirTotal(i,upInterval) = (int)(down + up);
         }
-
-
-        double currentVal = stod(item, nullptr);
-        currentVector.push_back(currentVal);
-
     }
+}
 
-    //now write into the matrix
-    MatrixXd mat = MatrixXd::Zero(rows,cols);
+/**
+ * reads in a matrix from a csv file (or its binary twin)
+ * @param filePath the path to the matrix file
+ * @param rows the number of rows
+ * @param cols the number of columns
+ * @return the read-in matrix, throws if it isn't rows x cols
+ */
+MatrixXd FPM::readInMat(string filePath, int rows, int cols) {
+    MatrixXd mat = loadWeightMatrix(filePath);
 
-    for(unsigned int i = 0; i < rows; i++) {
-        for(unsigned int j = 0; j < cols; j++) {
-            mat(i,j) = temp.at(i).at(j);
-        }
+    if(mat.rows() != rows || mat.cols() != cols) {
+        throw "FPM matrix file has the wrong dimensions";
     }
 
     return mat;
@@ -243,13 +259,23 @@ FPM::FPM(string BNotePath, string NNotePath, string tNotePath, double kNote, dou
     this->TDir = TDir;
 
     //scale the NNote matrix by the temperature parameter
-    NNote = Eigen::pow(NNote.array(),1.0/TNote);
+    //and set up the sampling tables
+    NNoteCounts = NNote;
+    buildSamplers();
 
     //initialise previousNote
     previousNote = -1;
 
-    //seed random generator
-    gen.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+    //both sequences start empty
+    noteChaos = ChaosState(tNote,kNote);
+    dirChaos = ChaosState(tDir,kDir);
+
+    //norms etc. for the codebook search are worked out once here
+    noteIndex = CodebookIndex(BNote);
+    dirIndex = CodebookIndex(BDir);
+
+    //random stream for this model
+    gen = newRngStream();
 
 }
 
@@ -263,16 +289,18 @@ void FPM::queueNote(int note, double duration) {
     absSequence.push_back(note); //just the note
     if(note == 0) {
         noteSequence.emplace_back(note,duration);
+        keyTracker.addNote(note,duration);
         return; // nothing to add to direction sequence
     } else {
         noteSequence.emplace_back((note % 12) + 1,duration);
+        keyTracker.addNote((note % 12) + 1,duration);
     }
 
     if(previousNote != -1 && previousNote != note) {
         if(note > previousNote) {
-            dirSequence.push_back(1);
+            pushDirection(1);
         } else {
-            dirSequence.push_back(0);
+            pushDirection(0);
         }
 
         previousNote = note;
@@ -281,6 +309,15 @@ void FPM::queueNote(int note, double duration) {
     if(previousNote == -1) previousNote = note;
 }
 
+/**
+ * appends a direction and updates its chaos representation
+ * @param direction the new direction (0 down, 1 up)
+ */
+void FPM::pushDirection(int direction) {
+    dirSequence.push_back(direction);
+    dirChaos.append(direction);
+}
+
 /**
  * will generate a suitable response sequence
  * to that which has been queued up
@@ -288,16 +325,97 @@ void FPM::queueNote(int note, double duration) {
  * @return a matrix of notes and duration
  */
 MatrixXd FPM::combinedPredict() {
+    phraseContext context = preparePhrase();
+    return finishPhrase(generatePhrase(context,gen));
+}
+
+/**
+ * generates several candidate responses in parallel and returns the best
+ * @param candidates the number of candidates
+ * @param cost the cost function used to score candidates
+ * @param numThreads the number of threads to use (0 means one per core)
+ * @return a matrix of notes and duration
+ */
+MatrixXd FPM::combinedPredict(unsigned int candidates, phraseCost cost, unsigned int numThreads) {
+
+    if(candidates == 0) throw "At least one candidate phrase is needed";
+
+    phraseContext context = preparePhrase();
+
+    if(numThreads == 0) numThreads = max(1u, boost::thread::hardware_concurrency());
+    numThreads = min(numThreads, candidates);
+
+    vector<vector<int>> responses(candidates);
+    vector<double> costs(candidates, std::numeric_limits<double>::infinity());
+    shared_ptr<boost::mutex> lock = std::make_shared<boost::mutex>();
+    unsigned int nextCandidate = 0;
+    RngStream base = gen.split(gen());
+
+    boost::thread_group workers;
+    for(unsigned int i = 0; i < numThreads; i++) {
+        workers.create_thread(boost::bind(&FPM::candidateWorker, this, boost::cref(context), cost, boost::cref(base),
+                                          boost::cref(lock), boost::ref(nextCandidate),
+                                          boost::ref(responses), boost::ref(costs)));
+    }
+    workers.join_all();
+
+    //lowest cost wins, ties go to the earliest candidate
+    unsigned int best = 0;
+    for(unsigned int i = 1; i < candidates; i++) {
+        if(costs.at(i) < costs.at(best)) best = i;
+    }
+
+    return finishPhrase(responses.at(best));
+}
+
+/**
+ * generates candidates until there are none left
+ * @param context the context from preparePhrase
+ * @param cost the cost function for scoring
+ * @param base each candidate's stream is split off this by its index
+ * @param lock protects nextCandidate
+ * @param nextCandidate the next candidate to be generated
+ * @param responses where each candidate is written
+ * @param costs where each candidate's cost is written
+ */
+void FPM::candidateWorker(const phraseContext &context, phraseCost cost, const RngStream &base,
+                          const shared_ptr<boost::mutex> &lock, unsigned int &nextCandidate,
+                          vector<vector<int>> &responses, vector<double> &costs) const {
+    while(true) {
+
+        unsigned int candidate;
+        {
+            boost::lock_guard<boost::mutex> guard(*lock);
+            candidate = nextCandidate++;
+        }
+
+        if(candidate >= responses.size()) break;
+
+        //each candidate gets its own stream, whichever thread runs it
+        RngStream generator = base.split(candidate);
+
+        //each entry is only written by the thread which took the candidate
+        responses.at(candidate) = generatePhrase(context,generator);
+        costs.at(candidate) = cost(context.userPhrase,responses.at(candidate),context.endKey);
+    }
+}
+
+/**
+ * does the key detection and transposition on the queued phrase
+ * @return the context for generating responses
+ */
+FPM::phraseContext FPM::preparePhrase() {
 
     //due to timer, we may end on 0, and we don't want this
     if(absSequence.at(absSequence.size()-1) == 0) {
         absSequence.pop_back();
         noteSequence.pop_back();
+        keyTracker.removeLastNote();
         //due to way things are dealt with with direction, we don't need to pop from here
     }
 
-    //do the key detection on the users played phrase
-    vector<pair<pair<int,int>,string>> segmentsAndKeys = detectKey(noteSequence,SEGMENT_LENGTH,MODULATION_PENALTY);
+    //the key detection was kept up to date as the user played
+    vector<pair<pair<int,int>,string>> segmentsAndKeys = keyTracker.detect();
     vector<int> transposed; //will store transposed phrase
     vector<int> noDuration; // a temporary copy
 
@@ -314,35 +432,60 @@ MatrixXd FPM::combinedPredict() {
         transposed.insert(transposed.end(),currentSegment.begin(),currentSegment.end());
     }
 
+    phraseContext context;
+    context.userPhrase = absSequence;
+    context.endKey = segmentsAndKeys.at(segmentsAndKeys.size()-1).second; //get the key to transpose back to
+    context.outputLen = absSequence.size();
+    context.prevNote = absSequence.at(absSequence.size()-1);
+
+    //the transposition is only known now, so the note representation starts here
+    //from then on each generated note just moves the current point
+    noteChaos.reset();
+    for(int note : transposed) noteChaos.append(note);
+    context.noteStart = noteChaos;
+    context.dirStart = dirChaos;
 
-    string endKey = segmentsAndKeys.at(segmentsAndKeys.size()-1).second; //get the key to transpose back to
+    return context;
+}
+
+/**
+ * generates one response phrase, leaving the model untouched
+ * @param context the context from preparePhrase
+ * @param generator the random stream to use
+ * @return the absolute notes of the response
+ */
+vector<int> FPM::generatePhrase(const phraseContext &context, RngStream &generator) const {
 
     //now generate the note sequence
-    int outputLen = absSequence.size();
-    int startPointNote = transposed.size();
+    int outputLen = context.outputLen;
+    ChaosState notePoint = context.noteStart;
+    vector<int> generated;
+
     for(int i = 0; i < outputLen; i++) { //generate a sequence equal in size to that which the user played
-        transposed.push_back(predictNextNote(transposed,BNote,NNote,tNote,kNote));
+        int nextNote = predictNextNote(notePoint.point(),generator);
+        generated.push_back(nextNote);
+        notePoint.append(nextNote);
     }
 
     //now transpose back to the original key
-    transposed = transpose(transposed,"C",endKey);
-    vector<int> predictedSequence(transposed.begin()+startPointNote,transposed.end());
+    vector<int> predictedSequence = transpose(generated,"C",context.endKey);
 
     //now generate the direction sequence to generate the end sequence
-    int startPointOut = absSequence.size();
-    int prevNote = absSequence.at(absSequence.size()-1);
+    ChaosState dirPoint = context.dirStart;
+    vector<int> response;
+    int prevNote = context.prevNote;
     for(unsigned int i = 0; i < outputLen; i++) {
         int upInterval = mod((mod(predictedSequence.at(i) - 1,12) - mod(prevNote,12)),12);
-        int newDirection = predictNextDir(dirSequence,BDir,NDir,tDir,kDir,upInterval);
+        int newDirection = predictNextDir(dirPoint.point(),upInterval,generator);
 
         if(predictedSequence.at(i) == 0) { //silence
-            absSequence.push_back(0);
-            dirSequence.push_back(newDirection);
+            response.push_back(0);
+            dirPoint.append(newDirection);
         } else if(mod(predictedSequence.at(i)-1,12) == mod(prevNote,12)) { //same note
             //try again
             int newNote = prevNote;
-            int secondDraw = predictNextDir(dirSequence,BDir,NDir,tDir,kDir,upInterval);
-            dirSequence.push_back(newDirection);
+            int secondDraw = predictNextDir(dirPoint.point(),upInterval,generator);
+            dirPoint.append(newDirection);
 
             if(secondDraw == 1 && newDirection == 1) { //if both draws are the same, move in that direction
                 newNote += 12;
@@ -352,10 +495,10 @@ MatrixXd FPM::combinedPredict() {
                 if(newNote < 24) newNote = prevNote;
             }
 
-            absSequence.push_back(newNote);
+            response.push_back(newNote);
             prevNote = newNote;
         } else { //standard case
-            dirSequence.push_back(newDirection);
+            dirPoint.append(newDirection);
             int predictedMod = mod((predictedSequence.at(i)-1),12);
             int previousMod = mod(prevNote,12);
             int newNote;
@@ -369,16 +512,27 @@ MatrixXd FPM::combinedPredict() {
             if(newNote < 24) newNote += 12;
             if(newNote > 79) newNote -= 12;
 
-            absSequence.push_back(newNote);
+            response.push_back(newNote);
             prevNote = newNote;
         }
     }
 
+    return response;
+}
+
+/**
+ * puts a response into the form for returning and clears the state
+ * @param response the absolute notes of the response
+ * @return a matrix of notes and duration
+ */
+MatrixXd FPM::finishPhrase(const vector<int> &response) {
+
     //put into form for return value
+    auto outputLen = (unsigned int)response.size();
     MatrixXd returnPhrase = MatrixXd::Zero(outputLen,2);
     shuffle(noteSequence.begin(),noteSequence.end()-1,gen);
     for(unsigned int i = 0; i < outputLen; i++) {
-        returnPhrase(i,0) = absSequence.at(startPointOut + i);
+        returnPhrase(i,0) = response.at(i);
         returnPhrase(i,1) = noteSequence.at(i).second;
     }
     cout << "FINAL MATRIX: " << endl;
@@ -389,6 +543,15 @@ MatrixXd FPM::combinedPredict() {
     return returnPhrase;
 }
 
+/**
+ * changes the temperature NNote is tilted by
+ * @param TNote the new temperature
+ */
+void FPM::setNoteTemperature(double TNote) {
+    this->TNote = TNote;
+    buildSamplers();
+}
+
 /**
  * member function wipes the arrays for the next round of prediction etc.
  */
@@ -399,6 +562,9 @@ void FPM::clearState() {
     dirSequence.clear();
     //reinitialise
     previousNote = -1;
+    noteChaos.reset();
+    dirChaos.reset();
+    keyTracker.reset();
 }
 
 //SIMPLE GET FUNCTIONS
@@ -80,7 +80,7 @@ vector<int> transpose(vector<int> sequence, string srcKey, string dstKey) {
  * @param keyIndex the key as an integer
  * @return the dot product with the correct key profile
  */
-double getPitchKeyValue(VectorXd notesPresent, int keyIndex) {
+double getPitchKeyValue(const VectorXd &notesPresent, int keyIndex) {
     int startPoint = keyIndex - 1;
 
     double pitchVal = 0.0;
@@ -98,7 +98,7 @@ double getPitchKeyValue(VectorXd notesPresent, int keyIndex) {
  * @param segmentLength the maximum length of a segment
  * @return the segmented sequence
  */
-vector<vector<int>> splitIntoSegments(vector<pair<int,double>> sequence, double segmentLength) {
+vector<vector<int>> splitIntoSegments(const vector<pair<int,double>> &sequence, double segmentLength) {
     vector<vector<int>> segments;
     double segmentTime = 0.0;
     vector<int> currentSegment;
@@ -138,30 +138,119 @@ vector<vector<int>> splitIntoSegments(vector<pair<int,double>> sequence, double
  * @param segments the segmented note sequence
  * @return a pitch key vector for each segment
  */
-vector<VectorXd> getPitchKeyValues(vector<vector<int>> segments) {
+vector<VectorXd> getPitchKeyValues(const vector<vector<int>> &segments) {
     vector<VectorXd> pitchKeyVectors;
 
     //calculate for each segment
-    for(const auto &segment : segments) {
+    MatrixXd pitchKeyMatrix = getPitchKeyMatrix(segments);
+    for(int i = 0; i < pitchKeyMatrix.cols(); i++) {
+        pitchKeyVectors.emplace_back(pitchKeyMatrix.col(i)); //now we have the values for the nth segment
+    }
 
-        //form the input vector
-        VectorXd inputVector = VectorXd::Zero(12);
-        for(int note: segment) {
-            if (note != 0) { //if not silence
-                inputVector(note-1,0) = 1;
-            }
-        }
+    return pitchKeyVectors;
+}
+
+/**
+ * forms the set of pitch classes present in a segment
+ * @param segment the notes in the segment (1-12, 0 is silence)
+ * @return a mask with bit n-1 set if note n is present
+ */
+int pitchClassMask(const vector<int> &segment) {
+    int mask = 0;
+    for(int note : segment) {
+        if(note != 0) mask |= 1 << (note - 1); //if not silence
+    }
+    return mask;
+}
 
-        //now for each input vector, calculate the pitch key values for each of the 24 keys
-        VectorXd pitchKeyVals = VectorXd::Zero(NUM_KEYS);
-        for (int key = 1; key <= NUM_KEYS; key++) {
-            pitchKeyVals(key-1,0) = getPitchKeyValue(inputVector,key);
+/**
+ * builds the table of pitch key values for every set of pitch classes
+ * each mask's values are the values of the mask without its lowest note
+ * plus the values for that one note
+ * @return the NUM_ALL_KEYS x NUM_PITCH_MASKS table
+ */
+static MatrixXd buildPitchKeyTable() {
+
+    //the value each key gives each single note, i.e. the profiles rotated
+    MatrixXd rotated(NUM_ALL_KEYS,NUM_PITCH_CLASSES);
+    for(int key = 0; key < NUM_KEYS; key++) {
+        for(int note = 0; note < NUM_PITCH_CLASSES; note++) {
+            rotated(key,note) = majorProfile[mod(note - key,NUM_PITCH_CLASSES)];
+            rotated(key + NUM_KEYS,note) = minorProfile[mod(note - key,NUM_PITCH_CLASSES)];
         }
+    }
 
-        pitchKeyVectors.push_back(pitchKeyVals); //now we have the values for the nth segment
+    MatrixXd table = MatrixXd::Zero(NUM_ALL_KEYS,NUM_PITCH_MASKS);
+    for(int mask = 1; mask < NUM_PITCH_MASKS; mask++) {
+        int lowest = 0;
+        while(!(mask & (1 << lowest))) lowest++;
+        table.col(mask) = table.col(mask & (mask - 1)) + rotated.col(lowest);
     }
 
-    return pitchKeyVectors;
+    return table;
+}
+
+/**
+ * the pitch key value of every key for every set of pitch classes
+ * @return a NUM_ALL_KEYS x NUM_PITCH_MASKS table (major keys then minor keys)
+ */
+const MatrixXd &pitchKeyTable() {
+    static const MatrixXd table = buildPitchKeyTable();
+    return table;
+}
+
+/**
+ * gets the pitch key values for the major keys, for each segment
+ * @param segments the segmented note sequence
+ * @return a NUM_KEYS x segments matrix of pitch key values
+ */
+MatrixXd getPitchKeyMatrix(const vector<vector<int>> &segments) {
+    const MatrixXd &table = pitchKeyTable();
+
+    MatrixXd pitchKeyMatrix(NUM_KEYS,segments.size());
+    for(unsigned int i = 0; i < segments.size(); i++) {
+        pitchKeyMatrix.col(i) = table.col(pitchClassMask(segments.at(i))).head(NUM_KEYS);
+    }
+
+    return pitchKeyMatrix;
+}
+
+/**
+ * moves the dynamic programming on by one segment
+ * @param frontier the best sum ending in each key so far
+ * @param pitchKeyVals the pitch key values for the new segment
+ * @param modulationPenalty the penalty given for switching key
+ * @param newFrontier where to write the new best sums
+ * @param backPointers where to write the best previous key for each key
+ */
+void advanceKeyFrontier(const Ref<const VectorXd> &frontier, const Ref<const VectorXd> &pitchKeyVals,
+                        double modulationPenalty, Ref<VectorXd> newFrontier, Ref<VectorXi> backPointers) {
+
+    auto numKeys = (int)frontier.rows();
+
+    //best and second best previous keys (earliest index on ties)
+    int first = 0;
+    int second = -1;
+    for(int k = 1; k < numKeys; k++) {
+        if(frontier(k) > frontier(first)) {
+            second = first;
+            first = k;
+        } else if(second == -1 || frontier(k) > frontier(second)) {
+            second = k;
+        }
+    }
+
+    for(int j = 0; j < numKeys; j++) {
+        int other = (first != j) ? first : second;
+        double stay = frontier(j);
+        double change = (other == -1) ? stay - 1.0 : frontier(other) - modulationPenalty;
+
+        //on a tie the earlier key wins, as getBestSums looped upwards with a strict >
+        int best = (stay > change || (stay == change && j < other)) ? j : other;
+
+        newFrontier(j) = pitchKeyVals(j) + ((best == j) ? stay : change);
+        backPointers(j) = best;
+    }
 }
 
 /**
@@ -171,53 +260,71 @@ vector<VectorXd> getPitchKeyValues(vector<vector<int>> segments) {
  * @param modulationPenalty the penalty given for switching key
  * @return a vector of pairs listing the sum and the best index
  */
-vector<vector<pair<double,int>>> getBestSums(vector<VectorXd> pitchKeyVectors, double modulationPenalty) {
+vector<vector<pair<double,int>>> getBestSums(const vector<VectorXd> &pitchKeyVectors, double modulationPenalty) {
     vector<vector<pair<double,int>>> bestSums;
-    vector<pair<double,int>> firstStep;
 
     //deal with special case of start of path
-    for(int i = 0; i < pitchKeyVectors.at(0).rows(); i++) {
-        firstStep.emplace_back(pitchKeyVectors.at(0)(i,0),-1);
-    }
-
-    bestSums.push_back(firstStep);
-    //now deal with the rest of the path segments
-    vector<pair<double,int>> bestSumi;
-    for(unsigned int i = 1; i < pitchKeyVectors.size(); i++) {
-
-        for(int j = 0; j < pitchKeyVectors.at(i).rows(); j++) {
-            double bestJ = -1;
-            int bestJIndex = -1;
-
-            //do the dynamic programming bit
-            for(int unsigned k = 0; k < bestSums.at(i-1).size(); k++) {
-                double newSum = pitchKeyVectors.at(i)(j,0) + bestSums.at(i-1).at(k).first;
-                if(j != k) { //add penalty for changing key
-                    newSum -= modulationPenalty;
-                }
-
-                if(newSum > bestJ) {
-                    bestJ = newSum;
-                    bestJIndex = k;
-                }
-            }
-
-            bestSumi.emplace_back(bestJ,bestJIndex);
+    VectorXd frontier = pitchKeyVectors.at(0);
+    VectorXi backPointers = VectorXi::Constant(frontier.rows(),-1);
+    VectorXd newFrontier(frontier.rows());
+
+    for(unsigned int i = 0; i < pitchKeyVectors.size(); i++) {
+        if(i > 0) { //do the dynamic programming bit
+            advanceKeyFrontier(frontier,pitchKeyVectors.at(i),modulationPenalty,newFrontier,backPointers);
+            frontier.swap(newFrontier);
         }
 
+        vector<pair<double,int>> bestSumi;
+        for(int j = 0; j < frontier.rows(); j++) {
+            bestSumi.emplace_back(frontier(j),backPointers(j));
+        }
         bestSums.push_back(bestSumi);
-        bestSumi.clear();
     }
 
     return bestSums;
 }
 
+/**
+ * finds the best path of keys through a set of segments
+ * the sums and back pointers are kept in contiguous matrices
+ * @param pitchKeyMatrix the pitch key values (one column per segment)
+ * @param modulationPenalty the penalty given for switching key
+ * @return the best key index (0 based) for each segment
+ */
+vector<int> getBestKeyIndices(const MatrixXd &pitchKeyMatrix, double modulationPenalty) {
+    auto numSegments = (int)pitchKeyMatrix.cols();
+    vector<int> bestPath((unsigned long)numSegments);
+    if(numSegments == 0) return bestPath;
+
+    MatrixXd bestSums(pitchKeyMatrix.rows(),numSegments);
+    MatrixXi backPointers = MatrixXi::Constant(pitchKeyMatrix.rows(),numSegments,-1);
+
+    bestSums.col(0) = pitchKeyMatrix.col(0);
+    for(int i = 1; i < numSegments; i++) {
+        advanceKeyFrontier(bestSums.col(i-1),pitchKeyMatrix.col(i),modulationPenalty,
+                           bestSums.col(i),backPointers.col(i));
+    }
+
+    //the max at the end is the starting point (earliest on ties)
+    int key = 0;
+    for(int k = 1; k < bestSums.rows(); k++) {
+        if(bestSums(k,numSegments-1) > bestSums(key,numSegments-1)) key = k;
+    }
+
+    for(int i = numSegments - 1; i >= 0; i--) {
+        bestPath.at(i) = key;
+        key = backPointers(key,i);
+    }
+
+    return bestPath;
+}
+
 /**
  * function backtracks in order to retrieve the best path
  * @param bestSums likely the return value from getBestSums
  * @return the string of keys for each segment
  */
-vector<string> getBestPath(vector<vector<pair<double,int>>> bestSums) {
+vector<string> getBestPath(const vector<vector<pair<double,int>>> &bestSums) {
     vector<int> bestPath;
     double maxLast = -1;
     int maxLastIndex = -1;
@@ -259,20 +366,17 @@ vector<string> getBestPath(vector<vector<pair<double,int>>> bestSums) {
  * @param modulationPenalty the cost incurred by switching key
  * @return a vector with elements like (startPoint, endPoint, key) for each segment
  */
-vector<pair<pair<int,int>,string>> detectKey(vector<pair<int,double>> sequence,
+vector<pair<pair<int,int>,string>> detectKey(const vector<pair<int,double>> &sequence,
                                              double segmentLength, double modulationPenalty) {
 
     //first split into segments, will find closest to segmentLength
-    vector<vector<int>> segments = splitIntoSegments(std::move(sequence),segmentLength);
+    vector<vector<int>> segments = splitIntoSegments(sequence,segmentLength);
 
     //now generate the pitch key values for each segment
-    vector<VectorXd> pitchKeyVectors = getPitchKeyValues(segments);
+    MatrixXd pitchKeyMatrix = getPitchKeyMatrix(segments);
 
     //then take a dynamic programming approach to find the best solution
-    vector<vector<pair<double,int>>> bestSums = getBestSums(pitchKeyVectors, modulationPenalty);
-
-    //now back track and retrieve the best path of keys
-    vector<string> bestPath = getBestPath(bestSums);
+    vector<int> bestPath = getBestKeyIndices(pitchKeyMatrix, modulationPenalty);
 
     //segmentsAndKeys is a vector of (effectively) triples (startPoint, endPoint+1, key)
     vector<pair<pair<int,int>,string>> segmentsAndKeys;
@@ -280,10 +384,158 @@ vector<pair<pair<int,int>,string>> detectKey(vector<pair<int,double>> sequence,
     for(unsigned int i = 0; i < segments.size(); i++) {
         int currentEndPoint = currentStartPoint + segments.at(i).size();
         pair<int,int> startEnd(currentStartPoint,currentEndPoint);
-        segmentsAndKeys.emplace_back(startEnd,bestPath.at(i));
+        segmentsAndKeys.emplace_back(startEnd,valToKey(bestPath.at(i) + 1));
         currentStartPoint = currentEndPoint;
     }
 
     return segmentsAndKeys;
 
-}
\ No newline at end of file
+}
+
+/**
+ * implemented from keyDetect.h
+ * sets up an empty tracker
+ * @param segmentLength the maximum length of a segment
+ * @param modulationPenalty the cost incurred by switching key
+ */
+KeyTracker::KeyTracker(double segmentLength, double modulationPenalty) :
+        segmentLength(segmentLength), modulationPenalty(modulationPenalty) {
+    reset();
+}
+
+/**
+ * implemented from keyDetect.h
+ * empties the tracker for a new phrase
+ */
+void KeyTracker::reset() {
+    hasPending = false;
+    pending = make_pair(0,0.0);
+    openMask = 0;
+    openCount = 0;
+    segmentTime = 0.0;
+    frontier = VectorXd::Zero(0);
+    backPointers.clear();
+    segmentEnds.clear();
+    notesCommitted = 0;
+}
+
+/**
+ * implemented from keyDetect.h
+ * adds the next note played, committing the one before it
+ * @param note the note (1-12, 0 is silence)
+ * @param duration the duration of the note
+ */
+void KeyTracker::addNote(int note, double duration) {
+    if(hasPending) commitNote(pending.first,pending.second);
+    pending = make_pair(note,duration);
+    hasPending = true;
+}
+
+/**
+ * implemented from keyDetect.h
+ * removes the most recently added note
+ * @return true if there was a note to remove
+ */
+bool KeyTracker::removeLastNote() {
+    bool removed = hasPending;
+    hasPending = false;
+    return removed;
+}
+
+/**
+ * implemented from keyDetect.h
+ * the same splitting rules as splitIntoSegments
+ * @param note the note (1-12, 0 is silence)
+ * @param duration the duration of the note
+ */
+void KeyTracker::commitNote(int note, double duration) {
+
+    //if we reach the end of the segment
+    if(segmentTime + duration > segmentLength) {
+        if(openCount == 0) { //just place in its own segment
+            addToSegment(note);
+            closeSegment();
+            segmentTime = 0.0;
+        } else {
+            closeSegment();
+            addToSegment(note);
+            segmentTime = duration;
+        }
+    } else {
+        addToSegment(note);
+        segmentTime += duration;
+    }
+}
+
+/**
+ * implemented from keyDetect.h
+ * @param note the note added to the open segment (1-12, 0 is silence)
+ */
+void KeyTracker::addToSegment(int note) {
+    if(note != 0) openMask |= 1 << (note - 1); //if not silence
+    openCount++;
+    notesCommitted++;
+}
+
+/**
+ * implemented from keyDetect.h
+ * scores the open segment and moves the frontier on by one segment
+ */
+void KeyTracker::closeSegment() {
+
+    auto pitchKeyVals = pitchKeyTable().col(openMask).head(NUM_KEYS);
+
+    if(frontier.rows() == 0) { //start of the path
+        frontier = pitchKeyVals;
+    } else {
+        VectorXd newFrontier(NUM_KEYS);
+        VectorXi best(NUM_KEYS);
+        advanceKeyFrontier(frontier,pitchKeyVals,modulationPenalty,newFrontier,best);
+        frontier.swap(newFrontier);
+        backPointers.push_back(best);
+    }
+
+    segmentEnds.push_back(notesCommitted);
+    openMask = 0;
+    openCount = 0;
+}
+
+/**
+ * implemented from keyDetect.h
+ * finishes a copy of the tracker and backtracks
+ * @return a vector with elements like (startPoint, endPoint, key) for each segment
+ */
+vector<pair<pair<int,int>,string>> KeyTracker::detect() const {
+
+    KeyTracker finished(*this);
+    if(finished.hasPending) {
+        finished.commitNote(finished.pending.first,finished.pending.second);
+        finished.hasPending = false;
+    }
+    if(finished.openCount > 0) finished.closeSegment();
+
+    vector<pair<pair<int,int>,string>> segmentsAndKeys;
+    if(finished.segmentEnds.empty()) return segmentsAndKeys;
+
+    //best key at the end, earliest on ties (as in getBestPath)
+    int key = 0;
+    for(int k = 1; k < NUM_KEYS; k++) {
+        if(finished.frontier(k) > finished.frontier(key)) key = k;
+    }
+
+    auto numSegments = (int)finished.segmentEnds.size();
+    vector<int> path((unsigned long)numSegments);
+    for(int i = numSegments - 1; i >= 0; i--) {
+        path.at(i) = key;
+        if(i > 0) key = finished.backPointers.at(i - 1)(key);
+    }
+
+    int currentStartPoint = 0;
+    for(int i = 0; i < numSegments; i++) {
+        pair<int,int> startEnd(currentStartPoint,finished.segmentEnds.at(i));
+        segmentsAndKeys.emplace_back(startEnd,valToKey(path.at(i) + 1));
+        currentStartPoint = finished.segmentEnds.at(i);
+    }
+
+    return segmentsAndKeys;
+}
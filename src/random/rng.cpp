@@ -0,0 +1,62 @@
+/**
+ * file implements the functionality found within rng.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/random/rng.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+/**
+ * works out the seed to use if none has been set
+ * @return the seed from RNG_SEED_ENV, or a timestamp
+ */
+static uint64_t defaultSeed() {
+    const char *fromEnv = getenv(RNG_SEED_ENV);
+    if(fromEnv != nullptr && *fromEnv != '\0') {
+        return strtoull(fromEnv,nullptr,10);
+    }
+    return (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+}
+
+/**
+ * @return the global seed, set up on first use
+ */
+static std::atomic<uint64_t> &globalSeed() {
+    static std::atomic<uint64_t> seed(defaultSeed());
+    return seed;
+}
+
+/**
+ * @return the number of streams given out so far
+ */
+static std::atomic<uint64_t> &streamsGiven() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+/**
+ * implemented from rng.h
+ * @param seed the new global seed
+ */
+void setGlobalSeed(uint64_t seed) {
+    globalSeed() = seed;
+    streamsGiven() = 0;
+}
+
+/**
+ * implemented from rng.h
+ * @return the global seed
+ */
+uint64_t getGlobalSeed() {
+    return globalSeed();
+}
+
+/**
+ * implemented from rng.h
+ * @return the next stream split off the global seed
+ */
+RngStream newRngStream() {
+    return RngStream(getGlobalSeed()).split(streamsGiven()++);
+}
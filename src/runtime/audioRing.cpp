@@ -0,0 +1,383 @@
+/**
+ * file implements the functionality found within audioRing.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/audioRing.h"
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <boost/chrono.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <semaphore.h>
+#include <ctime>
+#include <cerrno>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AUDIO_RING_SSE
+#include <xmmintrin.h>
+#endif
+
+/**
+ * implemented from audioRing.h
+ * copies every stride-th sample into a contiguous buffer
+ * stereo input (the usual case) is done four samples at a time with SSE
+ * @param dst where to write the samples
+ * @param src the interleaved samples
+ * @param count the number of samples to copy
+ * @param stride the number of interleaved channels
+ */
+void deinterleave(float *dst, const float *src, long count, int stride) {
+    long i = 0;
+
+#ifdef AUDIO_RING_SSE
+    if(stride == 2) {
+        for(; i + 4 <= count; i += 4) {
+            __m128 lo = _mm_loadu_ps(src + 2 * i); //l0 r0 l1 r1
+            __m128 hi = _mm_loadu_ps(src + 2 * i + 4); //l2 r2 l3 r3
+            _mm_storeu_ps(dst + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))); //l0 l1 l2 l3
+        }
+    }
+#endif
+
+    for(; i < count; i++) {
+        dst[i] = src[i * stride];
+    }
+}
+
+/**
+ * implemented from audioRing.h
+ * adds some samples to the levels of a block, four at a time with SSE
+ * @param samples the samples
+ * @param count the number of samples
+ * @param quiet the quiet threshold (on the absolute value)
+ * @param loud the loud threshold (on the absolute value)
+ * @param level the levels to add to
+ */
+void measureBlock(const float *samples, long count, float quiet, float loud, blockLevel &level) {
+    long i = 0;
+    float sumSquares = 0.0f;
+    float peak = level.peak;
+
+#ifdef AUDIO_RING_SSE
+    static const int bitsSet[16] = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 quietVec = _mm_set1_ps(quiet);
+    const __m128 loudVec = _mm_set1_ps(loud);
+    __m128 sumVec = _mm_setzero_ps();
+    __m128 peakVec = _mm_set1_ps(peak);
+    for(; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(samples + i);
+        __m128 absX = _mm_andnot_ps(signMask, x);
+        sumVec = _mm_add_ps(sumVec, _mm_mul_ps(x, x));
+        peakVec = _mm_max_ps(peakVec, absX);
+        level.aboveQuiet += bitsSet[_mm_movemask_ps(_mm_cmpgt_ps(absX, quietVec))];
+        level.aboveLoud += bitsSet[_mm_movemask_ps(_mm_cmpgt_ps(absX, loudVec))];
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sumVec);
+    sumSquares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, peakVec);
+    for(float lane : lanes) peak = lane > peak ? lane : peak;
+#endif
+
+    for(; i < count; i++) {
+        float absX = fabs(samples[i]);
+        sumSquares += samples[i] * samples[i];
+        peak = absX > peak ? absX : peak;
+        if(absX > quiet) level.aboveQuiet++;
+        if(absX > loud) level.aboveLoud++;
+    }
+
+    level.count += count;
+    level.sumSquares += sumSquares;
+    level.peak = peak;
+}
+
+/**
+ * implemented from audioRing.h
+ * @param size the number of samples held, must be a power of 2
+ */
+AudioRing::AudioRing(unsigned long size) : data(size), mask(size - 1), writeIndex(0), claimIndex(0),
+                                            dataReady(nullptr), waiting(0) {
+    if(size == 0 || (size & (size - 1)) != 0) {
+        throw "Audio ring size must be a power of 2";
+    }
+
+#ifdef _WIN32
+    dataReady = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+    if(dataReady == nullptr) {
+        throw "Couldn't create the audio ring semaphore";
+    }
+#else
+    auto sem = new sem_t;
+    if(sem_init(sem, 0, 0) != 0) {
+        delete sem;
+        throw "Couldn't create the audio ring semaphore";
+    }
+    dataReady = sem;
+#endif
+}
+
+/**
+ * implemented from audioRing.h
+ * frees the semaphore
+ */
+AudioRing::~AudioRing() {
+#ifdef _WIN32
+    CloseHandle(dataReady);
+#else
+    sem_destroy((sem_t*)dataReady);
+    delete (sem_t*)dataReady;
+#endif
+}
+
+/**
+ * implemented from audioRing.h
+ * writes one channel of interleaved input into the ring
+ * @param in the interleaved input (channel 0 is written)
+ * @param frameCount the number of frames in the input
+ * @param stride the number of interleaved channels
+ */
+void AudioRing::write(const float *in, unsigned long frameCount, int stride) {
+    uint64_t start = writeIndex.load(memory_order_relaxed); //only this thread changes it
+    uint64_t end = start + frameCount;
+
+    //let readers know which samples are about to be overwritten
+    claimIndex.store(end, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    //anything more than a whole ring would only overwrite itself
+    unsigned long skip = frameCount > data.size() ? frameCount - (unsigned long)data.size() : 0;
+    uint64_t pos = start + skip;
+    const float *src = in + skip * stride;
+    unsigned long left = frameCount - skip;
+
+    //the space may wrap around the end of the ring, giving two regions
+    while(left > 0) {
+        unsigned long offset = (unsigned long)(pos & mask);
+        unsigned long chunk = min(left, (unsigned long)data.size() - offset);
+        deinterleave(data.data() + offset, src, (long)chunk, stride);
+        pos += chunk;
+        src += chunk * stride;
+        left -= chunk;
+    }
+
+    //publish the new samples, then check for sleeping readers
+    //both this and the reader's side are seq_cst, so either the reader sees
+    //the new samples before sleeping or this sees the reader and posts
+    writeIndex.store(end, memory_order_seq_cst);
+
+    //posting a semaphore never blocks, so the callback can't be held up here
+    int sleepers = waiting.load(memory_order_seq_cst);
+    for(int i = 0; i < sleepers; i++) {
+#ifdef _WIN32
+        ReleaseSemaphore(dataReady, 1, nullptr);
+#else
+        sem_post((sem_t*)dataReady);
+#endif
+    }
+}
+
+/**
+ * implemented from audioRing.h
+ * sleeps on the semaphore until it's posted or the timeout passes
+ * @param timeoutMs the longest to sleep in milliseconds
+ * @return true if the semaphore was posted
+ */
+bool AudioRing::sleep(long timeoutMs) const {
+    if(timeoutMs <= 0) return false;
+
+#ifdef _WIN32
+    return WaitForSingleObject(dataReady, (DWORD)timeoutMs) == WAIT_OBJECT_0;
+#else
+    timespec deadline{};
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int res;
+    do {
+        res = sem_timedwait((sem_t*)dataReady, &deadline);
+    } while(res != 0 && errno == EINTR);
+    return res == 0;
+#endif
+}
+
+/**
+ * implemented from audioRing.h
+ * @return the number of samples ever written to the ring
+ */
+uint64_t AudioRing::written() const {
+    return writeIndex.load(memory_order_acquire);
+}
+
+/**
+ * implemented from audioRing.h
+ * @return the number of samples the ring holds
+ */
+unsigned long AudioRing::capacity() const {
+    return (unsigned long)data.size();
+}
+
+/**
+ * implemented from audioRing.h
+ * @param ring the ring to read
+ */
+AudioRingReader::AudioRingReader(const AudioRing &ring) : ring(&ring), lost(0) {
+    uint64_t now = ring.written();
+    readIndex = now > ring.capacity() ? now - ring.capacity() : 0;
+}
+
+/**
+ * implemented from audioRing.h
+ * @return the number of samples waiting to be read
+ */
+unsigned long AudioRingReader::available() const {
+    return (unsigned long)min<uint64_t>(ring->written() - readIndex, ring->capacity());
+}
+
+/**
+ * implemented from audioRing.h
+ * skips any samples the producer has already overwritten
+ * @return the number of samples written so far
+ */
+uint64_t AudioRingReader::catchUp() {
+    uint64_t size = ring->capacity();
+    uint64_t end = ring->written();
+
+    //if the producer has lapped us, jump to the oldest sample still there
+    if(end - readIndex > size) {
+        lost += (end - readIndex) - size;
+        readIndex = end - size;
+    }
+
+    return end;
+}
+
+/**
+ * implemented from audioRing.h
+ * reads the next samples from the ring
+ * @param dst where to copy the samples
+ * @param count the maximum number of samples to read
+ * @return the number of samples read
+ */
+unsigned long AudioRingReader::read(float *dst, unsigned long count) {
+    const float *region1;
+    const float *region2;
+    unsigned long size1;
+    unsigned long size2;
+    unsigned long toRead = readRegions(count, region1, size1, region2, size2);
+    memcpy(dst, region1, size1 * sizeof(float));
+    memcpy(dst + size1, region2, size2 * sizeof(float));
+
+    //the producer may have started overwriting the oldest samples while they were copied
+    //if so, those samples can't be trusted and are dropped from the front of what was read
+    unsigned long torn = finishRead(toRead);
+    memmove(dst, dst + torn, (toRead - torn) * sizeof(float));
+    return toRead - torn;
+}
+
+/**
+ * implemented from audioRing.h
+ * sleeps until enough samples are waiting to be read, or until a timeout
+ * @param count the number of samples wanted
+ * @param timeoutMs the longest to wait in milliseconds
+ * @return true if count samples are now waiting
+ */
+bool AudioRingReader::wait(unsigned long count, long timeoutMs) const {
+    if(available() >= count) return true;
+
+    auto deadline = boost::chrono::steady_clock::now() + boost::chrono::milliseconds(timeoutMs);
+
+    //say we're asleep before checking again, so the producer can't miss us (see AudioRing::write)
+    ring->waiting.fetch_add(1, memory_order_seq_cst);
+    while(ring->writeIndex.load(memory_order_seq_cst) - readIndex < count) {
+        auto left = boost::chrono::duration_cast<boost::chrono::milliseconds>(
+                deadline - boost::chrono::steady_clock::now()).count();
+
+        //posts left over from readers which timed out just wake us early, so check again
+        if(!ring->sleep((long)left)) break;
+    }
+    ring->waiting.fetch_sub(1, memory_order_seq_cst);
+
+    return available() >= count;
+}
+
+/**
+ * implemented from audioRing.h
+ * gives direct access to the next samples, without copying them
+ * @param count the maximum number of samples wanted
+ * @param region1 set to the first region
+ * @param size1 set to the size of the first region
+ * @param region2 set to the second region (if any)
+ * @param size2 set to the size of the second region (0 if none)
+ * @return the number of samples in the two regions
+ */
+unsigned long AudioRingReader::readRegions(unsigned long count, const float *&region1, unsigned long &size1,
+                                           const float *&region2, unsigned long &size2) {
+    uint64_t end = catchUp();
+    auto toRead = (unsigned long)min<uint64_t>(count, end - readIndex);
+    auto offset = (unsigned long)(readIndex & ring->mask);
+
+    size1 = min(toRead, ring->capacity() - offset);
+    size2 = toRead - size1;
+    region1 = ring->data.data() + offset;
+    region2 = ring->data.data();
+
+    return toRead;
+}
+
+/**
+ * implemented from audioRing.h
+ * moves past samples given out by readRegions
+ * @param count the number of samples used
+ * @return how many of them were overwritten while in use
+ */
+unsigned long AudioRingReader::finishRead(unsigned long count) {
+    //the producer says which samples it's about to overwrite before it starts
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t claimed = ring->claimIndex.load(memory_order_relaxed);
+    uint64_t size = ring->capacity();
+    unsigned long torn = 0;
+    if(claimed > readIndex + size) {
+        torn = (unsigned long)min<uint64_t>(count, claimed - size - readIndex);
+    }
+
+    lost += torn;
+    readIndex += count;
+    return torn;
+}
+
+/**
+ * implemented from audioRing.h
+ * skips everything currently in the ring
+ */
+void AudioRingReader::skipToNow() {
+    readIndex = ring->written();
+}
+
+/**
+ * implemented from audioRing.h
+ * @return the total number of samples lost to overruns
+ */
+uint64_t AudioRingReader::overruns() const {
+    return lost;
+}
+
+/**
+ * implemented from audioRing.h
+ * @return the position of the next sample to read
+ */
+uint64_t AudioRingReader::position() const {
+    return readIndex;
+}
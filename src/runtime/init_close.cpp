@@ -32,13 +32,12 @@ pair<PaError, vector<pair<unsigned int, const PaDeviceInfo*>>> preInitSearch() {
  * or Pa_Initialize(), either is fine
  * @param sampleRate the sample rate of the input/output of the device
  * @param device the device being used for recording/playback
- * @param outHandle output handle for the midi stream
- * @param event the event handle for the midi stream
+ * @param midiOut where responses are played
  * @return an error code, and the new global state
  */
 pair<PaError, shared_ptr<globalState>> initSystem(unsigned int sampleRate,
                                                   pair<unsigned int,const PaDeviceInfo*> device,
-                                                  shared_ptr<HMIDISTRM> outHandle, shared_ptr<HANDLE> event) {
+                                                  shared_ptr<MidiSink> midiOut) {
 
     PaError err; // initially everything's fine
 
@@ -48,33 +47,13 @@ pair<PaError, shared_ptr<globalState>> initSystem(unsigned int sampleRate,
     shared_ptr<FPM> fpm(make_shared<FPM>(B_NOTE_PATH,N_NOTE_PATH,T_NOTE_PATH,K_NOTE,T_NOTE,
                                          B_DIR_PATH,N_DIR_PATH,T_DIR_PATH,K_DIR,T_DIR));
 
-    //allocate/initialise ring buffer
-    PaUtilRingBuffer ringUpdate{};
-    PaUtilRingBuffer ringTimer{};
-
-    void *ringDataUpdate = PaUtil_AllocateMemory(RING_ELEMENT * RING_SIZE); //port audio allocation functions
-    void *ringDataTimer = PaUtil_AllocateMemory(RING_ELEMENT * RING_SIZE);
-
-    ring_buffer_size_t sizeU = PaUtil_InitializeRingBuffer(&ringUpdate,RING_ELEMENT,RING_SIZE,ringDataUpdate);
-    ring_buffer_size_t sizeT = PaUtil_InitializeRingBuffer(&ringTimer,RING_ELEMENT,RING_SIZE,ringDataTimer);
-
-    if(sizeU == -1 || sizeT == -1) { //if something gone wrong
-        PaUtil_FreeMemory(ringDataUpdate);
-        PaUtil_FreeMemory(ringDataTimer);
-
-        return make_pair(paBufferTooSmall, nullptr);
-    }
-
-    //create callback data
-    shared_ptr<passToCallback> callbackData(std::make_shared<passToCallback>(ringUpdate,ringDataUpdate,
-                                                                        ringTimer,ringDataTimer));
+    //create callback data, allocating the ring shared by all readers of the audio
+    shared_ptr<passToCallback> callbackData(std::make_shared<passToCallback>(RING_SIZE));
 
     //open up stream
     PaStream *stream = nullptr;
     err = openStreamOnDevice(device,sampleRate,&stream,callbackData.get());
     if (err != paNoError) {
-        PaUtil_FreeMemory(ringDataUpdate);
-        PaUtil_FreeMemory(ringDataTimer);
         return make_pair(err, nullptr);
     }
     //the getting of the raw pointer is necessary here
@@ -82,16 +61,11 @@ pair<PaError, shared_ptr<globalState>> initSystem(unsigned int sampleRate,
     //set the running state of the system
     shared_ptr<atomic<bool>> running(std::make_shared<atomic<bool>>(true));
 
-    //create mutexes for use throughout the system
-    shared_ptr<boost::mutex> modelMutex(std::make_shared<boost::mutex>());
-    shared_ptr<boost::mutex> streamMutex(std::make_shared<boost::mutex>());
-
-    //initialise the condition variable
-    shared_ptr<boost::condition_variable_any> cond(std::make_shared<boost::condition_variable_any>());
+    //the update thread hands notes to the model through this queue, rather than locking the model
+    shared_ptr<NoteQueue> notes(std::make_shared<NoteQueue>());
 
     //combine into global state
-    shared_ptr<globalState> global(std::make_shared<globalState>(callbackData,fpm,stream,running,modelMutex,
-                                                                 streamMutex,cond,outHandle,event));
+    shared_ptr<globalState> global(std::make_shared<globalState>(callbackData,fpm,notes,stream,running,midiOut));
 
     //return global state with no errors found
     return make_pair(paNoError,global);
@@ -107,13 +81,10 @@ PaError destroySystem(shared_ptr<globalState> state) {
     PaError err;
 
     //close the stream (also acts as if abort had been called, all pending buffers are discarded)
-    state->streamMutex->lock(); //better safe than sorry...
+    //the threads reading it have been joined by now
     err = Pa_CloseStream(state->stream);
-    state->streamMutex->unlock();
 
-    //now deallocate the ring buffer (everything else dealt with by shared_ptr and port audio
-    PaUtil_FreeMemory(state->callbackData->ringDataUpdate);
-    PaUtil_FreeMemory(state->callbackData->ringDataTimer);
+    //the ring buffer (like everything else) is dealt with by shared_ptr and port audio
 
     //now terminate port audio
     /*if(err != paNoError) { //return the earliest error found
@@ -0,0 +1,67 @@
+/**
+ * file implements the functionality found within noteDetector.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/noteDetector.h"
+
+/**
+ * implemented from noteDetector.h
+ * @param notes the queue finished notes are pushed onto
+ * @param config the pitch tracker settings
+ */
+NoteDetector::NoteDetector(NoteQueue *notes, const pitchConfig &config) : tracker(config), notes(notes) {}
+
+/**
+ * implemented from noteDetector.h
+ * adds the next hop of audio
+ * @param hop hopSize() new samples
+ * @param endSample the position in the audio ring just after the hop
+ * @return the note heard in this hop (0 for silence)
+ */
+int NoteDetector::addHop(const float *hop, uint64_t endSample) {
+
+    double freq = tracker.addHop(hop);
+    int newNote = noteMap.closestNote(freq); //what's being played right now?
+
+    //has a note just finished?
+    pair<int,int> finished = segmenter.addNote(newNote);
+    if(finished.first != -1) {
+
+        //how long was the note played for?
+        double duration = finished.second * tracker.hopDuration();
+
+        //the note ended where whatever is playing now began
+        uint64_t noteEnd = endSample - (uint64_t)segmenter.currentLength() * tracker.hopSize();
+
+        notes->push(noteEvent(finished.first,duration,noteEnd));
+    }
+
+    return newNote;
+}
+
+/**
+ * implemented from noteDetector.h
+ * forgets everything heard so far
+ */
+void NoteDetector::reset() {
+    tracker.reset();
+    segmenter.reset();
+}
+
+/**
+ * implemented from noteDetector.h
+ * @return the number of samples in a hop
+ */
+int NoteDetector::hopSize() const {
+    return tracker.hopSize();
+}
+
+/**
+ * implemented from noteDetector.h
+ * @param hook the function (nullptr to stop timing)
+ * @param userData passed to the hook on each call
+ */
+void NoteDetector::setTimingHook(analysisHook hook, void *userData) {
+    tracker.setTimingHook(hook,userData);
+}
@@ -0,0 +1,67 @@
+/**
+ * file implements the functionality found within noteMap.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/noteMap.h"
+#include <cmath>
+
+/**
+ * implemented from noteMap.h
+ * @param referenceFreq frequency of the reference note in Hz
+ * @param reference the number of the reference note
+ * @param lowest lowest note which can be returned
+ * @param highest highest note which can be returned
+ */
+NoteMap::NoteMap(double referenceFreq, int reference, int lowest, int highest) :
+        referenceFreq(referenceFreq), reference(reference), lowest(lowest), highest(highest) {
+    if(referenceFreq <= 0.0) {
+        throw "Note reference frequency must be positive";
+    }
+    if(highest - lowest < 11) {
+        throw "Note range must cover at least an octave";
+    }
+}
+
+/**
+ * implemented from noteMap.h
+ * finds the closest note to a frequency, and how far out it is
+ * @param freq the frequency in Hz
+ * @return the note (0 if freq isn't positive) and the offset of freq from it in cents
+ */
+pair<int,double> NoteMap::quantise(double freq) const {
+    if(!(freq > 0.0) || std::isinf(freq)) return make_pair(0,0.0); //also catches NaN
+
+    double semitones = reference + 12.0 * log2(freq / referenceFreq);
+    double nearest = ceil(semitones - 0.5); //halfway between goes to the lower note
+    double cents = 100.0 * (semitones - nearest);
+
+    //move into range by whole octaves
+    auto note = (int)nearest;
+    if(note < lowest) {
+        note += 12 * ((lowest - note + 11) / 12);
+    } else if(note > highest) {
+        note -= 12 * ((note - highest + 11) / 12);
+    }
+
+    return make_pair(note,cents);
+}
+
+/**
+ * implemented from noteMap.h
+ * finds the closest note to a frequency
+ * @param freq the frequency in Hz
+ * @return the note, or 0 if freq isn't positive
+ */
+int NoteMap::closestNote(double freq) const {
+    return quantise(freq).first;
+}
+
+/**
+ * implemented from noteMap.h
+ * @param note a note number
+ * @return the frequency of the note in Hz
+ */
+double NoteMap::frequency(int note) const {
+    return referenceFreq * exp2((note - reference) / 12.0);
+}
@@ -0,0 +1,99 @@
+/**
+ * file implements the functionality found within noteQueue.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/noteQueue.h"
+
+/**
+ * implemented from noteQueue.h
+ * @param size the number of notes which can be waiting, must be a power of 2
+ */
+NoteQueue::NoteQueue(unsigned long size) : events(size), mask(size - 1), head(0), tail(0), dropped(0), heardUpTo(0) {
+    if(size == 0 || (size & (size - 1)) != 0) {
+        throw "Note queue size must be a power of 2";
+    }
+}
+
+/**
+ * implemented from noteQueue.h
+ * adds a note to the queue
+ * @param event the note to add
+ * @return false if the queue was full
+ */
+bool NoteQueue::push(const noteEvent &event) {
+    unsigned long t = tail.load(memory_order_relaxed);
+    if(t - head.load(memory_order_acquire) == events.size()) {
+        dropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    events[t & mask] = event;
+    tail.store(t + 1, memory_order_release); //publish the note
+    return true;
+}
+
+/**
+ * implemented from noteQueue.h
+ * takes the oldest note off the queue
+ * @param event set to the note taken off
+ * @return false if the queue was empty
+ */
+bool NoteQueue::pop(noteEvent &event) {
+    unsigned long h = head.load(memory_order_relaxed);
+    if(h == tail.load(memory_order_acquire)) return false;
+
+    event = events[h & mask];
+    head.store(h + 1, memory_order_release); //free the slot
+    return true;
+}
+
+/**
+ * implemented from noteQueue.h
+ * takes the oldest note off the queue if it finished before a point in the audio
+ * @param sample the position in the audio ring
+ * @param event set to the note taken off
+ * @return false if the queue was empty or the oldest note finished later
+ */
+bool NoteQueue::popBefore(uint64_t sample, noteEvent &event) {
+    unsigned long h = head.load(memory_order_relaxed);
+    if(h == tail.load(memory_order_acquire)) return false;
+    if(events[h & mask].endSample > sample) return false; //leave it for the next phrase
+
+    event = events[h & mask];
+    head.store(h + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * implemented from noteQueue.h
+ * records how far through the audio the producer has listened
+ * @param sample the position in the audio ring
+ */
+void NoteQueue::markHeard(uint64_t sample) {
+    heardUpTo.store(sample, memory_order_release);
+}
+
+/**
+ * implemented from noteQueue.h
+ * @return the position in the audio ring the producer has listened up to
+ */
+uint64_t NoteQueue::heard() const {
+    return heardUpTo.load(memory_order_acquire);
+}
+
+/**
+ * implemented from noteQueue.h
+ * @return the number of notes waiting
+ */
+unsigned long NoteQueue::size() const {
+    return tail.load(memory_order_acquire) - head.load(memory_order_acquire);
+}
+
+/**
+ * implemented from noteQueue.h
+ * @return the number of notes dropped because the queue was full
+ */
+unsigned long NoteQueue::droppedCount() const {
+    return dropped.load(memory_order_relaxed);
+}
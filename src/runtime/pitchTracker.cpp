@@ -0,0 +1,222 @@
+/**
+ * file implements the functionality found within pitchTracker.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/pitchTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+
+/**
+ * implemented from pitchTracker.h
+ * @param config the settings of the tracker
+ */
+PitchTracker::PitchTracker(const pitchConfig &config) : config(config), hook(nullptr), hookData(nullptr) {
+    if(config.hopSize <= 0 || config.hopSize > config.windowSize) {
+        throw "Pitch tracker hop must be between 1 and the window size";
+    }
+
+    minLag = max(2, (int)floor(config.sampleRate / config.maxFreq));
+    maxLag = (int)ceil(config.sampleRate / config.minFreq);
+    span = config.windowSize - maxLag;
+    if(span < maxLag || minLag >= maxLag) {
+        throw "Pitch tracker window too short for the lowest frequency";
+    }
+
+    //for lags up to maxLag the span never reaches past the window,
+    //so a circular correlation of the window's length is enough
+    int nfft = 1;
+    while(nfft < config.windowSize) nfft *= 2;
+
+    fft.SetFlag(Eigen::FFT<float>::HalfSpectrum);
+    window.assign((unsigned long)config.windowSize, 0.0f);
+    padded.assign((unsigned long)nfft, 0.0f);
+    windowSpec.resize((unsigned long)(nfft / 2 + 1));
+    spanSpec.resize((unsigned long)(nfft / 2 + 1));
+    correlation.resize((unsigned long)nfft);
+    energy.resize((unsigned long)config.windowSize + 1);
+    diff.resize((unsigned long)maxLag + 1);
+}
+
+/**
+ * implemented from pitchTracker.h
+ * moves the window along by a hop and estimates the pitch
+ * @param hop the hopSize newest samples
+ * @return the estimated frequency in Hz, or 0 if silent/unpitched
+ */
+double PitchTracker::addHop(const float *hop) {
+    auto start = chrono::steady_clock::now();
+
+    int keep = config.windowSize - config.hopSize;
+    memmove(window.data(), window.data() + config.hopSize, keep * sizeof(float));
+    memcpy(window.data() + keep, hop, config.hopSize * sizeof(float));
+    double freq = estimate();
+
+    if(hook != nullptr) {
+        hook(chrono::duration<double>(chrono::steady_clock::now() - start).count(), hookData);
+    }
+
+    return freq;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * runs YIN over the current window
+ * @return the estimated frequency in Hz, or 0 if silent/unpitched
+ */
+double PitchTracker::estimate() {
+    int n = config.windowSize;
+
+    //running sum of squares, for the energy terms of the difference function
+    energy.at(0) = 0.0;
+    for(int i = 0; i < n; i++) {
+        energy[i + 1] = energy[i] + (double)window[i] * window[i];
+    }
+    if(sqrt(energy[n] / n) < config.silenceRms) return 0.0;
+
+    //cross correlation of the first span samples with the window, by fft
+    auto nfft = (int)padded.size();
+    copy(window.begin(), window.end(), padded.begin());
+    fill(padded.begin() + n, padded.end(), 0.0f);
+    fft.fwd(windowSpec.data(), padded.data(), nfft);
+
+    fill(padded.begin() + span, padded.end(), 0.0f);
+    fft.fwd(spanSpec.data(), padded.data(), nfft);
+
+    for(unsigned long k = 0; k < windowSpec.size(); k++) {
+        windowSpec[k] *= conj(spanSpec[k]);
+    }
+    fft.inv(correlation.data(), windowSpec.data(), nfft);
+
+    //difference function d(t) = sum (x_j - x_j+t)^2 = E(0) + E(t) - 2r(t)
+    //normalised by its cumulative mean as it goes
+    diff.at(0) = 1.0;
+    double runningSum = 0.0;
+    for(int lag = 1; lag <= maxLag; lag++) {
+        double d = energy[span] + (energy[lag + span] - energy[lag]) - 2.0 * correlation[lag];
+        d = max(d, 0.0); //rounding can take it just below
+        runningSum += d;
+        diff[lag] = runningSum > 0.0 ? d * lag / runningSum : 1.0;
+    }
+
+    //first dip below the threshold, followed down to the bottom of that dip
+    int best = -1;
+    for(int lag = minLag; lag < maxLag; lag++) {
+        if(diff[lag] < config.threshold) {
+            while(lag + 1 < maxLag && diff[lag + 1] < diff[lag]) lag++;
+            best = lag;
+            break;
+        }
+    }
+    if(best == -1) return 0.0; //nothing periodic enough
+
+    //parabolic interpolation between lags
+    double before = diff[best - 1];
+    double at = diff[best];
+    double after = diff[best + 1];
+    double denom = before - 2.0 * at + after;
+    double shift = denom != 0.0 ? 0.5 * (before - after) / denom : 0.0;
+
+    return config.sampleRate / (best + shift);
+}
+
+/**
+ * implemented from pitchTracker.h
+ * clears the window back to silence
+ */
+void PitchTracker::reset() {
+    fill(window.begin(), window.end(), 0.0f);
+}
+
+/**
+ * implemented from pitchTracker.h
+ * @return the number of samples to pass to each addHop
+ */
+int PitchTracker::hopSize() const {
+    return config.hopSize;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * @return the length of a hop in seconds
+ */
+double PitchTracker::hopDuration() const {
+    return config.hopSize / config.sampleRate;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * @param newHook the function (nullptr to stop timing)
+ * @param userData passed to the hook on each call
+ */
+void PitchTracker::setTimingHook(analysisHook newHook, void *userData) {
+    hook = newHook;
+    hookData = userData;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * @param stableHops hops a new note must last before it's accepted
+ */
+NoteSegmenter::NoteSegmenter(int stableHops) : stableHops(max(1, stableHops)) {
+    reset();
+}
+
+/**
+ * implemented from pitchTracker.h
+ * adds the next estimate
+ * @param note the note heard in this hop (0 for silence)
+ * @return the note which has just finished and its length in hops, or (-1,0)
+ */
+pair<int,int> NoteSegmenter::addNote(int note) {
+    if(current == -1 && note == 0) { //don't accept initial silence as a note
+        pending = -1;
+        pendingHops = 0;
+        return make_pair(-1,0);
+    }
+
+    if(note == current) { //a glitch which didn't last, it belongs to the current note
+        currentHops += pendingHops + 1;
+        pending = -1;
+        pendingHops = 0;
+        return make_pair(-1,0);
+    }
+
+    if(note != pending) { //a different possible note, the last one didn't last
+        currentHops += pendingHops;
+        pending = note;
+        pendingHops = 0;
+    }
+    pendingHops++;
+
+    if(pendingHops < stableHops) return make_pair(-1,0);
+
+    //the new note has lasted, so the current one has finished
+    pair<int,int> finished = current == -1 ? make_pair(-1,0) : make_pair(current,currentHops);
+    current = pending;
+    currentHops = pendingHops;
+    pending = -1;
+    pendingHops = 0;
+    return finished;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * @return hops heard since the last finished note ended
+ */
+int NoteSegmenter::currentLength() const {
+    return currentHops + pendingHops;
+}
+
+/**
+ * implemented from pitchTracker.h
+ * forgets everything, as if nothing had been played
+ */
+void NoteSegmenter::reset() {
+    current = -1;
+    currentHops = 0;
+    pending = -1;
+    pendingHops = 0;
+}
@@ -6,6 +6,7 @@
 
 #include "../../include/runtime/port_processing.h"
 #include <iostream>
+
 /**
  * implemented from port_processing.h
  * callback function for port audio stream
@@ -21,21 +22,15 @@ int audioCallback(const void *input, void *output, unsigned long frameCount,
                   const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags,
                   void *userData) {
     auto *info = (passToCallback*)userData; //cast from void pointer
-    auto *in = (float*)input;
+    auto *in = (const float*)input;
     (void) timeInfo; //tip from port audio examples, stops IDE from moaning at me
     (void) statusFlags;
     (void) output;
 
-    //loop through frames in input and copy when appropriate
-    for(int i = 0; i < frameCount; i++) {
-        PaUtil_WriteRingBuffer(&(info->ringUpdate),in,1); //write to update ring buffer
-        //write to timer buffer as well as update buffer
-        //update buffer currently being written to at a different sample rate
-        PaUtil_WriteRingBuffer(&(info->ringTimer),in,1);
-
-        in += 2;
+    if(in == nullptr) return paContinue; //no input this time (e.g. an input underflow)
 
-    }
+    //write channel 0 of the whole buffer to the ring, each consumer reads it from there
+    info->ring.write(in, frameCount, info->channelCount);
 
     return paContinue; //0
 }
@@ -80,6 +75,9 @@ PaError openStreamOnDevice(pair<unsigned int, const PaDeviceInfo*> device, int s
     inParams.suggestedLatency = device.second->defaultLowInputLatency;
 
 
+    //the callback needs to know how the samples are interleaved
+    callbackData->channelCount = inParams.channelCount;
+
     PaError err = Pa_IsFormatSupported(&inParams,nullptr,sampleRate);
     if(err != paFormatIsSupported) {
         std::cout << Pa_GetErrorText(err) << std::endl;
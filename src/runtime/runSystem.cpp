@@ -6,6 +6,7 @@
 #include "../../include/runtime/timerThread.h"
 #include "../../include/runtime/updateThread.h"
 #include "../../include/runtime/init_close.h"
+#include "../../include/midi/winMidiSink.h"
 #include <cstring>
 #include <iostream>
 
@@ -29,35 +30,22 @@ int main() {
  */
 PaError runSystem() {
 
-    unsigned long err = 0;
     PaError paErr = paNoError;
 
-    //Step 1: create the event for midi stream notifications
-    shared_ptr<HANDLE> event = make_shared<HANDLE>();
-    *event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if(!(*event)) return 1;
-
-    //Step 2: open the midi stream on the default MIDI device
-    shared_ptr<HMIDISTRM> outHandle = make_shared<HMIDISTRM>();
-    err = midiStreamOpen(outHandle.get(), (LPUINT)&err, 1, (DWORD)(*event), 0, CALLBACK_EVENT);
-    if(err) {
-        CloseHandle(*event);
-        return (PaError)err;
-    }
-    ResetEvent(*event); //event gets notified after opening, clear this
+    //Step 1: open the default MIDI device, the sink closes it again when it goes
+    shared_ptr<WinMidiSink> midiOut = make_shared<WinMidiSink>();
+    if(!midiOut->isOpen()) return 1;
 
-    //Step 3: Initialise portAudio
+    //Step 2: Initialise portAudio
     pair<PaError, vector<pair<unsigned int, const PaDeviceInfo*>>> devicesPaired = preInitSearch();
 
     if(devicesPaired.first != paNoError) {
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
         return devicesPaired.first;
     }
 
     vector<pair<unsigned int, const PaDeviceInfo*>> devices = devicesPaired.second;
 
-    //Step 4: Find desired device (will change once GUI added)
+    //Step 3: Find desired device (will change once GUI added)
     unsigned int desiredDevice = devices.size();
     for(unsigned int i = 0; i < devices.size(); i++) {
         if(strstr((devices.at(i).second->name),MY_DEVICE) != nullptr) { //if contained
@@ -66,53 +54,39 @@ PaError runSystem() {
     }
     if(desiredDevice == devices.size()) { //if device couldn't be found
         Pa_Terminate(); //best effort attempt to gracefully close system
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
         return 1;
     }
 
-    //Step 5: Initialise System
-    pair<PaError,shared_ptr<globalState>> global = initSystem(44100,devices.at(desiredDevice),outHandle,event);
+    //Step 4: Initialise System
+    pair<PaError,shared_ptr<globalState>> global = initSystem(44100,devices.at(desiredDevice),midiOut);
     if(global.first != paNoError) {
         Pa_Terminate(); //if this goes wrong, there's nothing I can do
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
         return global.first;
     }
 
-    //Step 6: Start PortAudio Stream
+    //Step 5: Start PortAudio Stream
     if((paErr = Pa_StartStream(global.second->stream)) != paNoError){
         destroySystem(global.second); //try to clean up as best I can
         Pa_Terminate();
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
         return paErr;
     }
 
     boost::thread updateThread(updateWorker, boost::cref(global.second));
     boost::thread timerThread(timerWorker, boost::cref(global.second), nullptr);
 
-    //Step 8: Join the threads
+    //Step 6: Join the threads
     updateThread.join();
     timerThread.join();
 
-    //Step 9: destroy the system state
+    //Step 7: destroy the system state
     if((paErr = destroySystem(global.second))) {
         Pa_Terminate();
-        midiStreamClose(*outHandle);
-        CloseHandle(*event);
         return paErr;
     }
 
-    //Step 10: terminate port audio
+    //Step 8: terminate port audio
     paErr = Pa_Terminate();
 
-    //Step 11: Close the Midi Stream
-    midiStreamClose(*outHandle);
-
-    //Step 12: Close the Event Handle
-    CloseHandle(*event);
-
     return paErr;
 
 }
\ No newline at end of file
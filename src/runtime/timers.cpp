@@ -6,71 +6,440 @@
 
 
 #include "../../include/runtime/timers.h"
-#include <cmath>
-#include <iostream>
-
-/**
- * implemented from timers.h
- * this is the first attempt at a timer
- * this should be improved once the system is running
- * @param ring the ring buffer to be read from
- * @param bridge the bridge to the gui
- * @param state the global state of the system
- */
-void silenceTimer(PaUtilRingBuffer *ring, Bridge *bridge, shared_ptr<atomic<bool>> running) {
-    bool playingStarted = false;
-    bool keepLooping = true;
-    int anomalies = 0;
-    int sampleCount = 0;
-
-    while(keepLooping && *running) {
-
-        ring_buffer_size_t elementsToRead = PaUtil_GetRingBufferReadAvailable(ring);
-        if(elementsToRead == 0) continue; // if nothing to read then don't bother allocating
-        auto *read = new float[elementsToRead];
-        ring_buffer_size_t inArr = PaUtil_ReadRingBuffer(ring,read,elementsToRead);
-
-        for (int i = 0; i < inArr; i++) {
-            double absVal = fabs(read[i]);
-            if(bridge != nullptr) bridge->volumeUpdate(absVal);
-
-            if(playingStarted) { //try to detect when the user has stopped playing
-
-                if(absVal < SILENCE_THRESHOLD) { //if we have a value close to silence
-                    sampleCount++;
-                    if(anomalies) anomalies = 0;
-                } else { //if its slightly louder, it may just be an anomaly...
-                    if(anomalies <= ANOMALY_MAX) {
-                        anomalies++;
-                        sampleCount++;
-                    } else { //if we've surpassed the number of allowed anomalies
-                        anomalies = 0;
-                        sampleCount = 0;
-                    }
-                }
+#include <boost/thread.hpp>
+#include <algorithm>
 
-                if(sampleCount >= SAMPLES_TILL_STOP) {
-                    keepLooping = false;
-                    std::cout << "TRIGGERED" << std::endl;
-                    break; //leave the for loop, deallocate the array, and then leave while loop
-                }
+/**
+ * implemented from timers.h
+ * constructor starts off waiting for the user
+ */
+TurnTaker::TurnTaker() {
+    reset();
+}
+
+/**
+ * implemented from timers.h
+ * counts loud samples until the user is judged to have started
+ * @param level the levels of the block
+ * @param endSample the position just after the block
+ * @return true if the user has started playing
+ */
+bool TurnTaker::listenForStart(const blockLevel &level, uint64_t endSample) {
+
+    //a block without any loud samples ends whatever was being counted
+    if(level.aboveLoud == 0) {
+        loudCount = 0;
+        loudSince = endSample;
+        return false;
+    }
+
+    //over the response, the loud samples have to keep coming for the user to have started
+    double threshold = START_THRESHOLD;
+    if(state == responding) {
+        loudCount *= ONSET_DECAY;
+        threshold = RESPONSE_START_THRESHOLD;
+    }
+
+    loudCount += level.aboveLoud;
+    if(loudCount > threshold) {
+        userStart = loudSince;
+        loudCount = 0;
+        quietCount = 0;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * implemented from timers.h
+ * moves the state along with the next block of audio
+ * @param level the levels of the block
+ * @param endSample the position just after the block
+ * @return whether the user started or finished a phrase in this block
+ */
+turnEvent TurnTaker::addBlock(const blockLevel &level, uint64_t endSample) {
+
+    if(state == waitingForUser || (state == responding && !userAhead)) { //detect when the user has started playing
+        if(listenForStart(level, endSample)) {
+            if(state == waitingForUser) {
+                state = userPlaying;
+            } else {
+                userAhead = true; //they'll have the turn once the response is done
+            }
+            return userStarted;
+        }
+        return noTurnEvent;
+    }
+
+    //try to detect when the user has stopped playing
+    //a few louder samples in a block may just be anomalies
+    if(level.aboveQuiet <= ANOMALY_MAX) {
+        quietCount += level.count;
+    } else {
+        quietCount = 0;
+    }
+
+    //a phrase started during the response can't finish until the response has
+    if(state == userPlaying && quietCount >= SAMPLES_TILL_STOP) {
+        phraseEnd = endSample - quietCount;
+        state = responding;
+        userAhead = false;
+        loudCount = 0;
+        loudSince = endSample;
+        return userFinished;
+    }
+
+    return noTurnEvent;
+}
+
+/**
+ * implemented from timers.h
+ * tells the turn taker the response has finished playing
+ */
+void TurnTaker::responseFinished() {
+    state = userAhead ? userPlaying : waitingForUser;
+    userAhead = false;
+    loudCount = 0;
+}
+
+/**
+ * implemented from timers.h
+ * @return the threshold the next block's loud samples should be measured against
+ */
+float TurnTaker::loudThreshold() const {
+    return state == responding && !userAhead ? RESPONSE_NOISE_THRESHOLD : NOISE_THRESHOLD;
+}
+
+/**
+ * implemented from timers.h
+ * @return whose turn it is
+ */
+turnState TurnTaker::getState() const {
+    return state;
+}
+
+/**
+ * implemented from timers.h
+ * @return the position where the user's current (or last) phrase began
+ */
+uint64_t TurnTaker::getUserStart() const {
+    return userStart;
+}
 
-            } else { //detect when the user has started playing
-                if(absVal > NOISE_THRESHOLD) {
-                    if(++sampleCount > START_THRESHOLD) {
-                        sampleCount = 0;
-                        playingStarted = true;
-                        std::cout << "Playing started" << std::endl;
-                    }
+/**
+ * implemented from timers.h
+ * @return the position where the user's last phrase ended
+ */
+uint64_t TurnTaker::getPhraseEnd() const {
+    return phraseEnd;
+}
 
-                } else { //if back to silence
-                    //sampleCount = 0;
+/**
+ * implemented from timers.h
+ * goes back to waiting for the user
+ */
+void TurnTaker::reset() {
+    state = waitingForUser;
+    userAhead = false;
+    loudCount = 0;
+    quietCount = 0;
+    loudSince = 0;
+    userStart = 0;
+    phraseEnd = 0;
+}
+
+/**
+ * implemented from timers.h
+ * takes the notes of the user's phrase off the note queue, up to a point in the audio
+ * @param notes the queue of detected notes
+ * @param upTo notes finishing before here are taken
+ * @param phrase the notes taken are added to the end of this
+ * @return the number of notes added
+ */
+int takePhraseNotes(NoteQueue &notes, uint64_t upTo, vector<noteEvent> &phrase) {
+    int added = 0;
+    noteEvent played;
+    while(notes.popBefore(upTo,played)) {
+        if(phrase.empty() && played.note == 0) continue; //the silence before the phrase isn't part of it
+        phrase.push_back(played);
+        added++;
+    }
+    return added;
+}
+
+/**
+ * implemented from timers.h
+ * works out where each note of a response will be heard in the audio
+ * @param events the midi messages of the response, timed from its start
+ * @param start where in the audio the response starts playing
+ * @param sampleRate samples of audio per second of response
+ * @return the notes of the response
+ */
+vector<responseNote> placeResponse(const vector<midiEvent> &events, uint64_t start, double sampleRate) {
+    vector<responseNote> response;
+    for(const midiEvent &event : events) {
+        auto position = start + (uint64_t)(event.time * sampleRate);
+        int note = (int)event.data1 - NOTE_OFFSET;
+        if((event.status & 0xF0) == NOTE_ON && event.data2 > 0) {
+            response.emplace_back(note, position, position);
+        } else if((event.status & 0xF0) == NOTE_OFF || (event.status & 0xF0) == NOTE_ON) {
+            for(auto it = response.rbegin(); it != response.rend(); ++it) { //the latest note on for it
+                if(it->note == note) {
+                    it->end = position;
+                    break;
                 }
             }
         }
+    }
+    return response;
+}
 
-        delete [] read;
+/**
+ * implemented from timers.h
+ * once the response has finished, takes everything heard while it played off the note queue
+ * @param notes the queue of detected notes
+ * @param userStart where the user started playing over the response (responseEnd if they didn't)
+ * @param responseEnd where the response finished in the audio
+ * @param response the notes of the response, from placeResponse
+ * @param phrase the user's notes are added to the end of this
+ * @param dropped if not nullptr, the notes thrown away are added to the end of this
+ * @return the number of notes thrown away
+ */
+int dropResponseNotes(NoteQueue &notes, uint64_t userStart, uint64_t responseEnd, const vector<responseNote> &response,
+                      vector<noteEvent> &phrase, vector<noteEvent> *dropped) {
+    int thrownAway = 0;
+    noteEvent heard;
+    while(notes.popBefore(responseEnd,heard)) {
+
+        //was the response playing this note when it finished? (the mic and detector lag a little behind)
+        bool echo = heard.endSample <= userStart;
+        for(unsigned long i = 0; i < response.size() && !echo && heard.note != 0; i++) {
+            echo = response.at(i).note == heard.note && heard.endSample >= response.at(i).start &&
+                   heard.endSample <= response.at(i).end + RESPONSE_ECHO_SAMPLES;
+        }
 
+        if(echo) {
+            if(dropped != nullptr) dropped->push_back(heard);
+            thrownAway++;
+        } else if(!phrase.empty() || heard.note != 0) { //the silence before the phrase isn't part of it
+            phrase.push_back(heard);
+        }
     }
+    return thrownAway;
+}
+
+/**
+ * implemented from timers.h
+ * takes the rest of the user's last phrase off the note queue
+ * @param notes the queue of detected notes
+ * @param phraseEnd where the phrase ended in the audio
+ * @param phrase the notes taken while the user played, the rest of the phrase is added to the end
+ * @param running the running state of the system
+ * @return the number of notes in the phrase
+ */
+int collectPhrase(NoteQueue &notes, uint64_t phraseEnd, vector<noteEvent> &phrase, const atomic<bool> &running) {
 
-}
\ No newline at end of file
+    //notes are only timestamped once they've finished, so give the update thread
+    //a moment to finish listening to the end of the phrase
+    uint64_t cutoff = phraseEnd + PHRASE_END_GRACE;
+    for(int i = 0; i < PHRASE_WAIT_MS && running && notes.heard() < cutoff; i++) {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+
+    //anything after the cutoff belongs to the next phrase, so stays in the queue
+    takePhraseNotes(notes, cutoff, phrase);
+    return (int)phrase.size();
+}
+
+/**
+ * implemented from timers.h
+ * constructor starts off waiting for the user
+ * @param ring the audio ring, read through the step's own cursor
+ * @param notes the queue of detected notes
+ * @param model the model, only used by this step (nullptr to echo phrases back)
+ * @param sampleRate the sample rate of the audio
+ * @param clock asked whether the response has finished
+ * @param clockData passed to the clock on each call
+ * @param sink given each response to play
+ * @param sinkData passed to the sink on each call
+ */
+TurnStep::TurnStep(const AudioRing &ring, NoteQueue *notes, FPM *model, double sampleRate,
+                   responseClock clock, void *clockData, responseSink sink, void *sinkData):
+        reader(ring), notes(notes), model(model), candidates(1), sampleRate(sampleRate), clock(clock),
+        clockData(clockData), sink(sink), sinkData(sinkData), timingHook(nullptr), timingData(nullptr), heardLog(nullptr),
+        inModel(0), answered(false) {}
+
+/**
+ * implemented from timers.h
+ * sets a function to be called with the time taken by the turn taking for each block
+ * @param hook the function (nullptr to stop timing)
+ * @param userData passed to the hook on each call
+ */
+void TurnStep::setTimingHook(analysisHook hook, void *userData) {
+    timingHook = hook;
+    timingData = userData;
+}
+
+/**
+ * implemented from timers.h
+ * opts in to generating several candidate responses and playing the best
+ * @param count the number of candidates (1 generates a single phrase)
+ */
+void TurnStep::setCandidates(unsigned int count) {
+    candidates = max(1u, count);
+}
+
+/**
+ * implemented from timers.h
+ * sets where to keep every note taken off the queue
+ * @param heard the notes are added to the end of this (nullptr to stop keeping them)
+ */
+void TurnStep::setHeardLog(vector<noteEvent> *heard) {
+    heardLog = heard;
+}
+
+/**
+ * implemented from timers.h
+ * gives the model any notes of the phrase it hasn't had yet
+ */
+void TurnStep::feedModel() {
+    for(; model != nullptr && inModel < phrase.size(); inModel++) {
+        model->queueNote(phrase.at(inModel).note,phrase.at(inModel).duration);
+    }
+}
+
+/**
+ * implemented from timers.h
+ * takes the end of the user's phrase off the queue and hands the response to the sink
+ * @param running the running state of the system
+ */
+void TurnStep::respond(const atomic<bool> &running) {
+    auto trigger = chrono::steady_clock::now();
+    last = turnRecord();
+    last.phraseEnd = turns.getPhraseEnd();
+    last.trigger = reader.position();
+
+    //only the end of the phrase is still to go into the model
+    last.phraseNotes = collectPhrase(*notes, turns.getPhraseEnd(), phrase, running);
+    last.collectTime = chrono::duration<double>(chrono::steady_clock::now() - trigger).count();
+    if(heardLog != nullptr) heardLog->insert(heardLog->end(), phrase.begin(), phrase.end());
+    answered = last.phraseNotes != 0; //nothing to respond to, so the turn goes straight back
+    if(!answered) return;
+
+    //several candidates only if asked for, the work grows with each one
+    auto predictStart = chrono::steady_clock::now();
+    if(model != nullptr) {
+        feedModel();
+        last.output = candidates > 1 ? model->combinedPredict(candidates) : model->combinedPredict();
+    } else {
+        last.output = MatrixXd(phrase.size(),2);
+        for(unsigned long i = 0; i < phrase.size(); i++) {
+            last.output(i,0) = phrase.at(i).note;
+            last.output(i,1) = phrase.at(i).duration;
+        }
+    }
+    last.predictTime = chrono::duration<double>(chrono::steady_clock::now() - predictStart).count();
+    phrase.clear();
+    inModel = 0;
+
+    vector<midiEvent> events = predictionToEvents(last.output);
+    response = placeResponse(events, last.trigger, sampleRate);
+    sink(events, last.trigger, sinkData);
+    last.readyTime = chrono::duration<double>(chrono::steady_clock::now() - trigger).count();
+}
+
+/**
+ * implemented from timers.h
+ * waits for the next block of audio and moves everything along with it
+ * @param running the running state of the system
+ * @return what happened in the block (noTurnEvent if no block was ready in time or it was torn)
+ */
+turnEvent TurnStep::step(const atomic<bool> &running) {
+    level = blockLevel(); //nothing measured until a block is read
+
+    //has the response just finished?
+    if(turns.getState() == responding && (!answered || clock(reader.position(), clockData))) {
+        turns.responseFinished();
+
+        //the mic may have picked up the response, so only notes the user played over it are kept
+        uint64_t userStart = turns.getState() == userPlaying ? turns.getUserStart() : reader.position();
+        dropResponseNotes(*notes, userStart, reader.position(), response, phrase, heardLog);
+        response.clear();
+        answered = false;
+    }
+    if(!running) return noTurnEvent;
+
+    //sleep until a block is ready, waking every so often to check we're still running
+    if(!reader.wait(SILENCE_BLOCK, SILENCE_WAIT_MS)) return noTurnEvent;
+
+    auto blockStart = chrono::steady_clock::now();
+    const float *region1;
+    const float *region2;
+    unsigned long size1;
+    unsigned long size2;
+    unsigned long inBlock = reader.readRegions(SILENCE_BLOCK, region1, size1, region2, size2);
+
+    measureBlock(region1, size1, SILENCE_THRESHOLD, turns.loudThreshold(), level);
+    measureBlock(region2, size2, SILENCE_THRESHOLD, turns.loudThreshold(), level);
+
+    //the producer overwrote part of the block while it was measured, so its levels can't be trusted
+    //the samples are gone, so the block is skipped rather than read again
+    if(reader.finishRead(inBlock) != 0) {
+        level = blockLevel();
+        return noTurnEvent;
+    }
+
+    turnEvent event = turns.addBlock(level, reader.position());
+
+    //the model keeps up with the user while they play, so little is left to do once they stop
+    if(turns.getState() == userPlaying) {
+        takePhraseNotes(*notes, notes->heard(), phrase);
+        feedModel();
+    }
+    if(timingHook != nullptr) {
+        timingHook(chrono::duration<double>(chrono::steady_clock::now() - blockStart).count(), timingData);
+    }
+
+    if(event == userFinished) respond(running);
+    return event;
+}
+
+/**
+ * implemented from timers.h
+ * @return the levels of the block read by the last step
+ */
+const blockLevel &TurnStep::getLevel() const {
+    return level;
+}
+
+/**
+ * implemented from timers.h
+ * @return how the last response came about
+ */
+const turnRecord &TurnStep::getLastTurn() const {
+    return last;
+}
+
+/**
+ * implemented from timers.h
+ * @return whose turn it is
+ */
+turnState TurnStep::getState() const {
+    return turns.getState();
+}
+
+/**
+ * implemented from timers.h
+ * @return the position in the audio the step has got to
+ */
+uint64_t TurnStep::position() const {
+    return reader.position();
+}
+
+/**
+ * implemented from timers.h
+ * @return the number of samples the step missed because it fell behind
+ */
+uint64_t TurnStep::overruns() const {
+    return reader.overruns();
+}
@@ -0,0 +1,152 @@
+/**
+ * file implements the functionality found within virtualInput.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/virtualInput.h"
+#ifdef _WIN32
+#include "../../include/libsndfile/sndfile.h"
+#else
+#include <sndfile.h> //the header in include/ is from the windows build (it uses __int64)
+#endif
+#include <algorithm>
+
+/**
+ * implemented from virtualInput.h
+ * reads a whole wav file into memory
+ * @param filePath the path of the wav file
+ * @param channels set to the number of interleaved channels
+ * @param sampleRate set to the sample rate of the file
+ * @return the interleaved samples
+ */
+vector<float> readWavFile(const string &filePath, int &channels, int &sampleRate) {
+
+    SF_INFO fileInfo{};
+    SNDFILE *wavFile = sf_open(filePath.c_str(),SFM_READ,&fileInfo);
+    if(wavFile == nullptr) {
+        throw "Unable to open wav file";
+    }
+
+    channels = fileInfo.channels;
+    sampleRate = fileInfo.samplerate;
+
+    vector<float> allSamples(static_cast<size_t>(fileInfo.frames * fileInfo.channels));
+    sf_count_t framesRead = sf_readf_float(wavFile, allSamples.data(), fileInfo.frames);
+    allSamples.resize(static_cast<size_t>(framesRead * fileInfo.channels));
+
+    sf_close(wavFile);
+    return allSamples;
+}
+
+/**
+ * implemented from virtualInput.h
+ * @param samples the interleaved audio to play
+ * @param channels the number of interleaved channels
+ * @param sampleRate the sample rate of the audio
+ * @param callbackData the callback data the audio is written through
+ * @param speed how much faster than real time to play the audio
+ * @param framesPerBuffer frames sent to the callback at a time
+ */
+VirtualInput::VirtualInput(vector<float> samples, int channels, double sampleRate, passToCallback *callbackData,
+                           double speed, unsigned long framesPerBuffer) :
+        samples(std::move(samples)), channels(channels), sampleRate(sampleRate), speed(speed),
+        framesPerBuffer(framesPerBuffer), callbackData(callbackData),
+        stopRequested(false), done(false), framesSent(0) {
+
+    if(!(speed > 0.0)) {
+        throw "Virtual input speed must be positive";
+    }
+    if(channels < 1 || framesPerBuffer == 0) {
+        throw "Virtual input needs at least one channel and frame per buffer";
+    }
+
+    //the callback needs to know how the samples are interleaved, as with a real device
+    callbackData->channelCount = channels;
+}
+
+/**
+ * implemented from virtualInput.h
+ * destructor stops the feeder thread if it's still going
+ */
+VirtualInput::~VirtualInput() {
+    stop();
+}
+
+/**
+ * implemented from virtualInput.h
+ * the feeder thread, sends every buffer on schedule then stops
+ */
+void VirtualInput::feed() {
+
+    uint64_t total = totalFrames();
+    auto startTime = boost::chrono::steady_clock::now();
+
+    uint64_t frame = 0;
+    while(frame < total && !stopRequested) {
+        auto frames = (unsigned long)min<uint64_t>(framesPerBuffer, total - frame);
+        audioCallback(samples.data() + frame * channels, nullptr, frames, nullptr, 0, callbackData);
+        frame += frames;
+        framesSent = frame;
+
+        //a real device delivers a buffer once it has been filled, so wait until then
+        //scheduling from the start time stops any lateness building up
+        auto due = startTime + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+                boost::chrono::duration<double>((frame / sampleRate) / speed));
+        boost::this_thread::sleep_until(due);
+    }
+
+    done = true;
+}
+
+/**
+ * implemented from virtualInput.h
+ * starts sending audio to the callback
+ */
+void VirtualInput::start() {
+    if(feeder.joinable()) return; //already going
+    stopRequested = false;
+    done = false;
+    framesSent = 0;
+    feeder = boost::thread(&VirtualInput::feed, this);
+}
+
+/**
+ * implemented from virtualInput.h
+ * stops sending audio and waits for the feeder thread to finish
+ */
+void VirtualInput::stop() {
+    stopRequested = true;
+    if(feeder.joinable()) feeder.join();
+}
+
+/**
+ * implemented from virtualInput.h
+ * @return true once all the audio has been sent
+ */
+bool VirtualInput::finished() const {
+    return done;
+}
+
+/**
+ * implemented from virtualInput.h
+ * @return the number of frames sent so far
+ */
+uint64_t VirtualInput::sent() const {
+    return framesSent;
+}
+
+/**
+ * implemented from virtualInput.h
+ * @return the total number of frames to send
+ */
+uint64_t VirtualInput::totalFrames() const {
+    return samples.size() / channels;
+}
+
+/**
+ * implemented from virtualInput.h
+ * @return the length of the audio in seconds (at real time)
+ */
+double VirtualInput::duration() const {
+    return totalFrames() / sampleRate;
+}
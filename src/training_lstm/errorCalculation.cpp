@@ -5,6 +5,14 @@
  */
 
 #include "../../include/training_lstm/errorCalculation.h"
+#include <boost/thread.hpp>
+#include <algorithm>
+
+//prototype for the batched error worker
+void batchErrorWorker(const shared_ptr<LSTMNet> &lstm, const training_set_t &samples,
+                      const vector<unsigned int> &order, unsigned int batchSize,
+                      const shared_ptr<boost::mutex> &lock, unsigned int &nextBatch,
+                      vector<double> &sampleErrors);
 
 /**
  * implemented from errorCalculation.h
@@ -12,9 +20,11 @@
  * over a particular set of samples
  * @param lstm the network being tested
  * @param samples the samples to be used for testing
- * @return the average error over all samples
+ * @return the average error over all samples (0 if there are none)
  */
-double getError(shared_ptr<LSTMNet> lstm, training_set_t samples) {
+double getError(shared_ptr<LSTMNet> lstm, const training_set_t &samples) {
+
+    if(samples.empty()) return 0.0;
 
     double error = 0.0;
 
@@ -22,10 +32,10 @@ double getError(shared_ptr<LSTMNet> lstm, training_set_t samples) {
 
         lstm->lstmLayer->resetState(); //reset internal state of network
 
-        for(unsigned int j = 0; j < samples.at(i).size()-1; j++) {
+        for(unsigned int j = 0; j + 1 < samples.at(i).size(); j++) {
 
             VectorXd prediction = lstm->predict(samples.at(i).at(j));
-            VectorXd gt = samples.at(i).at(j+1);
+            const VectorXd &gt = samples.at(i).at(j+1);
 
             error += lstm->costFun(gt,prediction);
         }
@@ -33,4 +43,114 @@ double getError(shared_ptr<LSTMNet> lstm, training_set_t samples) {
     }
 
     return error/samples.size();
-}
\ No newline at end of file
+}
+
+/**
+ * implemented from errorCalculation.h
+ * batched, multi-threaded version of getError
+ * @param lstm the network being tested
+ * @param samples the samples to be used for testing
+ * @param batchSize the number of samples run together
+ * @param numThreads the number of threads to use (0 means one per core)
+ * @return the average error over all samples
+ */
+double getErrorBatched(shared_ptr<LSTMNet> lstm, const training_set_t &samples,
+                       unsigned int batchSize, unsigned int numThreads) {
+
+    if(samples.empty()) return 0.0;
+    if(batchSize == 0) batchSize = 1;
+
+    //longest samples first, so each batch holds samples of similar length
+    //and finished samples are always at the right hand end of a batch
+    vector<unsigned int> order(samples.size());
+    for(unsigned int i = 0; i < order.size(); i++) order.at(i) = i;
+    stable_sort(order.begin(), order.end(), [&samples](unsigned int a, unsigned int b) {
+        return samples.at(a).size() > samples.at(b).size();
+    });
+
+    unsigned int numBatches = ((unsigned int)samples.size() + batchSize - 1) / batchSize;
+    if(numThreads == 0) numThreads = max(1u, boost::thread::hardware_concurrency());
+    numThreads = min(numThreads, numBatches);
+
+    //each sample's error is kept separately and summed in order at the end
+    //so the result doesn't depend on which thread ran which batch
+    vector<double> sampleErrors(samples.size(), 0.0);
+    shared_ptr<boost::mutex> lock = std::make_shared<boost::mutex>();
+    unsigned int nextBatch = 0;
+
+    boost::thread_group workers;
+    for(unsigned int i = 0; i < numThreads; i++) {
+        workers.create_thread(boost::bind(batchErrorWorker, boost::cref(lstm), boost::cref(samples),
+                                          boost::cref(order), batchSize, boost::cref(lock),
+                                          boost::ref(nextBatch), boost::ref(sampleErrors)));
+    }
+    workers.join_all();
+
+    double error = 0.0;
+    for(double sampleError : sampleErrors) error += sampleError;
+
+    return error/samples.size();
+}
+
+/**
+ * takes batches until there are none left, running each through the network
+ * @param lstm the network being tested
+ * @param samples the samples to be used for testing
+ * @param order the sample indices, longest sample first
+ * @param batchSize the number of samples run together
+ * @param lock protects nextBatch
+ * @param nextBatch the next batch to be taken
+ * @param sampleErrors the total error for each sample (each entry written by one thread only)
+ */
+void batchErrorWorker(const shared_ptr<LSTMNet> &lstm, const training_set_t &samples,
+                      const vector<unsigned int> &order, unsigned int batchSize,
+                      const shared_ptr<boost::mutex> &lock, unsigned int &nextBatch,
+                      vector<double> &sampleErrors) {
+
+    long inputSize = lstm->lstmLayer->theta_xi.cols();
+    long hiddenSize = lstm->outputWeights.cols();
+    long outputSize = lstm->outputWeights.rows();
+
+    //per-thread storage, allocated once for the widest batch
+    MatrixXd hs(hiddenSize, batchSize);
+    MatrixXd cs(hiddenSize, batchSize);
+    MatrixXd inputs(inputSize, batchSize);
+    MatrixXd gates(4 * hiddenSize, batchSize);
+    MatrixXd outputs(outputSize, batchSize);
+
+    while(true) {
+
+        unsigned int batch;
+        {
+            boost::lock_guard<boost::mutex> guard(*lock);
+            batch = nextBatch++;
+        }
+
+        unsigned int first = batch * batchSize;
+        if(first >= order.size()) break;
+        unsigned int width = min(batchSize, (unsigned int)order.size() - first);
+
+        hs.leftCols(width).setZero();
+        cs.leftCols(width).setZero();
+
+        //a column is active while its sample still has a next note to predict
+        //as the batch is sorted by length, the active columns are always the leftmost ones
+        unsigned int active = width;
+        for(unsigned int t = 0; ; t++) {
+            while(active > 0 && samples.at(order.at(first + active - 1)).size() <= t + 1) active--;
+            if(active == 0) break;
+
+            for(unsigned int c = 0; c < active; c++) {
+                inputs.col(c) = samples.at(order.at(first + c)).at(t);
+            }
+
+            lstm->predictBatch(hs.leftCols(active), cs.leftCols(active), inputs.leftCols(active),
+                               gates.leftCols(active), outputs.leftCols(active));
+
+            for(unsigned int c = 0; c < active; c++) {
+                unsigned int sample = order.at(first + c);
+                sampleErrors.at(sample) += lstm->costFun(samples.at(sample).at(t+1), outputs.col(c));
+            }
+        }
+    }
+}
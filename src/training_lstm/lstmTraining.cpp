@@ -0,0 +1,371 @@
+/**
+ * file implements the lstm trainer
+ * defined in lstmTraining.h
+ * Author: Charlie Street
+ */
+
+#include "../../include/training_lstm/lstmTraining.h"
+#include "../../include/training_lstm/errorCalculation.h"
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+/**
+ * implemented from lstmTraining.h
+ * @param gt the ground truth
+ * @param prediction the network prediction
+ * @return the squared error
+ */
+double squaredErrorCost(VectorXd gt, VectorXd prediction) {
+    return (gt - prediction).squaredNorm();
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param gt the ground truth
+ * @param rawOutput the raw network output
+ * @return the gradient of the squared error
+ */
+VectorXd squaredErrorGradient(VectorXd gt, VectorXd rawOutput) {
+    return 2.0 * (rawOutput - gt);
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param gt the ground truth distribution
+ * @param rawOutput the raw network output
+ * @return the gradient of softmax followed by cross entropy
+ */
+VectorXd softmaxCrossEntropyGradient(VectorXd gt, VectorXd rawOutput) {
+    VectorXd softmax = (rawOutput.array() - rawOutput.maxCoeff()).exp();
+    softmax /= softmax.sum();
+    return softmax * gt.sum() - gt;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param other the gradients to add
+ */
+void lstmGradients::add(const lstmGradients &other) {
+    theta_x += other.theta_x;
+    theta_h += other.theta_h;
+    bias += other.bias;
+    outputWeights += other.outputWeights;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param factor the scale factor
+ */
+void lstmGradients::scale(double factor) {
+    theta_x *= factor;
+    theta_h *= factor;
+    bias *= factor;
+    outputWeights *= factor;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @return the norm of all gradients together
+ */
+double lstmGradients::norm() const {
+    return sqrt(theta_x.squaredNorm() + theta_h.squaredNorm() + bias.squaredNorm() + outputWeights.squaredNorm());
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param lstm the network to train
+ * @param config the training settings
+ */
+LSTMTrainer::LSTMTrainer(shared_ptr<LSTMNet> lstm, trainingConfig config) :
+        lstm(lstm), config(config),
+        firstMoment(lstm->lstmLayer->theta_x.cols(), lstm->outputWeights.cols(), lstm->outputWeights.rows()),
+        secondMoment(lstm->lstmLayer->theta_x.cols(), lstm->outputWeights.cols(), lstm->outputWeights.rows()),
+        adamSteps(0) {
+    if(this->config.numThreads == 0) this->config.numThreads = 1;
+    if(this->config.bpttSteps == 0) this->config.bpttSteps = 1;
+    if(this->config.minibatchSize == 0) this->config.minibatchSize = 1;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * samples are run together as columns, longest first, so the samples
+ * still running are always the leftmost columns
+ * the state is carried between chunks of bpttSteps, but the gradient isn't
+ * @param samples the training set
+ * @param shard the indices of the samples in this shard
+ * @param grads where the summed gradients are added
+ * @param loss where the summed cost is added
+ * @param count where the number of predictions is added
+ */
+void LSTMTrainer::shardGradients(const training_set_t &samples, vector<unsigned int> shard,
+                                 lstmGradients &grads, double &loss, unsigned long &count) const {
+
+    if(shard.empty()) return;
+
+    stable_sort(shard.begin(), shard.end(), [&samples](unsigned int a, unsigned int b) {
+        return samples.at(a).size() > samples.at(b).size();
+    });
+
+    const LSTMLayer &layer = *lstm->lstmLayer;
+    long inputSize = layer.theta_x.cols();
+    long H = layer.theta_h.cols();
+    long outputSize = lstm->outputWeights.rows();
+    long B = shard.size();
+
+    //predictions are made from every note but the last
+    long totalSteps = (long)samples.at(shard.at(0)).size() - 1;
+
+    MatrixXd h = MatrixXd::Zero(H,B);
+    MatrixXd c = MatrixXd::Zero(H,B);
+
+    //everything the backward pass needs from each step of a chunk
+    vector<long> active(config.bpttSteps);
+    vector<MatrixXd> xs(config.bpttSteps), gates(config.bpttSteps), hPrev(config.bpttSteps),
+                     cPrev(config.bpttSteps), hs(config.bpttSteps), cs(config.bpttSteps),
+                     dzs(config.bpttSteps);
+
+    MatrixXd dhNext(H,B), dcNext(H,B), dh, dc, tanhC, da;
+
+    for(long chunkStart = 0; chunkStart < totalSteps; chunkStart += config.bpttSteps) {
+
+        long chunkLength = min((long)config.bpttSteps, totalSteps - chunkStart);
+
+        //forward pass
+        for(long k = 0; k < chunkLength; k++) {
+            long t = chunkStart + k;
+
+            long a = B;
+            while(a > 0 && (long)samples.at(shard.at(a - 1)).size() <= t + 1) a--;
+            active.at(k) = a;
+
+            MatrixXd &x = xs.at(k);
+            x.resize(inputSize,a);
+            for(long col = 0; col < a; col++) x.col(col) = samples.at(shard.at(col)).at(t);
+
+            hPrev.at(k) = h.leftCols(a);
+            cPrev.at(k) = c.leftCols(a);
+
+            MatrixXd &g = gates.at(k);
+            g.noalias() = layer.theta_x * x;
+            g.noalias() += layer.theta_h * hPrev.at(k);
+            g.colwise() += layer.bias;
+            g.topRows(3 * H) = (1.0 + (-g.topRows(3 * H).array()).exp()).inverse();
+            g.bottomRows(H) = g.bottomRows(H).array().tanh();
+
+            c.leftCols(a).array() = g.middleRows(H,H).array() * cPrev.at(k).array() +
+                                    g.topRows(H).array() * g.bottomRows(H).array();
+            h.leftCols(a).array() = g.middleRows(2 * H,H).array() * c.leftCols(a).array().tanh();
+            cs.at(k) = c.leftCols(a);
+            hs.at(k) = h.leftCols(a);
+
+            MatrixXd z = lstm->outputWeights * hs.at(k);
+            MatrixXd &dz = dzs.at(k);
+            dz.resize(outputSize,a);
+            for(long col = 0; col < a; col++) {
+                const VectorXd &gt = samples.at(shard.at(col)).at(t + 1);
+                VectorXd prediction = z.col(col);
+                if(lstm->outputFun != nullptr) prediction = lstm->outputFun(prediction);
+                loss += lstm->costFun(gt,prediction);
+                dz.col(col) = config.costGradient(gt,z.col(col));
+            }
+            count += a;
+        }
+
+        //backward pass, truncated at the start of the chunk
+        dhNext.setZero();
+        dcNext.setZero();
+
+        for(long k = chunkLength - 1; k >= 0; k--) {
+            long a = active.at(k);
+            const MatrixXd &g = gates.at(k);
+
+            grads.outputWeights.noalias() += dzs.at(k) * hs.at(k).transpose();
+
+            dh = lstm->outputWeights.transpose() * dzs.at(k);
+            dh += dhNext.leftCols(a);
+
+            tanhC = cs.at(k).array().tanh();
+            dc = (dh.array() * g.middleRows(2 * H,H).array() * (1.0 - tanhC.array().square())).matrix()
+                 + dcNext.leftCols(a);
+
+            da.resize(4 * H,a);
+            auto i_t = g.topRows(H).array();
+            auto f_t = g.middleRows(H,H).array();
+            auto o_t = g.middleRows(2 * H,H).array();
+            auto g_t = g.bottomRows(H).array();
+            da.topRows(H).array() = dc.array() * g_t * i_t * (1.0 - i_t);
+            da.middleRows(H,H).array() = dc.array() * cPrev.at(k).array() * f_t * (1.0 - f_t);
+            da.middleRows(2 * H,H).array() = dh.array() * tanhC.array() * o_t * (1.0 - o_t);
+            da.bottomRows(H).array() = dc.array() * i_t * (1.0 - g_t.square());
+
+            grads.theta_x.noalias() += da * xs.at(k).transpose();
+            grads.theta_h.noalias() += da * hPrev.at(k).transpose();
+            grads.bias += da.rowwise().sum();
+
+            dhNext.leftCols(a).noalias() = layer.theta_h.transpose() * da;
+            dcNext.leftCols(a).array() = dc.array() * f_t;
+        }
+    }
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param samples the training set
+ * @param batch the indices of the samples to use
+ * @param grads where to write the averaged gradients
+ * @return the average cost per prediction
+ */
+double LSTMTrainer::computeGradients(const training_set_t &samples, const vector<unsigned int> &batch,
+                                     lstmGradients &grads) const {
+
+    long inputSize = lstm->lstmLayer->theta_x.cols();
+    long hiddenSize = lstm->outputWeights.cols();
+    long outputSize = lstm->outputWeights.rows();
+
+    //deal samples out longest first so each shard gets a similar amount of work
+    vector<unsigned int> sorted = batch;
+    stable_sort(sorted.begin(), sorted.end(), [&samples](unsigned int a, unsigned int b) {
+        return samples.at(a).size() > samples.at(b).size();
+    });
+
+    unsigned int numShards = max(1u, min(config.numThreads, (unsigned int)sorted.size()));
+    vector<vector<unsigned int>> shards(numShards);
+    for(unsigned int i = 0; i < sorted.size(); i++) shards.at(i % numShards).push_back(sorted.at(i));
+
+    vector<lstmGradients> shardGrads(numShards, lstmGradients(inputSize,hiddenSize,outputSize));
+    vector<double> shardLoss(numShards, 0.0);
+    vector<unsigned long> shardCount(numShards, 0);
+
+    if(numShards == 1) {
+        shardGradients(samples,shards.at(0),shardGrads.at(0),shardLoss.at(0),shardCount.at(0));
+    } else {
+        boost::thread_group workers;
+        for(unsigned int i = 0; i < numShards; i++) {
+            workers.create_thread(boost::bind(&LSTMTrainer::shardGradients, this, boost::cref(samples),
+                                              shards.at(i), boost::ref(shardGrads.at(i)),
+                                              boost::ref(shardLoss.at(i)), boost::ref(shardCount.at(i))));
+        }
+        workers.join_all();
+    }
+
+    //combine the shards in order, so the result doesn't depend on thread timing
+    grads = lstmGradients(inputSize,hiddenSize,outputSize);
+    double loss = 0.0;
+    unsigned long count = 0;
+    for(unsigned int i = 0; i < numShards; i++) {
+        grads.add(shardGrads.at(i));
+        loss += shardLoss.at(i);
+        count += shardCount.at(i);
+    }
+
+    if(count == 0) return 0.0;
+
+    grads.scale(1.0/count);
+    return loss/count;
+}
+
+/**
+ * one Adam step for a single parameter matrix
+ * @param param the parameter
+ * @param grad its gradient
+ * @param m the first moment estimate
+ * @param v the second moment estimate
+ * @param learningRate the learning rate
+ * @param correction1 the bias correction for m
+ * @param correction2 the bias correction for v
+ */
+static void adamUpdate(Ref<MatrixXd> param, const Ref<const MatrixXd> &grad, Ref<MatrixXd> m, Ref<MatrixXd> v,
+                       double learningRate, double correction1, double correction2) {
+    m = ADAM_BETA_1 * m + (1.0 - ADAM_BETA_1) * grad;
+    v.array() = ADAM_BETA_2 * v.array() + (1.0 - ADAM_BETA_2) * grad.array().square();
+    param.array() -= learningRate * (m.array() / correction1) /
+                     ((v.array() / correction2).sqrt() + ADAM_EPSILON);
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param grads the gradients for this step
+ */
+void LSTMTrainer::applyAdam(const lstmGradients &grads) {
+    adamSteps++;
+    double correction1 = 1.0 - pow(ADAM_BETA_1,(double)adamSteps);
+    double correction2 = 1.0 - pow(ADAM_BETA_2,(double)adamSteps);
+
+    LSTMLayer &layer = *lstm->lstmLayer;
+    adamUpdate(layer.theta_x,grads.theta_x,firstMoment.theta_x,secondMoment.theta_x,
+               config.learningRate,correction1,correction2);
+    adamUpdate(layer.theta_h,grads.theta_h,firstMoment.theta_h,secondMoment.theta_h,
+               config.learningRate,correction1,correction2);
+    adamUpdate(layer.bias,grads.bias,firstMoment.bias,secondMoment.bias,
+               config.learningRate,correction1,correction2);
+    adamUpdate(lstm->outputWeights,grads.outputWeights,firstMoment.outputWeights,secondMoment.outputWeights,
+               config.learningRate,correction1,correction2);
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param samples the training set
+ * @param batch the minibatch
+ * @return the average cost per prediction before the update
+ */
+double LSTMTrainer::trainMinibatch(const training_set_t &samples, const vector<unsigned int> &batch) {
+    lstmGradients grads(lstm->lstmLayer->theta_x.cols(), lstm->outputWeights.cols(), lstm->outputWeights.rows());
+    double loss = computeGradients(samples,batch,grads);
+
+    //clip by the global norm so one long phrase can't blow up the weights
+    double norm = grads.norm();
+    if(config.clipNorm > 0 && norm > config.clipNorm) grads.scale(config.clipNorm/norm);
+
+    applyAdam(grads);
+    return loss;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param samples the training set
+ * @param gen the random generator used for shuffling
+ * @return the average cost per prediction over the epoch
+ */
+double LSTMTrainer::trainEpoch(const training_set_t &samples, RngStream &gen) {
+    vector<unsigned int> order(samples.size());
+    for(unsigned int i = 0; i < order.size(); i++) order.at(i) = i;
+    shuffle(order.begin(), order.end(), gen);
+
+    double totalLoss = 0.0;
+    unsigned int batches = 0;
+
+    for(unsigned int start = 0; start < order.size(); start += config.minibatchSize) {
+        unsigned int end = min((unsigned int)order.size(), start + config.minibatchSize);
+        vector<unsigned int> batch(order.begin() + start, order.begin() + end);
+        totalLoss += trainMinibatch(samples,batch);
+        batches++;
+    }
+
+    return batches == 0 ? 0.0 : totalLoss/batches;
+}
+
+/**
+ * implemented from lstmTraining.h
+ * @param trainingSet the samples to train on
+ * @param validationSet the samples to test on
+ */
+void LSTMTrainer::train(const training_set_t &trainingSet, const training_set_t &validationSet) {
+
+    RngStream gen = newRngStream();
+
+    for(unsigned int epoch = 0; epoch < config.epochs; epoch++) {
+        double trainingLoss = trainEpoch(trainingSet,gen);
+        cout << "Epoch " << epoch << ": loss training = " << trainingLoss << endl;
+
+        if(!validationSet.empty()) {
+            cout << "Epoch " << epoch << ": loss testing = "
+                 << getErrorBatched(lstm,validationSet,ERROR_BATCH_SIZE,config.numThreads) << endl;
+        }
+
+        if(config.checkpointEvery != 0 && (epoch + 1) % config.checkpointEvery == 0) {
+            lstm->saveNetwork();
+        }
+    }
+}
@@ -0,0 +1,46 @@
+/**
+ * file trains an lstm network on our own phrase data
+ * and saves the weights through saveNetwork, so no python/keras export is needed
+ * usage: LSTM <training csv> [<validation csv>]
+ * Author: Charlie Street
+ */
+
+#include <iostream>
+#include <boost/thread.hpp>
+#include "../../include/training_lstm/lstmTraining.h"
+
+//same size as the keras models
+#define LSTM_HIDDEN_SIZE 100
+#define LSTM_TRAINING_FILE "lstmTraining.csv"
+
+/**
+ * reads in the training data, trains a new network and saves it
+ * @param argc the number of arguments
+ * @param argv the training file, and optionally a validation file
+ * @return 0 on success, 1 if the training data couldn't be read
+ */
+int main(int argc, char **argv) {
+
+    string trainingPath = argc > 1 ? argv[1] : LSTM_TRAINING_FILE;
+    training_set_t trainingSet = readTrainingSet(trainingPath);
+    training_set_t validationSet;
+    if(argc > 2) validationSet = readTrainingSet(argv[2]);
+
+    if(trainingSet.empty() || trainingSet.at(0).empty()) {
+        cout << "No training data found in " << trainingPath << endl;
+        return 1;
+    }
+
+    auto dataSize = (unsigned int)trainingSet.at(0).at(0).rows();
+    shared_ptr<LSTMNet> lstm = std::make_shared<LSTMNet>(dataSize,LSTM_HIDDEN_SIZE,dataSize,nullptr,squaredErrorCost);
+
+    trainingConfig config;
+    config.numThreads = max(1u, boost::thread::hardware_concurrency());
+
+    LSTMTrainer trainer(lstm,config);
+    trainer.train(trainingSet,validationSet);
+
+    lstm->saveNetwork();
+
+    return 0;
+}
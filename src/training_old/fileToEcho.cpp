@@ -9,12 +9,20 @@
 #include <iostream>
 #include <boost/thread.hpp>
 #include <utility>
+#include <algorithm>
 
 //prototype for thread worker function
 void trainingReaderWorker(ESN echo, vector<pair<string,VectorXd>> files,
                           unsigned int sampleJump, const shared_ptr<boost::mutex> &lock,
                           const shared_ptr<training_set_t> &trainingSet);
 
+//prototype for batched thread worker function
+void batchReaderWorker(ESN echo, vector<pair<string,VectorXd>> files, unsigned int sampleJump,
+                       unsigned int batchSize, size_t offset, const shared_ptr<training_set_t> &trainingSet);
+
+//prototype for reading the samples of a wav file
+vector<double> readWavSamples(const string &filePath);
+
 
 /**
  * implemented from fileToEcho.h
@@ -29,22 +37,38 @@ VectorXd wavToEcho(ESN echo, const string &filePath, unsigned int sampleJump) {
     echo.resetReservoir(); //reset the reservoir to its initial state
 
     //read in from wav file
-    auto *file_info = new SF_INFO;
-    SNDFILE *wavFile = sf_open(filePath.c_str(),SFM_READ,file_info);
+    vector<double> allSamples = readWavSamples(filePath);
 
-    //i only want to work with mono files here
-    if(file_info->channels != 1) {
-        throw "Non-mono file used!";
+    //loop through and feed into echo state network
+    for(size_t i = 0; i < allSamples.size(); i += sampleJump) {
+        echo.updateReservoir(allSamples[i]);
     }
 
-    auto *allSamples = new double[file_info->frames];
-    sf_count_t framesRead = sf_readf_double(wavFile, allSamples, file_info->frames);
+    //return the new reservoir state
+    return echo.getReservoir();
 
-    //loop through and feed into echo state network
-    for(sf_count_t i = 0; i < framesRead; i++) {
-        if((i % sampleJump) == 0) echo.updateReservoir(allSamples[i]);
+}
+
+/**
+ * reads all samples of a (mono) wav file into memory
+ * @param filePath the path of the wav file
+ * @return the samples of the file
+ */
+vector<double> readWavSamples(const string &filePath) {
+
+    SF_INFO fileInfo{};
+    SNDFILE *wavFile = sf_open(filePath.c_str(),SFM_READ,&fileInfo);
+
+    //i only want to work with mono files here
+    if(fileInfo.channels != 1) {
+        sf_close(wavFile);
+        throw "Non-mono file used!";
     }
 
+    vector<double> allSamples(static_cast<size_t>(fileInfo.frames));
+    sf_count_t framesRead = sf_readf_double(wavFile, allSamples.data(), fileInfo.frames);
+    allSamples.resize(static_cast<size_t>(framesRead));
+
     //close file
     int err = sf_close(wavFile);
     if(err != 0) { //don't need to throw an exception here, just a warning
@@ -53,13 +77,7 @@ VectorXd wavToEcho(ESN echo, const string &filePath, unsigned int sampleJump) {
              << to_string(err) << endl;
     }
 
-    //deallocate anything heap allocated
-    delete file_info;
-    delete allSamples;
-
-    //return the new reservoir state
-    return echo.getReservoir();
-
+    return allSamples;
 }
 
 /**
@@ -134,6 +152,112 @@ void trainingReaderWorker(ESN echo, vector<pair<string,VectorXd>> files,
     }
 }
 
+/**
+ * implemented from fileToEcho.h
+ * brings whole training set into memory, feeding batches
+ * of files through the network together
+ * @param echo the echo state network being used right now
+ * @param samplesAndOuts the config file containing file paths and ground truth values
+ * @param sampleJump an artificial decrease in sample rate
+ * @param batchSize how many files to process at once
+ * @return the training set in the form of a vector of pairs, in the order of the config file
+ */
+shared_ptr<training_set_t> formTrainingSetBatched(shared_ptr<ESN> echo, string samplesAndOuts,
+                                                  unsigned int sampleJump, unsigned int batchSize) {
+
+    vector<pair<string,VectorXd>> namesAndTruth = readTrainingFile(std::move(samplesAndOuts),
+                                                                   (echo->resOutWeights).rows());
+
+    //each file has its own slot, so the threads never touch the same sample
+    shared_ptr<training_set_t> trainingSet = std::make_shared<training_set_t>(namesAndTruth.size());
+
+    //same four way split as formTrainingSet, each quarter is then processed in batches
+    unsigned long stopFirst = namesAndTruth.size()/4;
+    unsigned long stopSecond = namesAndTruth.size()/2;
+    unsigned long stopThird = 3 * namesAndTruth.size() / 4;
+
+    vector<pair<string,VectorXd>> fstVec(namesAndTruth.begin(), namesAndTruth.begin() + stopFirst);
+    vector<pair<string,VectorXd>> sndVec(namesAndTruth.begin() + stopFirst, namesAndTruth.begin() + stopSecond);
+    vector<pair<string,VectorXd>> thirdVec(namesAndTruth.begin() + stopSecond, namesAndTruth.begin() + stopThird);
+    vector<pair<string,VectorXd>> fourthVec(namesAndTruth.begin() + stopThird, namesAndTruth.end());
+
+    boost::thread firstQuarter(batchReaderWorker, *echo, fstVec, sampleJump, batchSize, 0, trainingSet);
+    boost::thread secondQuarter(batchReaderWorker, *echo, sndVec, sampleJump, batchSize, stopFirst, trainingSet);
+    boost::thread thirdQuarter(batchReaderWorker, *echo, thirdVec, sampleJump, batchSize, stopSecond, trainingSet);
+    boost::thread fourthQuarter(batchReaderWorker, *echo, fourthVec, sampleJump, batchSize, stopThird, trainingSet);
+
+    firstQuarter.join();
+    secondQuarter.join();
+    thirdQuarter.join();
+    fourthQuarter.join();
+
+    return trainingSet;
+}
+
+/**
+ * processes a segment of the training files, batchSize files at a time
+ * within a batch, the files are sorted longest first so the reservoirs
+ * still being fed are always the leftmost columns
+ * @param echo the Echo State Network
+ * @param files the files to process, and the associated ground truth
+ * @param sampleJump artificial decrease in sample rate
+ * @param batchSize how many files to process at once
+ * @param offset where the first of the files goes in the training set
+ * @param trainingSet the in progress training set, already sized for every file
+ */
+void batchReaderWorker(ESN echo, vector<pair<string,VectorXd>> files, unsigned int sampleJump,
+                       unsigned int batchSize, size_t offset, const shared_ptr<training_set_t> &trainingSet) {
+
+    echo.resetReservoir();
+    VectorXd initialReservoir = echo.getReservoir();
+
+    for(size_t batchStart = 0; batchStart < files.size(); batchStart += batchSize) {
+        size_t batchEnd = min(files.size(), batchStart + batchSize);
+
+        //read in the batch, keeping track of how many updates each file needs
+        vector<pair<vector<double>,size_t>> batch; //samples, index into files
+        for(size_t f = batchStart; f < batchEnd; f++) {
+            batch.emplace_back(readWavSamples(files.at(f).first),f);
+        }
+
+        sort(batch.begin(), batch.end(), [](const pair<vector<double>,size_t> &a,
+                                            const pair<vector<double>,size_t> &b) {
+            return a.first.size() > b.first.size();
+        });
+
+        auto width = static_cast<long>(batch.size());
+        MatrixXd states = initialReservoir.replicate(1,width);
+        MatrixXd inputs = MatrixXd::Zero(1,width);
+
+        //the longest file decides how many steps the batch takes
+        size_t steps = (batch.at(0).first.size() + sampleJump - 1) / sampleJump;
+        long active = width;
+
+        for(size_t step = 0; step < steps; step++) {
+            size_t sampleIndex = step * sampleJump;
+
+            //files which have run out of samples drop off the right hand side
+            while(active > 0 && batch.at(static_cast<size_t>(active-1)).first.size() <= sampleIndex) {
+                active--;
+            }
+
+            for(long b = 0; b < active; b++) {
+                inputs(0,b) = batch.at(static_cast<size_t>(b)).first[sampleIndex];
+            }
+
+            echo.updateReservoirs(states.leftCols(active),inputs.leftCols(active));
+        }
+
+        //put each reservoir back in the place of its file
+        for(long b = 0; b < width; b++) {
+            size_t f = batch.at(static_cast<size_t>(b)).second;
+            trainingSet->at(offset + f) = make_pair(VectorXd(states.col(b)), files.at(f).second);
+        }
+
+        cout << "Finished reading in batch of " << width << " files" << endl;
+    }
+}
+
 /**
  * function takes a csv file where each line is of the form
  * <name>,<note1>,<note2>,...,<noteN><NEWLINE>
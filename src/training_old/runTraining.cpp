@@ -161,7 +161,7 @@ int singleTrainingRunRidge() {
     std::cout << "Initialised Echo State Network" << std::endl;
 
     //read in the training set
-    shared_ptr<training_set_t> trainingSet = formTrainingSet(echo,"D:/trainingData.csv",10);
+    shared_ptr<training_set_t> trainingSet = formTrainingSetBatched(echo,"D:/trainingData.csv",10);
     std::cout << "Finished reading in training set" << std::endl;
 
     //train the network
@@ -192,7 +192,7 @@ int runSimAnneal() {
     std::cout << "Initialised Echo State Network" << std::endl;
 
     //read in the training set
-    shared_ptr<training_set_t> trainingSet = formTrainingSet(echo,"D:/trainingData.csv",10);
+    shared_ptr<training_set_t> trainingSet = formTrainingSetBatched(echo,"D:/trainingData.csv",10);
     std::cout << "Finished reading in training set of size: " << trainingSet->size() <<  std::endl;
 
     ofstream myFile;
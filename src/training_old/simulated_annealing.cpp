@@ -22,8 +22,7 @@ MatrixXd generateRandomMatrix(unsigned int rows, unsigned int cols, unsigned int
     MatrixXd randMatrix = MatrixXd::Zero(rows,cols);
 
     //set up random number generator
-    std::default_random_engine gen;
-    gen.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+    RngStream gen = newRngStream();
     std::uniform_real_distribution<double> dis;
 
     //initialise matrix
@@ -46,19 +45,17 @@ MatrixXd generateRandomMatrix(unsigned int rows, unsigned int cols, unsigned int
  * @return minimum training set error
  */
 double simulatedAnnealing(double (*schedule)(unsigned int),MatrixXd(*neighbour)(MatrixXd,
-                                                                              std::default_random_engine &,
+                                                                              RngStream &,
                                                                               std::uniform_real_distribution<double> &),
                         shared_ptr<ESN> echo, training_set_t trainingSet) {
 
     //initialise random distribution for deciding whether to take bad moves
-    std::default_random_engine generator;
-    generator.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+    RngStream generator = newRngStream();
     std::uniform_real_distribution<double> distribution(0.0,1.0);
 
 
     //initialise normal distribution for use in generating neighbours
-    std::default_random_engine normalGen;
-    generator.seed((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+    RngStream normalGen = newRngStream();
     std::uniform_real_distribution<double> normalDis(-SIGMA,SIGMA);
 
 
@@ -132,7 +129,7 @@ double temperatureSchedule(unsigned int iteration) {
  * @return the new solution
  */
 MatrixXd generateNeighbour(MatrixXd currentSolution,
-                           std::default_random_engine &gen, std::uniform_real_distribution<double> &dis) {
+                           RngStream &gen, std::uniform_real_distribution<double> &dis) {
 
     MatrixXd newSolution = std::move(currentSolution);
     for(int i = 0; i < newSolution.rows(); i++) {
@@ -12,6 +12,7 @@
 
 #include "../../include/training_old/trainNetwork.h"
 #include "../../include/runtime/init_close.h"
+#include "../../include/random/rng.h"
 
 /**
  * carry out ridge regression to find the reservoir-output weights
@@ -123,7 +124,7 @@ void kfoldWithRepeats(unsigned int repeats, unsigned int folds, string trainingF
     shared_ptr<ESN> echo = std::make_shared<ESN>(v,r,a,N,k,inNeurons,outNeurons,nullptr,nullptr);
 
     //form the training set
-    shared_ptr<training_set_t> trainingSet = formTrainingSet(echo, std::move(trainingFile),SAMPLE_JUMP);
+    shared_ptr<training_set_t> trainingSet = formTrainingSetBatched(echo, std::move(trainingFile),SAMPLE_JUMP);
 
     //variable for the final output value
     double totalError = 0;
@@ -139,8 +140,8 @@ void kfoldWithRepeats(unsigned int repeats, unsigned int folds, string trainingF
         double repeatError = 0;
 
         //randomly shuffle about the training set to reduce any statistical bias
-        long long int seed = chrono::high_resolution_clock::now().time_since_epoch().count();
-        shuffle(trainingSet->begin(),trainingSet->end(),default_random_engine(seed));
+        RngStream shuffleGen = newRngStream();
+        shuffle(trainingSet->begin(),trainingSet->end(),shuffleGen);
 
         //loop over each fold
         for(unsigned int fold = 0; fold < folds; fold++) {
@@ -0,0 +1,45 @@
+/**
+ * command line tool which converts csv weight matrices into binary weight files
+ * each matrix is written next to the csv with a .wgt extension
+ * usage: WEIGHT_CONVERT matrices/NNote.csv matrices/BNote.csv ...
+ * Author: Charlie Street
+ */
+
+#include <iostream>
+#include "../../include/weights/weightFile.h"
+
+/**
+ * converts every csv file passed in
+ * @param argc the number of arguments
+ * @param argv the csv files to convert
+ * @return 0 if everything converted, 1 otherwise
+ */
+int main(int argc, char **argv) {
+
+    if(argc < 2) {
+        cout << "Usage: " << argv[0] << " <matrix.csv> [<matrix.csv> ...]" << endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for(int i = 1; i < argc; i++) {
+        string csvPath = argv[i];
+        string binPath = binaryTwinPath(csvPath);
+
+        try {
+            MatrixXd weights = readCsvMatrix(csvPath);
+            cout << "Writing to: " << binPath << endl;
+            cout << "Shape: (" << weights.rows() << ", " << weights.cols() << ")" << endl;
+
+            if(!writeWeightFile(binPath,weights,csvPath)) {
+                cout << "Unable to write " << binPath << endl;
+                failures++;
+            }
+        } catch(const char *e) {
+            cout << "Unable to convert " << csvPath << ": " << e << endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,557 @@
+/**
+ * file implements the weight matrix storage defined in weightFile.h
+ * Author: Charlie Street
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <locale>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <clocale>
+#include "../../include/weights/weightFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#endif
+
+static_assert(sizeof(weightFileHeader) == 32, "weight file header must stay 32 bytes");
+
+/**
+ * calculates the crc32 checksum of a block of bytes
+ * @param bytes the bytes to check
+ * @param length the number of bytes
+ * @return the crc32 of the bytes
+ */
+static uint32_t crc32(const unsigned char *bytes, size_t length) {
+
+    //lookup table built once on first use
+    static const vector<uint32_t> table = []() {
+        vector<uint32_t> t(256);
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for(int j = 0; j < 8; j++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for(size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * reverses the byte order of a value in place
+ * @param value pointer to the value
+ * @param size the size of the value in bytes
+ */
+static void swapBytes(void *value, size_t size) {
+    auto *bytes = (unsigned char*)value;
+    for(size_t i = 0; i < size / 2; i++) {
+        swap(bytes[i],bytes[size - 1 - i]);
+    }
+}
+
+/**
+ * checks a header is valid for a file of a given size
+ * byte swaps the header if it came from a machine of the other endianness
+ * throws if anything is wrong with the header
+ * @param header the header to check (swapped in place if needed)
+ * @param fileSize the total size of the file in bytes
+ * @return true if the data section needs byte swapping
+ */
+static bool checkHeader(weightFileHeader &header, size_t fileSize) {
+
+    if(fileSize < sizeof(weightFileHeader) || memcmp(header.magic,WEIGHT_FILE_MAGIC,4) != 0) {
+        throw "Not a binary weight file";
+    }
+
+    bool foreign = false;
+    if(header.endianTag != WEIGHT_FILE_ENDIAN_TAG) {
+        swapBytes(&header.endianTag,sizeof(header.endianTag));
+        if(header.endianTag != WEIGHT_FILE_ENDIAN_TAG) throw "Unrecognised weight file byte order";
+
+        foreign = true;
+        swapBytes(&header.version,sizeof(header.version));
+        swapBytes(&header.dtype,sizeof(header.dtype));
+        swapBytes(&header.rows,sizeof(header.rows));
+        swapBytes(&header.cols,sizeof(header.cols));
+        swapBytes(&header.checksum,sizeof(header.checksum));
+        swapBytes(&header.sourceSize,sizeof(header.sourceSize));
+        swapBytes(&header.sourceStamp,sizeof(header.sourceStamp));
+    }
+
+    if(header.version != WEIGHT_FILE_VERSION) throw "Unsupported weight file version";
+    if(header.dtype != WEIGHT_DTYPE_FLOAT64) throw "Unsupported weight file data type";
+
+    size_t dataSize = (size_t)header.rows * header.cols * sizeof(double);
+    if(fileSize - sizeof(weightFileHeader) < dataSize) throw "Weight file is truncated";
+
+    return foreign;
+}
+
+/**
+ * implemented from weightFile.h
+ * maps the file and validates it
+ * @param path the path to the binary weight file
+ */
+MappedWeightFile::MappedWeightFile(const string &path) : header(nullptr), data(nullptr), fileHandle(nullptr),
+                                                         mapHandle(nullptr), view(nullptr), viewSize(0) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,nullptr);
+    if(file == INVALID_HANDLE_VALUE) throw "Unable to open weight file";
+    fileHandle = file;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file,&size) || size.QuadPart == 0) {
+        unmap();
+        throw "Unable to map weight file";
+    }
+    viewSize = (size_t)size.QuadPart;
+
+    mapHandle = CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+    if(mapHandle != nullptr) view = MapViewOfFile(mapHandle,FILE_MAP_READ,0,0,0);
+#else
+    int fd = open(path.c_str(),O_RDONLY);
+    if(fd < 0) throw "Unable to open weight file";
+
+    struct stat info;
+    if(fstat(fd,&info) == 0 && info.st_size > 0) {
+        viewSize = (size_t)info.st_size;
+        void *mapped = mmap(nullptr,viewSize,PROT_READ,MAP_PRIVATE,fd,0);
+        if(mapped != MAP_FAILED) view = mapped;
+    }
+    close(fd); //the mapping stays valid after closing
+#endif
+
+    if(view == nullptr) {
+        unmap();
+        throw "Unable to map weight file";
+    }
+
+    //the view is read only, so check a copy of the header
+    weightFileHeader copy;
+    memcpy(&copy,view,min(viewSize,sizeof(weightFileHeader)));
+
+    try {
+        if(checkHeader(copy,viewSize)) throw "Weight file was written with a different byte order";
+
+        header = (const weightFileHeader*)view;
+        data = (const double*)((const unsigned char*)view + sizeof(weightFileHeader));
+
+        if(crc32((const unsigned char*)data,(size_t)header->rows * header->cols * sizeof(double)) != header->checksum) {
+            throw "Weight file failed its checksum";
+        }
+    } catch(...) {
+        unmap();
+        throw;
+    }
+}
+
+/**
+ * implemented from weightFile.h
+ * releases the mapping and any open handles
+ */
+void MappedWeightFile::unmap() {
+#ifdef _WIN32
+    if(view != nullptr) UnmapViewOfFile(view);
+    if(mapHandle != nullptr) CloseHandle(mapHandle);
+    if(fileHandle != nullptr) CloseHandle(fileHandle);
+#else
+    if(view != nullptr) munmap((void*)view,viewSize);
+#endif
+    view = nullptr;
+    mapHandle = nullptr;
+    fileHandle = nullptr;
+    header = nullptr;
+    data = nullptr;
+}
+
+/**
+ * implemented from weightFile.h
+ * destructor removes the mapping
+ */
+MappedWeightFile::~MappedWeightFile() {
+    unmap();
+}
+
+/**
+ * implemented from weightFile.h
+ * @return the mapped matrix
+ */
+Map<const MatrixXd> MappedWeightFile::matrix() const {
+    return Map<const MatrixXd>(data,header->rows,header->cols);
+}
+
+/**
+ * parses a single value from a csv file
+ * strtod is used with the C locale, so inf and nan are accepted
+ * but anything left over after the number is not
+ * @param item the text of the value
+ * @return the value
+ */
+static double parseCsvValue(const string &item) {
+
+#ifdef _WIN32
+    static const _locale_t classic = _create_locale(LC_NUMERIC,"C");
+#else
+    static const locale_t classic = newlocale(LC_NUMERIC_MASK,"C",(locale_t)0);
+#endif
+
+    const char *start = item.c_str();
+    char *end = nullptr;
+#ifdef _WIN32
+    double value = _strtod_l(start,&end,classic);
+#else
+    double value = strtod_l(start,&end,classic);
+#endif
+
+    if(end == start) throw "Malformed value in weight matrix file";
+    while(isspace((unsigned char)*end)) end++;
+    if(*end != '\0') throw "Malformed value in weight matrix file";
+
+    return value;
+}
+
+/**
+ * works out the size and modification time of a csv file, to tell if a binary twin was made from it
+ * only the file's metadata is read, so this costs the same whatever the size of the csv
+ * the time is kept at the finest resolution the system gives, truncated to its low 32 bits
+ * @param path the path to the csv file
+ * @param size set to the size of the file in bytes
+ * @param stamp set to the low bits of the file's modification time
+ * @return false if the file doesn't exist
+ */
+static bool csvFingerprint(const string &path, uint32_t &size, uint32_t &stamp) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if(!GetFileAttributesExA(path.c_str(),GetFileExInfoStandard,&info)) return false;
+    size = (uint32_t)info.nFileSizeLow;
+    stamp = (uint32_t)info.ftLastWriteTime.dwLowDateTime; //100ns ticks
+#else
+    struct stat info;
+    if(stat(path.c_str(),&info) != 0) return false;
+    size = (uint32_t)info.st_size;
+#ifdef __APPLE__
+    const struct timespec &modified = info.st_mtimespec;
+#else
+    const struct timespec &modified = info.st_mtim;
+#endif
+    stamp = (uint32_t)((uint64_t)modified.tv_sec * 1000000000u + (uint64_t)modified.tv_nsec);
+#endif
+    return true;
+}
+
+/**
+ * implemented from weightFile.h
+ * reads a csv file into a matrix
+ * @param path the path to the csv file
+ * @return the matrix in the file
+ */
+MatrixXd readCsvMatrix(const string &path) {
+
+    ifstream matFile(path);
+    if(!matFile.is_open()) throw "Unable to open weight matrix file";
+
+    vector<double> values; //row major as read
+    long rows = 0;
+    long cols = -1;
+
+    string line;
+    while(getline(matFile,line)) {
+
+        if(!line.empty() && line.back() == '\r') line.pop_back(); //files written on windows
+        if(line.empty()) continue;
+
+        long count = 0;
+        stringstream lineStream(line);
+        string item;
+
+        while(getline(lineStream,item,',')) {
+            if(item.empty()) continue; //every row ends with a trailing comma
+
+            values.push_back(parseCsvValue(item));
+            count++;
+        }
+
+        if(cols == -1) {
+            cols = count;
+        } else if(count != cols) {
+            throw "Weight matrix rows have different lengths";
+        }
+        rows++;
+    }
+
+    if(rows == 0 || cols == 0) throw "Empty weight matrix file";
+
+    return Map<Matrix<double,Dynamic,Dynamic,RowMajor>>(values.data(),rows,cols);
+}
+
+/**
+ * implemented from weightFile.h
+ * writes a matrix to csv
+ * @param path the path to write to
+ * @param weightMatrix the matrix to write
+ * @return 1 on success, 0 on failure
+ */
+int writeCsvMatrix(const string &path, const Ref<const MatrixXd> &weightMatrix) {
+
+    ofstream csvFile(path);
+    if(!csvFile.is_open()) return 0;
+
+    csvFile.imbue(locale::classic());
+    csvFile << setprecision(numeric_limits<double>::max_digits10); //enough digits for every value to read back exactly
+
+    for(long i = 0; i < weightMatrix.rows(); i++) {
+        for(long j = 0; j < weightMatrix.cols(); j++) {
+            csvFile << weightMatrix(i,j) << ",";
+        }
+        csvFile << "\n";
+    }
+
+    csvFile.close();
+    return csvFile.fail() ? 0 : 1;
+}
+
+/**
+ * reads and checks the header of a binary weight file
+ * throws if the file can't be read or the header is bad
+ * @param path the path to the file
+ * @param header set to the header, in native byte order
+ * @return true if the data section needs byte swapping
+ */
+static bool readHeader(const string &path, weightFileHeader &header) {
+
+    ifstream binFile(path, ios::binary | ios::ate);
+    if(!binFile.is_open()) throw "Unable to open weight file";
+
+    auto fileSize = (size_t)binFile.tellg();
+    binFile.seekg(0);
+
+    memset(&header,0,sizeof(header));
+    binFile.read((char*)&header,min(fileSize,sizeof(header)));
+
+    return checkHeader(header,fileSize);
+}
+
+/**
+ * copies the matrix in a binary weight file into existing storage
+ * native files are copied straight out of their mapping, foreign ones are read and swapped
+ * throws if the file is bad or the storage is the wrong shape
+ * @param path the path to the file
+ * @param header the file's header, from readHeader
+ * @param foreign whether the data section needs byte swapping
+ * @param weights where the weights go
+ */
+static void readWeightFileInto(const string &path, const weightFileHeader &header, bool foreign,
+                               Ref<MatrixXd> weights) {
+
+    if(weights.rows() != header.rows || weights.cols() != header.cols) {
+        throw "Weight matrix file has the wrong dimensions";
+    }
+
+    if(!foreign) {
+        MappedWeightFile mapped(path); //checks the header again, in case the file changed
+        if(mapped.matrix().rows() != weights.rows() || mapped.matrix().cols() != weights.cols()) {
+            throw "Weight matrix file has the wrong dimensions";
+        }
+        weights = mapped.matrix();
+        return;
+    }
+
+    //the mapping can't be swapped in place, so the data is read into its own buffer first
+    ifstream binFile(path, ios::binary);
+    binFile.seekg(sizeof(weightFileHeader));
+    MatrixXd swapped(header.rows,header.cols);
+    size_t dataSize = (size_t)swapped.size() * sizeof(double);
+    binFile.read((char*)swapped.data(),dataSize);
+    if(!binFile) throw "Weight file is truncated";
+
+    //checksum is over the bytes as they were written
+    if(crc32((const unsigned char*)swapped.data(),dataSize) != header.checksum) {
+        throw "Weight file failed its checksum";
+    }
+
+    for(long i = 0; i < swapped.size(); i++) {
+        swapBytes(swapped.data() + i,sizeof(double));
+    }
+    weights = swapped;
+}
+
+/**
+ * implemented from weightFile.h
+ * reads a binary weight file into a matrix
+ * @param path the path to the file
+ * @return the matrix in the file
+ */
+MatrixXd readWeightFile(const string &path) {
+    weightFileHeader header;
+    bool foreign = readHeader(path,header);
+
+    MatrixXd weights(header.rows,header.cols);
+    readWeightFileInto(path,header,foreign,weights);
+    return weights;
+}
+
+/**
+ * implemented from weightFile.h
+ * writes a matrix to a binary weight file
+ * @param path the path to write to
+ * @param weightMatrix the matrix to write
+ * @param sourcePath the csv the matrix came from, if any
+ * @return 1 on success, 0 on failure
+ */
+int writeWeightFile(const string &path, const Ref<const MatrixXd> &weightMatrix, const string &sourcePath) {
+
+    MatrixXd contiguous = weightMatrix; //a Ref may have an outer stride
+    size_t dataSize = (size_t)contiguous.size() * sizeof(double);
+
+    weightFileHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,WEIGHT_FILE_MAGIC,4);
+    header.endianTag = WEIGHT_FILE_ENDIAN_TAG;
+    header.version = WEIGHT_FILE_VERSION;
+    header.dtype = WEIGHT_DTYPE_FLOAT64;
+    header.rows = (uint32_t)contiguous.rows();
+    header.cols = (uint32_t)contiguous.cols();
+    header.checksum = crc32((const unsigned char*)contiguous.data(),dataSize);
+    if(!sourcePath.empty() && !csvFingerprint(sourcePath,header.sourceSize,header.sourceStamp)) return 0;
+
+    ofstream binFile(path, ios::binary | ios::trunc);
+    if(!binFile.is_open()) return 0;
+
+    binFile.write((const char*)&header,sizeof(header));
+    binFile.write((const char*)contiguous.data(),dataSize);
+    binFile.close();
+
+    return binFile.fail() ? 0 : 1;
+}
+
+/**
+ * implemented from weightFile.h
+ * @param path the path to check
+ * @return true if the file starts with the weight file magic
+ */
+bool isWeightFile(const string &path) {
+    ifstream binFile(path, ios::binary);
+    char magic[4];
+    return binFile.read(magic,4) && memcmp(magic,WEIGHT_FILE_MAGIC,4) == 0;
+}
+
+/**
+ * implemented from weightFile.h
+ * @param path the path to a csv weight file
+ * @return the path of its binary twin
+ */
+string binaryTwinPath(const string &path) {
+    string csvExtension = ".csv";
+    string binExtension = WEIGHT_FILE_EXTENSION;
+
+    if(path.size() >= csvExtension.size() &&
+       path.compare(path.size() - csvExtension.size(),csvExtension.size(),csvExtension) == 0) {
+        return path.substr(0,path.size() - csvExtension.size()) + binExtension;
+    }
+    if(path.size() >= binExtension.size() &&
+       path.compare(path.size() - binExtension.size(),binExtension.size(),binExtension) == 0) {
+        return path;
+    }
+    return path + binExtension;
+}
+
+/**
+ * works out which binary file, if any, a weight matrix should be loaded from
+ * @param path the path to the weight matrix
+ * @return the binary file to read, or an empty string if the csv must be parsed
+ */
+static string binarySource(const string &path) {
+
+    if(isWeightFile(path)) return path;
+
+    string twin = binaryTwinPath(path);
+    if(twin == path) return "";
+
+    weightFileHeader header;
+    memset(&header,0,sizeof(header));
+    ifstream twinFile(twin, ios::binary);
+    if(!twinFile.read((char*)&header,sizeof(header)) || memcmp(header.magic,WEIGHT_FILE_MAGIC,4) != 0) {
+        return ""; //no twin
+    }
+
+    //only trust the twin if it was made from the csv as it is now
+    uint32_t csvSize, csvStamp;
+    if(!csvFingerprint(path,csvSize,csvStamp)) return twin; //the twin is all there is
+
+    if(header.endianTag != WEIGHT_FILE_ENDIAN_TAG) { //fingerprint is stored in the writer's byte order
+        swapBytes(&header.sourceSize,sizeof(header.sourceSize));
+        swapBytes(&header.sourceStamp,sizeof(header.sourceStamp));
+    }
+    if(header.sourceSize == csvSize && header.sourceStamp == csvStamp) return twin;
+
+    return "";
+}
+
+/**
+ * implemented from weightFile.h
+ * loads from the fastest format available
+ * @param path the path to the weight matrix
+ * @return the weight matrix
+ */
+MatrixXd loadWeightMatrix(const string &path) {
+    string binary = binarySource(path);
+    return binary.empty() ? readCsvMatrix(path) : readWeightFile(binary);
+}
+
+/**
+ * implemented from weightFile.h
+ * loads from the fastest format available, straight into existing storage
+ * @param path the path to the weight matrix
+ * @param weights where the weights go
+ */
+void loadWeightMatrix(const string &path, Ref<MatrixXd> weights) {
+    string binary = binarySource(path);
+
+    if(binary.empty()) {
+        MatrixXd parsed = readCsvMatrix(path);
+        if(parsed.rows() != weights.rows() || parsed.cols() != weights.cols()) {
+            throw "Weight matrix file has the wrong dimensions";
+        }
+        weights = parsed;
+        return;
+    }
+
+    weightFileHeader header;
+    bool foreign = readHeader(binary,header);
+    readWeightFileInto(binary,header,foreign,weights);
+}
+
+/**
+ * implemented from weightFile.h
+ * saves a matrix as csv along with its binary twin
+ * @param path the csv path
+ * @param weightMatrix the matrix to save
+ * @return 1 on success, 0 on failure
+ */
+int saveWeightMatrix(const string &path, const Ref<const MatrixXd> &weightMatrix) {
+    int csvWritten = writeCsvMatrix(path,weightMatrix);
+    if(!csvWritten) return 0;
+    return writeWeightFile(binaryTwinPath(path),weightMatrix,path); //the twin records the csv it matches
+}
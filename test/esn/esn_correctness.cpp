@@ -10,6 +10,8 @@
 
 #include "../../include/test/catch.hpp"
 #include "../../include/esn/esn.h"
+#include "../../include/esn/fixedEsn.h"
+#include "../../include/random/rng.h"
 #include <cmath>
 
 /**
@@ -229,4 +231,201 @@ TEST_CASE("Check prediction functionality works as expected", "[predict]") {
 
     bool valTest = testOut(0,0) == Approx(1.99011);
     REQUIRE(valTest);
-}
\ No newline at end of file
+}
+
+/**
+ * the sparse reservoir should behave identically to the dense one
+ * both for the CRJ topology and for a network read back in from file
+ */
+TEST_CASE("Check sparse reservoir matches the dense reservoir", "[sparse]") {
+
+    auto *sparseEcho = new ESN(1.0,0.9,0.4,200,13,1,8,nullptr,nullptr,true);
+    auto *denseEcho = new ESN(1.0,0.9,0.4,200,13,1,8,nullptr,nullptr,false);
+
+    REQUIRE(sparseEcho->isSparse());
+    REQUIRE(!denseEcho->isSparse());
+
+    //the topology should be the same however it is stored
+    REQUIRE(sparseEcho->getResRes().isApprox(denseEcho->getResRes()));
+
+    //write out the sparse network and read it back both ways
+    sparseEcho->saveNetwork();
+    delete sparseEcho;
+    delete denseEcho;
+
+    sparseEcho = new ESN("inputReservoirWeights.csv","reservoirReservoirWeights.csv","reservoirOutputWeights.csv",
+                         nullptr,nullptr,true);
+    denseEcho = new ESN("inputReservoirWeights.csv","reservoirReservoirWeights.csv","reservoirOutputWeights.csv",
+                        nullptr,nullptr,false);
+
+    REQUIRE(sparseEcho->getResRes().isApprox(denseEcho->getResRes()));
+    REQUIRE(sparseEcho->getReservoir().rows() == 200);
+
+    //drive both networks with the same input and check they stay together
+    for(int i = 0; i < 500; i++) {
+        double input = sin(i * 0.05);
+        sparseEcho->updateReservoir(input);
+        denseEcho->updateReservoir(input);
+    }
+
+    VectorXd sparseRes = sparseEcho->getReservoir();
+    VectorXd denseRes = denseEcho->getReservoir();
+
+    for(int i = 0; i < sparseRes.rows(); i++) {
+        bool test = sparseRes(i,0) == Approx(denseRes(i,0));
+        REQUIRE(test);
+    }
+
+    REQUIRE(sparseEcho->predict().isApprox(denseEcho->predict()));
+
+    //resetting should work the same in both modes
+    sparseEcho->resetReservoir();
+    REQUIRE(sparseEcho->getReservoir().rows() == 200);
+    REQUIRE(sparseEcho->getReservoir().isZero());
+
+    delete sparseEcho;
+    delete denseEcho;
+}
+
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+/**
+ * once constructed, updating the network and predicting
+ * into existing storage should never touch the heap
+ * (Eigen asserts if it tries to allocate while malloc is disallowed)
+ */
+TEST_CASE("Check update and predict are allocation free", "[allocation]") {
+
+    ESN sparseEcho(1.0,0.9,0.4,200,13,3,8,nullptr,nullptr,true);
+    ESN denseEcho(1.0,0.9,0.4,200,13,3,8,nullptr,nullptr,false);
+
+    VectorXd inputVec = VectorXd::Random(3);
+    VectorXd outputs = VectorXd::Zero(8);
+
+    Eigen::internal::set_is_malloc_allowed(false);
+    for(int i = 0; i < 100; i++) {
+        sparseEcho.updateReservoir(inputVec);
+        denseEcho.updateReservoir(inputVec);
+    }
+    sparseEcho.predictInto(outputs);
+    denseEcho.predictInto(outputs);
+    sparseEcho.resetReservoir();
+    Eigen::internal::set_is_malloc_allowed(true);
+
+    ESN singleInput(1.0,0.9,0.4,200,13,1,8,nullptr,nullptr);
+    Eigen::internal::set_is_malloc_allowed(false);
+    for(int i = 0; i < 100; i++) {
+        singleInput.updateReservoir(0.5);
+    }
+    singleInput.predictInto(outputs);
+    Eigen::internal::set_is_malloc_allowed(true);
+
+    REQUIRE(!outputs.isZero());
+}
+#endif
+
+/**
+ * updating a batch of reservoirs as matrix columns should give
+ * the same result as updating each reservoir on its own
+ */
+TEST_CASE("Check batched reservoir update matches single updates", "[batch]") {
+
+    for(bool sparse : {true, false}) {
+        ESN echo(1.0,0.9,0.4,100,7,1,8,nullptr,nullptr,sparse);
+        ESN single = echo; //same weights, separate reservoir
+
+        int batchSize = 5;
+        MatrixXd states = MatrixXd::Zero(100,batchSize);
+        MatrixXd inputs(1,batchSize);
+
+        for(int t = 0; t < 50; t++) {
+            for(int b = 0; b < batchSize; b++) {
+                inputs(0,b) = sin(0.1 * t * (b + 1));
+            }
+            echo.updateReservoirs(states,inputs);
+        }
+
+        //narrower batches should reuse the same scratch space
+        echo.updateReservoirs(states.leftCols(2),inputs.leftCols(2));
+
+        for(int b = 0; b < batchSize; b++) {
+            single.resetReservoir();
+            for(int t = 0; t < 50; t++) {
+                single.updateReservoir(sin(0.1 * t * (b + 1)));
+            }
+            if(b < 2) single.updateReservoir(inputs(0,b));
+
+            VectorXd expected = single.getReservoir();
+            for(int i = 0; i < expected.rows(); i++) {
+                bool test = states(i,b) == Approx(expected(i,0));
+                REQUIRE(test);
+            }
+        }
+    }
+}
+
+/**
+ * a fixed size network loaded from the saved weights
+ * should behave exactly like the dynamic network it came from
+ */
+TEST_CASE("Check fixed size network matches the dynamic network", "[fixed]") {
+
+    ESN echo(1.0,0.9,0.4,60,5,3,4,nullptr,nullptr);
+    echo.resOutWeights = MatrixXd::Random(4,60);
+    echo.saveNetwork();
+
+    auto fixedEcho = loadFixedESN<60,3,4>("inputReservoirWeights.csv","reservoirReservoirWeights.csv",
+                                          "reservoirOutputWeights.csv",nullptr);
+
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+    Eigen::internal::set_is_malloc_allowed(false);
+#endif
+    for(int i = 0; i < 200; i++) {
+        Vector3d input(sin(i * 0.05), cos(i * 0.03), 0.5);
+        echo.updateReservoir(input);
+        fixedEcho->updateReservoir(input);
+    }
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+    Eigen::internal::set_is_malloc_allowed(true);
+#endif
+
+    VectorXd dynamicRes = echo.getReservoir();
+    for(int i = 0; i < 60; i++) {
+        bool test = fixedEcho->getReservoir()(i) == Approx(dynamicRes(i));
+        REQUIRE(test);
+    }
+
+    VectorXd dynamicOut = echo.predict();
+    Vector4d fixedOut = fixedEcho->predict();
+    for(int i = 0; i < 4; i++) {
+        bool test = fixedOut(i) == Approx(dynamicOut(i));
+        REQUIRE(test);
+    }
+
+    fixedEcho->resetReservoir();
+    REQUIRE(fixedEcho->getReservoir().isZero());
+
+    //the files don't describe a 50 neuron reservoir
+    REQUIRE_THROWS((loadFixedESN<50,3,4>("inputReservoirWeights.csv","reservoirReservoirWeights.csv",
+                                         "reservoirOutputWeights.csv",nullptr)));
+}
+
+/**
+ * every weight, including the output weights, should come from the global seed
+ */
+TEST_CASE("Check network weights are reproducible from the seed", "[seed]") {
+
+    setGlobalSeed(1234);
+    ESN first(1.0,0.9,0.4,50,5,2,3,nullptr,nullptr);
+
+    setGlobalSeed(1234);
+    ESN second(1.0,0.9,0.4,50,5,2,3,nullptr,nullptr);
+
+    REQUIRE(first.getInRes() == second.getInRes());
+    REQUIRE(first.resOutWeights == second.resOutWeights);
+    REQUIRE(first.resOutWeights.maxCoeff() <= 1.0);
+    REQUIRE(first.resOutWeights.minCoeff() >= -1.0);
+
+    setGlobalSeed(4321);
+    ESN third(1.0,0.9,0.4,50,5,2,3,nullptr,nullptr);
+    REQUIRE(first.resOutWeights != third.resOutWeights);
+}
@@ -2,12 +2,57 @@
  * The purpose of this file is to examine the speed of execution of the ESN
  * The most efficiency critical function is the update function of the ESN
  * But I will also test the predict function for completeness
+ * The dynamically sized network (sparse and dense) is compared against
+ * the fixed size network with the same weights
  * Author: Charlie Street
  */
 
 #include <iostream>
 #include <chrono> //I want execution timers!!!
 #include "../../include/esn/esn.h"
+#include "../../include/esn/fixedEsn.h"
+#include "../../include/random/rng.h"
+#include <cstdlib>
+
+//sizes of the network being tested
+#define SPEED_RES 200
+#define SPEED_IN 10
+#define SPEED_OUT 8
+
+//fixed so that runs can be compared
+#define SPEED_SEED 42
+
+//one second of audio at 44.1kHz
+#define SPEED_UPDATES 44100
+
+/**
+ * times the updates and a prediction for any network type
+ * @param name the name to print with the timings
+ * @param echo the network to time
+ * @param inputVec the input fed in on each update
+ */
+template<typename Network, typename Input>
+void timeNetwork(const string &name, Network &echo, const Input &inputVec) {
+
+    auto start = chrono::high_resolution_clock::now(); //start timer
+    for(int i = 0; i < SPEED_UPDATES; i++) {
+        echo.updateReservoir(inputVec);
+    }
+    auto finish = chrono::high_resolution_clock::now();
+
+    //calculate elapsed time
+    chrono::duration<double> elapsed = finish - start;
+    cout << name << " Elapsed Time For " << SPEED_UPDATES << " Updates: " << elapsed.count() << " (s)" << endl;
+
+    //make a prediction based on the network
+    start = chrono::high_resolution_clock::now();
+    auto outputs = echo.predict();
+    finish = chrono::high_resolution_clock::now();
+
+    elapsed = finish - start;
+    cout << name << " Elapsed Time For Prediction: " << elapsed.count() << " (s)" << endl;
+    cout << name << " Output Sum (for sanity checking): " << outputs.sum() << endl;
+}
 
 /**
  * carry out the tests
@@ -17,44 +62,38 @@
  */
 int main(int argc, char **argv) {
 
+    //the same networks and inputs every run
+    setGlobalSeed(SPEED_SEED);
+    srand(SPEED_SEED);
+
     //the time of set up doesn't bother me
     //in practice it will happen once at the start of the system
-    auto *echo = new ESN(0.5,0.7,0.3,200,10,10,8,nullptr,nullptr);
+    auto *echo = new ESN(0.5,0.7,0.3,SPEED_RES,10,SPEED_IN,SPEED_OUT,nullptr,nullptr);
+    echo->resOutWeights = MatrixXd::Random(SPEED_OUT,SPEED_RES);
 
     //create some arbitrary input vector of correct length
     //randomly initialise between -1 and 1
     //for these experiments, the same vector is being input each time
     //hopefully this doesn't cause any issues
     //in practice, this will be audio information
-    VectorXd inputVec = MatrixXd::Random(10,1);
-
-    //note that dynamically sized matrices may cause some slight speed decreases (I think)
-    //if this happens to be the case, then once the network is optimised, I can bake in these sizes
-    //such that memory is allocated at run-time
-
-    //carry out 200 updates
-    //if i used FFT input, this is larger than the sample rate
-
-    auto start = chrono::high_resolution_clock::now(); //start timer
-    for(int i = 0; i < 200; i++) {
-        echo->updateReservoir(0.5);
-    }
-    auto finish = chrono::high_resolution_clock::now();
-
-    //calculate elapsed time
-    chrono::duration<double> elapsed = finish - start;
-    cout << "Elapsed Time For Updates: " << elapsed.count() << " (s)" << endl;
+    VectorXd inputVec = MatrixXd::Random(SPEED_IN,1);
 
-    //make a prediction based on the network
+    //write out the weights so the other versions load the same network
+    echo->saveNetwork();
 
-    start = chrono::high_resolution_clock::now();
-    echo->predict();
-    finish = chrono::high_resolution_clock::now();
+    auto *denseEcho = new ESN("inputReservoirWeights.csv","reservoirReservoirWeights.csv",
+                              "reservoirOutputWeights.csv",nullptr,nullptr,false);
+    auto fixedEcho = loadFixedESN<SPEED_RES,SPEED_IN,SPEED_OUT>("inputReservoirWeights.csv",
+                                                                "reservoirReservoirWeights.csv",
+                                                                "reservoirOutputWeights.csv",nullptr);
+    Matrix<double,SPEED_IN,1> fixedInput = inputVec;
 
-    elapsed = finish - start;
-    cout << "Elapsed Time For Prediction: " << elapsed.count() << " (s)" << endl;
+    timeNetwork("Dynamic Sparse", *echo, inputVec);
+    timeNetwork("Dynamic Dense", *denseEcho, inputVec);
+    timeNetwork("Fixed Size", *fixedEcho, fixedInput);
 
-    delete echo; //finished with the object now
+    delete echo; //finished with the objects now
+    delete denseEcho;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,91 @@
+/**
+ * The purpose of this file is to examine the speed of execution of the LSTM
+ * The packed gate update is compared against the original update
+ * which carried out eight separate matrix-vector products
+ * Author: Charlie Street
+ */
+
+#include <iostream>
+#include <chrono> //I want execution timers!!!
+#include "../../include/lstm/lstm.h"
+#include "../../include/lstm/auxillary_functions.h"
+#include "../../include/random/rng.h"
+#include <cstdlib>
+
+//sizes of the network being tested
+#define SPEED_IN 2
+#define SPEED_HIDDEN 64
+#define SPEED_OUT 2
+
+#define SPEED_STEPS 10000
+
+//fixed so that runs can be compared
+#define SPEED_SEED 42
+
+/**
+ * the original per-gate update, kept here for comparison
+ * @param layer the layer holding the weights
+ * @param h the hidden state (updated)
+ * @param C the cell state (updated)
+ * @param x_t the new input
+ */
+void separateGateUpdate(LSTMLayer &layer, VectorXd &h, VectorXd &C, VectorXd x_t) {
+    VectorXd i_t = (layer.theta_xi * x_t) + (layer.theta_hi * h) + layer.bias_i;
+    i_t = applyToAll(sigmoid,i_t);
+
+    VectorXd f_t = (layer.theta_xf * x_t) + (layer.theta_hf * h) + layer.bias_f;
+    f_t = applyToAll(sigmoid,f_t);
+
+    VectorXd o_t = (layer.theta_xo * x_t) + (layer.theta_ho * h) + layer.bias_o;
+    o_t = applyToAll(sigmoid,o_t);
+
+    VectorXd g_t = (layer.theta_xg * x_t) + (layer.theta_hg * h) + layer.bias_g;
+    g_t = applyToAll(tanh,g_t);
+
+    C = f_t.cwiseProduct(C) + i_t.cwiseProduct(g_t);
+    h = o_t.cwiseProduct(applyToAll(tanh,C));
+}
+
+/**
+ * carry out the tests
+ * @param argc we all know this by now...
+ * @param argv ^^^
+ * @return 0
+ */
+int main(int argc, char **argv) {
+
+    //the same network and inputs every run
+    setGlobalSeed(SPEED_SEED);
+    srand(SPEED_SEED);
+
+    LSTMNet net(SPEED_IN,SPEED_HIDDEN,SPEED_OUT,nullptr,nullptr);
+    VectorXd inputVec = VectorXd::Random(SPEED_IN);
+
+    VectorXd h = VectorXd::Zero(SPEED_HIDDEN);
+    VectorXd C = VectorXd::Zero(SPEED_HIDDEN);
+
+    auto start = chrono::high_resolution_clock::now(); //start timer
+    for(int i = 0; i < SPEED_STEPS; i++) {
+        separateGateUpdate(*net.lstmLayer,h,C,inputVec);
+    }
+    VectorXd separateOutput = net.outputWeights * h;
+    auto finish = chrono::high_resolution_clock::now();
+
+    chrono::duration<double> elapsed = finish - start;
+    cout << "Separate Gates Elapsed Time For " << SPEED_STEPS << " Steps: " << elapsed.count() << " (s)" << endl;
+
+    start = chrono::high_resolution_clock::now();
+    VectorXd fusedOutput;
+    for(int i = 0; i < SPEED_STEPS; i++) {
+        fusedOutput = net.predict(inputVec);
+    }
+    finish = chrono::high_resolution_clock::now();
+
+    elapsed = finish - start;
+    cout << "Fused Gates Elapsed Time For " << SPEED_STEPS << " Steps: " << elapsed.count() << " (s)" << endl;
+
+    //both should have followed the same trajectory
+    cout << "Largest Output Difference: " << (separateOutput - fusedOutput).cwiseAbs().maxCoeff() << endl;
+
+    return 0;
+}
@@ -1,88 +1,55 @@
 /**
- * A file to test the correctness and speed of the
- * Windows MidiStream API
+ * A file to test the correctness and speed of
+ * playing responses through the Windows midi api
  * Author: Charlie Street
  */
 
-#include "include/midi/modelToMidi.h"
+#include "include/midi/winMidiSink.h"
 #include <chrono>
 #include <iostream>
+#include <boost/thread.hpp>
 using namespace std;
 
 
 int main() {
 
-    HANDLE event;
-    HMIDISTRM out;
-    MIDIHDR hdr{};
-    unsigned long err = 0;
-
-
-    if((event = CreateEvent(nullptr, FALSE, FALSE, nullptr))) {
-        if(!(err = midiStreamOpen(&out, (LPUINT)&err, 1, (DWORD)event, 0, CALLBACK_EVENT))) {
-
-            auto start = chrono::high_resolution_clock::now(); //start timer
-            ResetEvent(event);
-
-            VectorXd prediction = VectorXd::Zero(8,1);
-            prediction(0,0) = 39;
-            prediction(1,0) = 43;
-            prediction(2,0) = 46;
-            prediction(3,0) = 50;
-            prediction(4,0) = 46;
-            prediction(5,0) = 43;
-            prediction(6,0) = 39;
-            prediction(7,0) = 39;
-
-
-            unsigned long *midiEvents = naiveMidiWin(prediction, &out);
-
-            hdr.lpData = reinterpret_cast<LPSTR>(midiEvents);
-            hdr.dwBufferLength = hdr.dwBytesRecorded =  sizeof(unsigned long) * 51;
-            hdr.dwFlags = 0;
-
-            err = midiOutPrepareHeader(reinterpret_cast<HMIDIOUT>(out), &hdr, sizeof(MIDIHDR));
-            if(!err) {
-                err = midiStreamOut(out, &hdr, sizeof(MIDIHDR));
-
-                if(!err) {
-
-                    err = midiStreamRestart(out);
-                    if(!err) {
-                        auto finish = chrono::high_resolution_clock::now(); //start timer
-                        chrono::duration<double> elapsed = finish - start;
-                        cout << "Elapsed Time To Start Playing: " << elapsed.count() << " (s)" << endl;
-
-                        WaitForSingleObject(event,INFINITE);
-
-                    }
-                }
-
-                midiOutUnprepareHeader(reinterpret_cast<HMIDIOUT>(out), &hdr, sizeof(MIDIHDR));
-
-            }
+    WinMidiSink out;
+    if(!out.isOpen()) {
+        cout << "Unable to open the midi device" << endl;
+        return 1;
+    }
 
-            midiStreamPause(out);
-            MIDIHDR hdr2{};
-            hdr2.lpData = reinterpret_cast<LPSTR>(midiEvents);
-            hdr2.dwBufferLength = hdr2.dwBytesRecorded =  sizeof(unsigned long) * 51;
-            hdr2.dwFlags = 0;
-            Sleep(5000);
-            ResetEvent(event);
-            midiOutPrepareHeader(reinterpret_cast<HMIDIOUT>(out), &hdr2, sizeof(MIDIHDR));
-            midiStreamOut(out, &hdr2, sizeof(MIDIHDR));
+    MatrixXd prediction = MatrixXd::Zero(8,2);
+    prediction(0,0) = 39;
+    prediction(1,0) = 43;
+    prediction(2,0) = 46;
+    prediction(3,0) = 50;
+    prediction(4,0) = 46;
+    prediction(5,0) = 43;
+    prediction(6,0) = 39;
+    prediction(7,0) = 39;
+    for(int i = 0; i < prediction.rows(); i++) {
+        prediction(i,1) = 0.25;
+    }
 
-            midiStreamRestart(out);
-            WaitForSingleObject(event,INFINITE);
-            midiOutUnprepareHeader(reinterpret_cast<HMIDIOUT>(out), &hdr2, sizeof(MIDIHDR));
-            midiStreamClose(out);
-            delete [] midiEvents;
+    atomic<bool> running(true);
+    MidiPlayer player(&out);
 
-        }
+    auto start = chrono::high_resolution_clock::now(); //start timer
+    vector<midiEvent> events = predictionToEvents(prediction);
+    auto finish = chrono::high_resolution_clock::now();
+    chrono::duration<double> elapsed = finish - start;
+    cout << "Elapsed Time To Start Playing: " << elapsed.count() << " (s)" << endl;
 
+    player.play(events, running);
 
-    }
+    //play it again after a gap, as the system does with each response
+    boost::this_thread::sleep_for(boost::chrono::seconds(5));
+    player.play(events, running);
 
-    CloseHandle(event);
+    cout << "Messages Sent: " << player.eventsSent() << endl;
+    cout << "Mean Lateness: " << player.meanLateness() * 1000.0 << " (ms)" << endl;
+    cout << "Max Lateness: " << player.maxLateness() * 1000.0 << " (ms)" << endl;
 
-}
\ No newline at end of file
+    return 0;
+}
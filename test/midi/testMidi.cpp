@@ -8,8 +8,10 @@
 #define CATCH_CONFIG_MAIN
 #include "../../include/test/catch.hpp" //include for test framework
 #include "../../include/midi/midi.h" //header file for code to test
+#include "../../include/midi/midiSink.h"
 #include <fstream>
 #include <iostream>
+#include <cstdio>
 
 //things to test in midi.cpp
 /*
@@ -631,4 +633,105 @@ TEST_CASE("Checks general behaviour of each Midi 'command'", "[Midi commands]")
     CHECK(multi.at(6) == 60);
     CHECK(multi.at(7) == 64);
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Checks the model's predictions become timed midi events", "[predictionToEvents]") {
+
+    MatrixXd prediction(3,2);
+    prediction << 39, 0.5,
+                   0, 0.25,
+                  43, 0.5;
+
+    vector<midiEvent> events = predictionToEvents(prediction);
+    REQUIRE(events.size() == 5); //program change, then no events for the rest
+
+    CHECK(events.at(0).status == PROGRAM_CHANGE);
+    CHECK(events.at(0).time == 0.0);
+
+    CHECK(events.at(1).status == NOTE_ON);
+    CHECK(events.at(1).data1 == 39 + NOTE_OFFSET);
+    CHECK(events.at(1).time == Approx(0.0));
+    CHECK(events.at(2).status == NOTE_OFF);
+    CHECK(events.at(2).time == Approx(0.5));
+
+    CHECK(events.at(3).status == NOTE_ON);
+    CHECK(events.at(3).data1 == 43 + NOTE_OFFSET);
+    CHECK(events.at(3).time == Approx(0.75));
+    CHECK(events.at(4).status == NOTE_OFF);
+    CHECK(events.at(4).time == Approx(1.25));
+
+    CHECK(secondsToTicks(0.5) == MIDI_PPQN); //a quarter note at 120bpm
+    CHECK(secondsToTicks(0.0) == 0);
+}
+
+TEST_CASE("Checks the midi player sends each message on time and in order", "[MidiPlayer]") {
+
+    MemoryMidiSink sink;
+    MidiPlayer player(&sink);
+    atomic<bool> running(true);
+
+    int hookCalls = 0;
+    player.setEventHook([](const midiEvent &, void *userData) { (*(int*)userData)++; }, &hookCalls);
+
+    vector<midiEvent> events;
+    events.emplace_back(0.0, PROGRAM_CHANGE, MIDI_PROGRAM, 0);
+    events.emplace_back(0.02, NOTE_ON, 60, MIDI_VELOCITY);
+    events.emplace_back(0.06, NOTE_OFF, 60, MIDI_VELOCITY);
+
+    REQUIRE(player.play(events, running));
+
+    vector<midiEvent> sent = sink.events();
+    REQUIRE(sent.size() == 3);
+    CHECK(hookCalls == 3);
+    CHECK(player.eventsSent() == 3);
+    for(unsigned long i = 0; i < sent.size(); i++) {
+        CHECK(sent.at(i).status == events.at(i).status);
+        if(i > 0) CHECK(sent.at(i).time >= sent.at(i-1).time);
+    }
+
+    //the gaps between messages are kept
+    CHECK(sent.at(2).time - sent.at(1).time >= 0.04 - 0.005);
+    CHECK(player.meanLateness() >= 0.0);
+    CHECK(player.maxLateness() < 0.05); //generous, as the test machine may be busy
+
+    //stopping part way turns everything off rather than playing on
+    sink.clear();
+    running = false;
+    REQUIRE(player.play(events, running));
+    sent = sink.events();
+    REQUIRE(sent.size() == 1);
+    CHECK(sent.at(0).status == CONTROLLER_CHANGE);
+    CHECK(sent.at(0).data1 == 0x7B);
+}
+
+TEST_CASE("Checks the midi file sink writes a standard midi file", "[SmfMidiSink]") {
+
+    string fileName = "smfSinkTest.mid";
+    {
+        SmfMidiSink sink(fileName);
+        MidiPlayer player(&sink);
+        atomic<bool> running(true);
+
+        vector<midiEvent> events;
+        events.emplace_back(0.0, NOTE_ON, 60, MIDI_VELOCITY);
+        events.emplace_back(0.01, NOTE_OFF, 60, MIDI_VELOCITY);
+        REQUIRE(player.play(events, running));
+    }
+
+    ifstream file(fileName, ios::binary);
+    REQUIRE(file.is_open());
+    vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    file.close();
+    remove(fileName.c_str());
+
+    REQUIRE(data.size() > 22);
+    CHECK(string(data.begin(), data.begin() + 4) == "MThd");
+    CHECK(string(data.begin() + 14, data.begin() + 18) == "MTrk");
+    CHECK((byte)data.at(12) == 0); //the division is MIDI_PPQN
+    CHECK((byte)data.at(13) == MIDI_PPQN);
+
+    //the track ends with an end of track message
+    CHECK((byte)data.at(data.size() - 3) == 0xFF);
+    CHECK((byte)data.at(data.size() - 2) == 0x2F);
+    CHECK((byte)data.at(data.size() - 1) == 0x00);
+}
@@ -9,6 +9,7 @@
 #include "../../include/model/keyDetect.h"
 #include "../../include/model/fpm.h"
 #include <iostream>
+#include <limits>
 /**
  * tests that transposition is carried out properly
  */
@@ -329,4 +330,299 @@ TEST_CASE("Tests the prediction/fpm code", "[fpm]") {
     REQUIRE(dirSequence.empty());
 
 
-}
\ No newline at end of file
+}
+
+/**
+ * tests the incremental chaos game representation against the explicit formula
+ */
+TEST_CASE("Tests the incremental chaos representation", "[chaos]") {
+
+    MatrixXd t(2,3);
+    t << 0.0, 1.0, 0.0,
+         0.0, 0.0, 1.0;
+    double k = 0.5;
+
+    ChaosState state(t,k);
+    CHECK(state.point()(0) == Approx(0.5));
+    CHECK(state.point()(1) == Approx(0.5));
+
+    vector<int> S = {1,2,0,2,2,1};
+
+    //explicit form: x_n = k^n x_0 + sum_i (1-k) k^(n-1-i) t_{S_i}
+    VectorXd expected = VectorXd::Constant(2,0.5);
+    for(int i = 0; i < (int)S.size(); i++) {
+        state.append(S.at(i));
+        expected = k * expected + (1.0 - k) * t.col(S.at(i));
+        CHECK(state.point()(0) == Approx(expected(0)));
+        CHECK(state.point()(1) == Approx(expected(1)));
+    }
+
+    VectorXd closed = pow(k,(double)S.size()) * VectorXd::Constant(2,0.5);
+    for(int i = 0; i < (int)S.size(); i++) {
+        closed += (1.0 - k) * pow(k,(double)(S.size() - 1 - i)) * t.col(S.at(i));
+    }
+    CHECK(state.point()(0) == Approx(closed(0)));
+    CHECK(state.point()(1) == Approx(closed(1)));
+
+    state.reset();
+    CHECK(state.point()(0) == Approx(0.5));
+    CHECK(state.point()(1) == Approx(0.5));
+}
+
+/**
+ * tests the codebook search (both the linear search and the k-d tree)
+ * against a brute force search
+ */
+TEST_CASE("Tests the nearest codebook search", "[codebook]") {
+
+    default_random_engine gen(42);
+    uniform_real_distribution<double> dist(0.0,1.0);
+
+    for(int dims : {1,4}) {
+        MatrixXd B(dims,500);
+        for(int i = 0; i < B.rows(); i++) {
+            for(int j = 0; j < B.cols(); j++) {
+                B(i,j) = dist(gen);
+            }
+        }
+
+        CodebookIndex linear(B,B.cols() + 1);
+        CodebookIndex tree(B,0);
+        REQUIRE_FALSE(linear.usesTree());
+        REQUIRE(tree.usesTree());
+
+        for(int n = 0; n < 200; n++) {
+            VectorXd x(dims);
+            for(int i = 0; i < dims; i++) x(i) = dist(gen);
+
+            int expected = -1;
+            double minDistance = std::numeric_limits<double>::infinity();
+            for(int j = 0; j < B.cols(); j++) {
+                double d = (x - B.col(j)).squaredNorm();
+                if(d < minDistance) {
+                    minDistance = d;
+                    expected = j;
+                }
+            }
+
+            CHECK(linear.nearest(x) == expected);
+            CHECK(tree.nearest(x) == expected);
+        }
+
+        //a codebook vector is its own closest
+        CHECK(linear.nearest(B.col(17)) == 17);
+        CHECK(tree.nearest(B.col(17)) == 17);
+    }
+
+    CodebookIndex empty;
+    CHECK(empty.nearest(VectorXd::Zero(2)) == -1);
+}
+
+/**
+ * tests the alias table samples from the right distribution
+ */
+TEST_CASE("Tests the alias table sampling", "[alias]") {
+
+    RngStream gen(7);
+
+    RowVectorXd weights(5);
+    weights << 4.0, 0.0, 1.0, 2.5, 0.5;
+    AliasTable table(weights);
+    REQUIRE(table.size() == 5);
+
+    int samples = 200000;
+    VectorXd counts = VectorXd::Zero(5);
+    for(int n = 0; n < samples; n++) {
+        int i = table.sample(gen);
+        if(i >= 0 && i < 5) counts(i) += 1.0;
+    }
+
+    CHECK(counts.sum() == samples); //all in range
+    CHECK(counts(1) == 0.0); //zero weight never drawn
+    for(int i = 0; i < 5; i++) {
+        CHECK(counts(i) / samples == Approx(weights(i) / weights.sum()).margin(0.01));
+    }
+
+    //all zero weights are treated as uniform
+    AliasTable uniform(RowVectorXd::Zero(4));
+    counts = VectorXd::Zero(4);
+    for(int n = 0; n < samples; n++) counts(uniform.sample(gen)) += 1.0;
+    for(int i = 0; i < 4; i++) {
+        CHECK(counts(i) / samples == Approx(0.25).margin(0.01));
+    }
+
+    //changing the temperature retilts the note distributions
+    FPM fpm("runtime/matrices/BNote.csv","runtime/matrices/NNote.csv","runtime/matrices/tNote.csv",0.5,0.4,
+            "runtime/matrices/BDir.csv","runtime/matrices/NDir.csv","runtime/matrices/tDir.csv",0.5,1.9);
+    MatrixXd tilted = fpm.getNNote();
+    fpm.setNoteTemperature(1.0);
+    MatrixXd untilted = fpm.getNNote();
+    CHECK(Eigen::pow(untilted.array(),1.0/0.4).matrix().isApprox(tilted));
+}
+
+/**
+ * tests generating several candidate phrases and scoring them
+ */
+TEST_CASE("Tests multi-candidate phrase generation", "[candidates]") {
+
+    FPM fpm("runtime/matrices/BNote.csv","runtime/matrices/NNote.csv","runtime/matrices/tNote.csv",0.5,0.4,
+            "runtime/matrices/BDir.csv","runtime/matrices/NDir.csv","runtime/matrices/tDir.csv",0.5,1.9);
+
+    vector<int> user = {51,53,55,34,48,51,53,52};
+
+    //a smooth response scores better than a jumpy one
+    vector<int> smooth = {52,50,48,48};
+    vector<int> jumpy = {25,78,26,77};
+    CHECK(intervalPhraseCost(user,smooth,"C") < intervalPhraseCost(user,jumpy,"C"));
+
+    //the key profile peaks on the key's own note (51 under the queueNote numbering for "C")
+    CHECK(keyPhraseCost(user,{51,63,0},"C") == Approx(0.0));
+    CHECK(keyPhraseCost(user,{52,64},"C") > 0.0);
+    CHECK(intervalPhraseCost(user,{0,0},"C") == 0.0);
+    CHECK(keyPhraseCost(user,{0,0},"C") == 0.0);
+
+    for(unsigned int threads : {1u,4u}) {
+        for(int note : user) fpm.queueNote(note,0.2);
+
+        MatrixXd phrase = fpm.combinedPredict(16,combinedPhraseCost,threads);
+        REQUIRE(phrase.rows() == (long)user.size());
+        REQUIRE(phrase.cols() == 2);
+        for(int i = 0; i < phrase.rows(); i++) {
+            CHECK(((phrase(i,0) >= 24 && phrase(i,0) <= 79) || phrase(i,0) == 0));
+        }
+
+        //state is cleared afterwards
+        CHECK(fpm.getAbsQueue().empty());
+        CHECK(fpm.getDirQueue().empty());
+    }
+
+    //every candidate is generated, so the same seed gives the same phrase however many threads there are
+    setGlobalSeed(29);
+    FPM single("runtime/matrices/BNote.csv","runtime/matrices/NNote.csv","runtime/matrices/tNote.csv",0.5,0.4,
+               "runtime/matrices/BDir.csv","runtime/matrices/NDir.csv","runtime/matrices/tDir.csv",0.5,1.9);
+    setGlobalSeed(29);
+    FPM threaded("runtime/matrices/BNote.csv","runtime/matrices/NNote.csv","runtime/matrices/tNote.csv",0.5,0.4,
+                 "runtime/matrices/BDir.csv","runtime/matrices/NDir.csv","runtime/matrices/tDir.csv",0.5,1.9);
+    for(int note : user) {
+        single.queueNote(note,0.2);
+        threaded.queueNote(note,0.2);
+    }
+    CHECK(single.combinedPredict(16,combinedPhraseCost,1) == threaded.combinedPredict(16,combinedPhraseCost,4));
+
+    for(int note : user) fpm.queueNote(note,0.2);
+    CHECK_THROWS(fpm.combinedPredict(0));
+}
+
+/**
+ * tests the streaming key detection gives the same answer as detectKey
+ */
+TEST_CASE("Tests the streaming key detection", "[keyTracker]") {
+
+    RngStream gen(11);
+    uniform_int_distribution<int> noteDis(0,12);
+    uniform_real_distribution<double> durationDis(0.05,2.5);
+
+    KeyTracker empty;
+    CHECK(empty.detect().empty());
+
+    for(int trial = 0; trial < 200; trial++) {
+        KeyTracker tracker(SEGMENT_LENGTH,MODULATION_PENALTY);
+        vector<pair<int,double>> sequence;
+
+        int length = 1 + trial % 40;
+        for(int i = 0; i < length; i++) {
+            //repeated notes make for plenty of ties in the dynamic programming
+            int note = (trial % 3 == 0) ? 4 : noteDis(gen);
+            sequence.emplace_back(note,durationDis(gen));
+            tracker.addNote(sequence.back().first,sequence.back().second);
+
+            if(i % 7 == 0) { //can be asked at any point
+                REQUIRE(tracker.detect() == detectKey(sequence,SEGMENT_LENGTH,MODULATION_PENALTY));
+            }
+        }
+        REQUIRE(tracker.detect() == detectKey(sequence,SEGMENT_LENGTH,MODULATION_PENALTY));
+
+        //removing the last note
+        CHECK(tracker.removeLastNote());
+        sequence.pop_back();
+        if(!sequence.empty()) {
+            REQUIRE(tracker.detect() == detectKey(sequence,SEGMENT_LENGTH,MODULATION_PENALTY));
+        }
+    }
+}
+
+/**
+ * tests the pitch key lookup table and the contiguous dynamic programming
+ */
+TEST_CASE("Tests the pitch class lookup table", "[pitchTable]") {
+
+    const MatrixXd &table = pitchKeyTable();
+    REQUIRE(table.rows() == NUM_ALL_KEYS);
+    REQUIRE(table.cols() == NUM_PITCH_MASKS);
+
+    //every mask against the original calculation
+    double worst = 0.0;
+    for(int mask = 0; mask < NUM_PITCH_MASKS; mask++) {
+        VectorXd notesPresent = VectorXd::Zero(12);
+        for(int n = 0; n < 12; n++) {
+            if(mask & (1 << n)) notesPresent(n) = 1;
+        }
+        for(int key = 1; key <= NUM_KEYS; key++) {
+            worst = max(worst,fabs(table(key-1,mask) - getPitchKeyValue(notesPresent,key)));
+        }
+    }
+    CHECK(worst == 0.0);
+
+    //minor keys use the minor profile, e.g. A minor with just an A and a C
+    CHECK(table(NUM_KEYS,(1 << 0) | (1 << 3)) == Approx(minorProfile[0] + minorProfile[3])); //keys[12] is Am
+    CHECK(pitchClassMask({1,4,0,4}) == ((1 << 0) | (1 << 3)));
+
+    //the contiguous path against the plain O(keys^2) dynamic programming
+    RngStream gen(3);
+    uniform_int_distribution<int> maskDis(0,NUM_PITCH_MASKS-1);
+    for(int trial = 0; trial < 100; trial++) {
+        int numSegments = 1 + trial % 15;
+        vector<vector<int>> segments;
+        for(int i = 0; i < numSegments; i++) {
+            int mask = (trial % 4 == 0) ? 0x091 : maskDis(gen); //repeats give ties
+            vector<int> segment;
+            for(int n = 0; n < 12; n++) {
+                if(mask & (1 << n)) segment.push_back(n + 1);
+            }
+            segments.push_back(segment);
+        }
+
+        MatrixXd scores = getPitchKeyMatrix(segments);
+        vector<int> path = getBestKeyIndices(scores,MODULATION_PENALTY);
+
+        MatrixXd sums = MatrixXd::Zero(NUM_KEYS,numSegments);
+        MatrixXi back = MatrixXi::Constant(NUM_KEYS,numSegments,-1);
+        sums.col(0) = scores.col(0);
+        for(int i = 1; i < numSegments; i++) {
+            for(int j = 0; j < NUM_KEYS; j++) {
+                double bestJ = -1;
+                for(int k = 0; k < NUM_KEYS; k++) {
+                    double newSum = scores(j,i) + sums(k,i-1) - ((j != k) ? MODULATION_PENALTY : 0.0);
+                    if(newSum > bestJ) {
+                        bestJ = newSum;
+                        back(j,i) = k;
+                    }
+                }
+                sums(j,i) = bestJ;
+            }
+        }
+        int key = 0;
+        for(int k = 1; k < NUM_KEYS; k++) {
+            if(sums(k,numSegments-1) > sums(key,numSegments-1)) key = k;
+        }
+        for(int i = numSegments - 1; i >= 0; i--) {
+            REQUIRE(path.at(i) == key);
+            key = back(key,i);
+        }
+
+        vector<string> named = getBestPath(getBestSums(getPitchKeyValues(segments),MODULATION_PENALTY));
+        for(int i = 0; i < numSegments; i++) {
+            REQUIRE(named.at(i) == valToKey(path.at(i) + 1));
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * file tests the shared random streams
+ * Author: Charlie Street
+ */
+
+#define CATCH_CONFIG_MAIN
+
+#include "../../include/test/catch.hpp"
+#include "../../include/random/rng.h"
+#include <random>
+#include <vector>
+#include <set>
+
+using namespace std;
+
+/**
+ * the same seed should always give the same numbers
+ */
+TEST_CASE("Tests streams are reproducible", "[reproducible]") {
+    RngStream a(1234);
+    RngStream b(1234);
+    RngStream c(1235);
+
+    bool differs = false;
+    for(int i = 0; i < 100; i++) {
+        uint64_t fromA = a();
+        CHECK(fromA == b());
+        if(fromA != c()) differs = true;
+    }
+    CHECK(differs);
+
+    //reseeding restarts the stream
+    RngStream d(99);
+    uint64_t first = d();
+    d();
+    d.seed(99);
+    CHECK(d() == first);
+
+    //new streams are numbered from the global seed
+    setGlobalSeed(7);
+    RngStream first1 = newRngStream();
+    RngStream second1 = newRngStream();
+    setGlobalSeed(7);
+    RngStream first2 = newRngStream();
+    RngStream second2 = newRngStream();
+    CHECK(getGlobalSeed() == 7);
+    CHECK(first1() == first2());
+    CHECK(second1() == second2());
+
+    //two streams made one after the other don't match
+    RngStream x = newRngStream();
+    RngStream y = newRngStream();
+    CHECK(x() != y());
+}
+
+/**
+ * split streams depend only on the id, and differ between ids
+ */
+TEST_CASE("Tests splitting streams", "[split]") {
+    RngStream parent(42);
+    RngStream before = parent.split(3);
+    for(int i = 0; i < 10; i++) parent();
+    RngStream after = parent.split(3);
+    CHECK(before() == after());
+
+    set<uint64_t> firsts;
+    for(uint64_t id = 0; id < 1000; id++) {
+        firsts.insert(parent.split(id)());
+    }
+    CHECK(firsts.size() == 1000);
+}
+
+/**
+ * streams should work with the standard distributions and look uniform
+ */
+TEST_CASE("Tests streams with standard distributions", "[distributions]") {
+    RngStream gen(5);
+
+    uniform_real_distribution<double> unit(0.0,1.0);
+    vector<int> buckets(10,0);
+    int samples = 100000;
+    for(int i = 0; i < samples; i++) {
+        double u = unit(gen);
+        if(u >= 0.0 && u < 1.0) buckets.at((unsigned long)(u * 10))++;
+    }
+    int inRange = 0;
+    for(int count : buckets) inRange += count;
+    CHECK(inRange == samples);
+    for(int count : buckets) {
+        CHECK((double)count / samples == Approx(0.1).margin(0.01));
+    }
+
+    //each bit set about half the time
+    int ones = 0;
+    for(int i = 0; i < 10000; i++) ones += (int)(gen() & 1ULL);
+    CHECK((double)ones / 10000 == Approx(0.5).margin(0.03));
+}
@@ -0,0 +1,465 @@
+/**
+ * headless benchmark of the whole runtime: listen -> detect -> predict -> respond
+ * audio comes from wav files through a virtual input device instead of a sound card,
+ * and responses are played into a memory (or midi file) sink, so no audio or midi hardware is needed
+ * the same detection, turn taking and model code as the runtime is used
+ * Author: Charlie Street
+ */
+
+#include "../../include/runtime/virtualInput.h"
+#include "../../include/runtime/noteDetector.h"
+#include "../../include/runtime/timers.h"
+#include "../../include/midi/midiSink.h"
+#include "../../include/model/fpm.h"
+#include "../../include/random/rng.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#define BENCH_RING_SIZE (1048576 / sizeof(float)) //the same size of ring as the runtime
+#define BENCH_TAIL_SECONDS 1.0 //silence after each input so its last phrase can end
+#define BENCH_FINISH_MS 2000 //longest wait for the threads to catch up after an input
+#define BENCH_SEED 42
+
+//the synthesised input, two phrases with a gap long enough for a turn between them
+#define SYNTH_RATE 44100
+#define SYNTH_NOTE_SECONDS 0.25
+#define SYNTH_GAP_SECONDS 1.0
+#define SYNTH_AMPLITUDE 0.3
+
+/**
+ * running statistics for how long a stage takes
+ */
+struct stageTimer {
+    long count;
+    double total; //seconds
+    double worst; //seconds
+
+    stageTimer(): count(0), total(0.0), worst(0.0){}
+
+    void add(double seconds) {
+        count++;
+        total += seconds;
+        worst = max(worst, seconds);
+    }
+
+    double mean() const {
+        return count == 0 ? 0.0 : total / count;
+    }
+};
+
+/**
+ * everything measured while running one input
+ */
+struct benchRun {
+    stageTimer hops; //pitch estimate per hop
+    stageTimer blocks; //turn taking per block
+    vector<turnRecord> responses;
+    vector<int> detected; //every note (not rest) which reached the model, or was discarded
+    uint64_t detectOverruns;
+    uint64_t turnOverruns;
+    atomic<uint64_t> detectPosition;
+    atomic<uint64_t> turnPosition;
+
+    benchRun(): detectOverruns(0), turnOverruns(0), detectPosition(0), turnPosition(0){}
+};
+
+/**
+ * timing hook for the pitch tracker and the turn taking
+ * @param seconds the time taken by the hop or block
+ * @param userData the stage timer to add it to
+ */
+static void timeStage(double seconds, void *userData) {
+    ((stageTimer*)userData)->add(seconds);
+}
+
+/**
+ * @param start when something started
+ * @return the seconds since then
+ */
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * does the job of the update thread
+ * @param ring the audio ring
+ * @param notes where detected notes go
+ * @param run where measurements go
+ * @param running the running state of the benchmark
+ */
+void detectWorker(const AudioRing *ring, NoteQueue *notes, benchRun *run, const atomic<bool> *running) {
+    AudioRingReader reader(*ring);
+    NoteDetector detector(notes);
+    detector.setTimingHook(timeStage, &run->hops);
+    vector<float> hop((unsigned long)detector.hopSize());
+
+    while(*running) {
+        if(!reader.wait(hop.size(), SILENCE_WAIT_MS)) continue;
+
+        if(reader.read(hop.data(),hop.size()) == hop.size()) {
+            detector.addHop(hop.data(), reader.position());
+        }
+        notes->markHeard(reader.position());
+        run->detectPosition = reader.position();
+    }
+    run->detectOverruns = reader.overruns();
+}
+
+/**
+ * what the benchmark needs to play responses, sped up along with the audio
+ */
+struct benchPlayback {
+    MidiPlayer *player;
+    double sampleRate;
+    double speed;
+    uint64_t responseEnd; //where the response finishes in the audio
+    boost::thread thread;
+    const atomic<bool> *running;
+};
+
+/**
+ * the response has finished playing once enough audio has gone by
+ * @param position how far through the audio the timer has got
+ * @param userData the benchmark playback
+ * @return true if the response has finished
+ */
+static bool audioClock(uint64_t position, void *userData) {
+    return position >= ((benchPlayback*)userData)->responseEnd;
+}
+
+/**
+ * plays a response through the midi player at the speed of the audio
+ * @param events the midi messages of the response
+ * @param start where in the audio the response starts playing
+ * @param userData the benchmark playback
+ */
+static void speedSink(const vector<midiEvent> &events, uint64_t start, void *userData) {
+    auto *playback = (benchPlayback*)userData;
+    playback->responseEnd = start + (uint64_t)(events.back().time * playback->sampleRate);
+
+    //the turn taking goes by the audio, so the response is played at the same speed
+    vector<midiEvent> scaled(events);
+    for(midiEvent &event : scaled) event.time /= playback->speed;
+    if(playback->thread.joinable()) playback->thread.join(); //the last response has finished by the audio
+    MidiPlayer *player = playback->player;
+    const atomic<bool> *running = playback->running;
+    playback->thread = boost::thread([player, scaled, running]() {
+        player->play(scaled, *running);
+    });
+}
+
+/**
+ * does the job of the timer thread, with the same turn step as the runtime
+ * responses are played through the midi player, sped up along with the audio
+ * @param ring the audio ring
+ * @param notes the detected notes
+ * @param model the model, or nullptr to echo the user's phrase back
+ * @param candidates phrases generated for each response (1 for a single phrase)
+ * @param sampleRate the sample rate of the audio
+ * @param speed how much faster than real time the audio is played
+ * @param player plays responses into the sink
+ * @param run where measurements go
+ * @param running the running state of the benchmark
+ */
+void turnWorker(const AudioRing *ring, NoteQueue *notes, FPM *model, unsigned int candidates, double sampleRate,
+                double speed, MidiPlayer *player, benchRun *run, const atomic<bool> *running) {
+    benchPlayback playback;
+    playback.player = player;
+    playback.sampleRate = sampleRate;
+    playback.speed = speed;
+    playback.responseEnd = 0;
+    playback.running = running;
+
+    //every note detected, whether it reached the model or was thrown away as the response
+    vector<noteEvent> heard;
+    TurnStep step(*ring, notes, model, sampleRate, audioClock, &playback, speedSink, &playback);
+    step.setCandidates(candidates);
+    step.setTimingHook(timeStage, &run->blocks);
+    step.setHeardLog(&heard);
+
+    while(*running) {
+        turnEvent event = step.step(*running);
+        run->turnPosition = step.position();
+        if(event == userFinished && step.getLastTurn().phraseNotes != 0) {
+            run->responses.push_back(step.getLastTurn());
+        }
+    }
+    if(playback.thread.joinable()) playback.thread.join();
+
+    //in the order they finished, so the detection accuracy doesn't depend on what was thrown away
+    stable_sort(heard.begin(), heard.end(), [](const noteEvent &a, const noteEvent &b) {
+        return a.endSample < b.endSample;
+    });
+    for(const noteEvent &event : heard) {
+        if(event.note != 0) run->detected.push_back(event.note);
+    }
+    run->turnOverruns = step.overruns();
+}
+
+/**
+ * the edit distance between two note sequences
+ * @param a the first sequence
+ * @param b the second sequence
+ * @return the number of insertions, deletions and substitutions to turn a into b
+ */
+int editDistance(const vector<int> &a, const vector<int> &b) {
+    vector<int> previous(b.size() + 1);
+    vector<int> current(b.size() + 1);
+    for(unsigned long j = 0; j <= b.size(); j++) previous.at(j) = (int)j;
+
+    for(unsigned long i = 1; i <= a.size(); i++) {
+        current.at(0) = (int)i;
+        for(unsigned long j = 1; j <= b.size(); j++) {
+            int substitute = previous.at(j-1) + (a.at(i-1) == b.at(j-1) ? 0 : 1);
+            current.at(j) = min(substitute, min(previous.at(j), current.at(j-1)) + 1);
+        }
+        swap(previous,current);
+    }
+    return previous.at(b.size());
+}
+
+/**
+ * synthesises a melody with known notes, so detection accuracy can always be measured
+ * @param reference set to the notes played
+ * @return the mono samples
+ */
+vector<float> synthesiseMelody(vector<int> &reference) {
+    vector<vector<int>> phrases = {{36,38,40,41,43,45,47,48}, {48,43,40,36,41,45}};
+    NoteMap noteMap;
+
+    auto noteLength = (unsigned long)(SYNTH_NOTE_SECONDS * SYNTH_RATE);
+    auto gapLength = (unsigned long)(SYNTH_GAP_SECONDS * SYNTH_RATE);
+    auto fade = (unsigned long)(0.005 * SYNTH_RATE); //stops clicks between notes
+
+    vector<float> samples(gapLength, 0.0f);
+    reference.clear();
+    for(const vector<int> &phrase : phrases) {
+        for(int note : phrase) {
+            double freq = noteMap.frequency(note);
+            for(unsigned long i = 0; i < noteLength; i++) {
+                double t = i / (double)SYNTH_RATE;
+                double envelope = min(1.0, min(i, noteLength - i) / (double)fade);
+                double wave = sin(2.0 * M_PI * freq * t) + 0.3 * sin(4.0 * M_PI * freq * t);
+                samples.push_back((float)(SYNTH_AMPLITUDE * envelope * wave));
+            }
+            reference.push_back(note);
+        }
+        samples.insert(samples.end(), gapLength, 0.0f);
+    }
+    return samples;
+}
+
+/**
+ * reads the notes expected from a file, if there is one
+ * @param filePath the file of whitespace separated notes
+ * @param reference set to the notes
+ * @return true if the file was found
+ */
+bool readReference(const string &filePath, vector<int> &reference) {
+    ifstream file(filePath);
+    if(!file.is_open()) return false;
+
+    reference.clear();
+    int note;
+    while(file >> note) reference.push_back(note);
+    return true;
+}
+
+/**
+ * prints the statistics for a stage
+ * @param name the name of the stage
+ * @param stage the timings of the stage
+ * @param audioSeconds the length of the audio, to give the share of real time
+ */
+void printStage(const string &name, const stageTimer &stage, double audioSeconds) {
+    cout << "  " << name << ": " << stage.count << " calls, mean " << stage.mean() * 1000.0
+         << " (ms), worst " << stage.worst * 1000.0 << " (ms), "
+         << 100.0 * stage.total / audioSeconds << "% of real time" << endl;
+}
+
+/**
+ * runs one input through the whole runtime and reports on it
+ * @param name the name to print
+ * @param samples the interleaved audio
+ * @param channels the number of interleaved channels
+ * @param sampleRate the sample rate of the audio
+ * @param reference the notes expected (empty if unknown)
+ * @param model the model, or nullptr to echo phrases back
+ * @param candidates phrases generated for each response (1 for a single phrase)
+ * @param speed how much faster than real time to play the audio
+ * @param sink where responses are played
+ */
+void runInput(const string &name, vector<float> samples, int channels, double sampleRate,
+              const vector<int> &reference, FPM *model, unsigned int candidates, double speed, MidiSink *sink) {
+
+    //silence at the end lets the last phrase finish
+    samples.insert(samples.end(), (unsigned long)(BENCH_TAIL_SECONDS * sampleRate) * channels, 0.0f);
+
+    passToCallback callbackData(BENCH_RING_SIZE);
+    NoteQueue notes;
+    benchRun run;
+    MidiPlayer player(sink);
+    atomic<bool> running(true);
+
+    VirtualInput input(std::move(samples), channels, sampleRate, &callbackData, speed);
+    double audioSeconds = input.duration();
+    uint64_t total = input.totalFrames();
+
+    boost::thread detectThread(detectWorker, &callbackData.ring, &notes, &run, &running);
+    boost::thread turnThread(turnWorker, &callbackData.ring, &notes, model, candidates, sampleRate, speed,
+                              &player, &run, &running);
+
+    clock_t cpuStart = clock();
+    auto wallStart = chrono::steady_clock::now();
+    input.start();
+    while(!input.finished()) boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+
+    //let both threads get to the end of the audio
+    for(int i = 0; i < BENCH_FINISH_MS && (run.detectPosition + PITCH_HOP < total ||
+                                           run.turnPosition + SILENCE_BLOCK < total); i++) {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+    running = false;
+    detectThread.join();
+    turnThread.join();
+    input.stop();
+    double wallSeconds = secondsSince(wallStart);
+    double cpuSeconds = (clock() - cpuStart) / (double)CLOCKS_PER_SEC;
+
+    //anything left never reached the model, but was still detected
+    noteEvent left;
+    while(notes.pop(left)) {
+        if(left.note != 0) run.detected.push_back(left.note);
+    }
+
+    cout << "== " << name << " (" << audioSeconds << " (s) at " << speed << "x) ==" << endl;
+
+    cout << "Notes detected: " << run.detected.size();
+    if(!reference.empty()) {
+        int errors = editDistance(run.detected, reference);
+        double accuracy = max(0.0, 1.0 - errors / (double)reference.size());
+        cout << ", reference: " << reference.size() << ", edit distance: " << errors
+             << ", accuracy: " << 100.0 * accuracy << "%";
+    }
+    cout << endl;
+
+    cout << "Turns: " << run.responses.size() << endl;
+    stageTimer silence, collect, predict, ready, endToEnd;
+    for(const turnRecord &response : run.responses) {
+        double heard = (response.trigger - response.phraseEnd) / sampleRate;
+        silence.add(heard);
+        collect.add(response.collectTime);
+        predict.add(response.predictTime);
+        ready.add(response.readyTime);
+        endToEnd.add(heard + response.readyTime);
+        cout << "  phrase of " << response.phraseNotes << " notes and rests, response of " << response.output.rows()
+             << " notes ready " << (heard + response.readyTime) * 1000.0 << " (ms) after the phrase ended" << endl;
+    }
+    if(!run.responses.empty()) {
+        cout << "Turn latency (phrase end -> response playing): mean " << endToEnd.mean() * 1000.0
+             << " (ms), worst " << endToEnd.worst * 1000.0 << " (ms)" << endl;
+        cout << "  silence before the trigger: mean " << silence.mean() * 1000.0 << " (ms)" << endl;
+        cout << "  trigger -> response: mean " << ready.mean() * 1000.0 << " (ms), worst "
+             << ready.worst * 1000.0 << " (ms)" << endl;
+        cout << "Midi messages sent: " << player.eventsSent() << ", lateness: mean "
+             << player.meanLateness() * 1000.0 << " (ms), worst " << player.maxLateness() * 1000.0 << " (ms)" << endl;
+    }
+
+    cout << "Time per stage:" << endl;
+    printStage("pitch detection (per hop)", run.hops, audioSeconds);
+    printStage("turn taking (per block)", run.blocks, audioSeconds);
+    printStage("collecting the phrase (per turn)", collect, audioSeconds);
+    printStage(model != nullptr ? "prediction (per turn)" : "echo (per turn)", predict, audioSeconds);
+
+    cout << "Overruns: detection " << run.detectOverruns << ", turn taking " << run.turnOverruns
+         << ", notes dropped " << notes.droppedCount() << endl;
+    cout << "Process CPU: " << cpuSeconds << " (s) over " << wallSeconds << " (s) ("
+         << 100.0 * cpuSeconds / wallSeconds << "% of one core)" << endl << endl;
+}
+
+/**
+ * runs the benchmark
+ * usage: RUNTIME_BENCH [--speed x] [--candidates k] [--synth] [--smf file] [wav files...]
+ * with no files, the human recordings in evaluation/original are used
+ * with --candidates, the best of k phrases is played for each response (one by default, as in the runtime)
+ * with --smf, every response is also written to a midi file
+ * a file of the expected notes can be put next to a wav file as <file>.notes
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 if everything ran, 1 otherwise
+ */
+int main(int argc, char **argv) {
+
+    //the same responses every run
+    setGlobalSeed(BENCH_SEED);
+
+    double speed = 1.0;
+    unsigned int candidates = 1;
+    bool synth = false;
+    string smfFile;
+    vector<string> files;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i],"--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if(strcmp(argv[i],"--candidates") == 0 && i + 1 < argc) {
+            candidates = (unsigned int)max(1, atoi(argv[++i]));
+        } else if(strcmp(argv[i],"--synth") == 0) {
+            synth = true;
+        } else if(strcmp(argv[i],"--smf") == 0 && i + 1 < argc) {
+            smfFile = argv[++i];
+        } else {
+            files.emplace_back(argv[i]);
+        }
+    }
+    if(files.empty() && !synth) {
+        for(int i = 1; i <= 5; i++) files.push_back("evaluation/original/human" + to_string(i) + ".wav");
+    }
+
+    shared_ptr<FPM> model;
+    try {
+        model = make_shared<FPM>(B_NOTE_PATH,N_NOTE_PATH,T_NOTE_PATH,K_NOTE,T_NOTE,
+                                 B_DIR_PATH,N_DIR_PATH,T_DIR_PATH,K_DIR,T_DIR);
+    } catch(const char *e) {
+        cout << "Model not loaded (" << e << "), phrases will be echoed back instead" << endl << endl;
+    }
+
+    shared_ptr<MidiSink> sink;
+    if(smfFile.empty()) {
+        sink = make_shared<MemoryMidiSink>();
+    } else {
+        sink = make_shared<SmfMidiSink>(smfFile);
+    }
+
+    try {
+        if(synth) {
+            vector<int> reference;
+            vector<float> samples = synthesiseMelody(reference);
+            runInput("synthesised melody", samples, 1, SYNTH_RATE, reference, model.get(), candidates, speed,
+                     sink.get());
+        }
+
+        for(const string &file : files) {
+            int channels;
+            int sampleRate;
+            vector<float> samples = readWavFile(file, channels, sampleRate);
+            if(sampleRate != (int)PITCH_RATE) {
+                cout << "Skipping " << file << ", the runtime expects " << PITCH_RATE << "Hz" << endl;
+                continue;
+            }
+
+            vector<int> reference;
+            readReference(file + ".notes", reference);
+            runInput(file, samples, channels, sampleRate, reference, model.get(), candidates, speed, sink.get());
+        }
+    } catch(const char *e) {
+        cout << "Benchmark failed: " << e << endl;
+        return 1;
+    }
+
+    return 0;
+}
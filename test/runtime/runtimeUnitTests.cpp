@@ -9,8 +9,17 @@
 
 #include "../../include/test/catch.hpp"
 #include "../../include/runtime/init_close.h"
+#include "../../include/runtime/pitchTracker.h"
+#include "../../include/runtime/noteMap.h"
+#include "../../include/runtime/noteQueue.h"
+#include "../../include/runtime/timers.h"
+#include "../../include/runtime/noteDetector.h"
+#include "../../include/random/rng.h"
 #include <iostream>
 #include <cstring>
+#include <cmath>
+#include <random>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -48,22 +57,12 @@ TEST_CASE("Tests the device searching and setup/teardown of the system","[init_c
     REQUIRE(devNum != -1);
     cout << "Found Device: " << devNum << endl;
 
-    shared_ptr<HANDLE> event = make_shared<HANDLE>();
-    *event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    REQUIRE(*event);
-    cout << "Created Event" << endl;
-
-
-    shared_ptr<HMIDISTRM> outHandle = make_shared<HMIDISTRM>();
-    unsigned long err = 0;
-    err = midiStreamOpen(outHandle.get(), (LPUINT)&err, 1, (DWORD)(*event), 0, CALLBACK_EVENT);
-    REQUIRE(!err);
-    cout << "Set Up Midi Output Stream" << endl;
-
-    ResetEvent(*event);
+    //nothing is played in this test, so the midi can just be kept in memory
+    shared_ptr<MidiSink> midiOut = make_shared<MemoryMidiSink>();
+    cout << "Set Up Midi Output" << endl;
 
     pair<PaError, shared_ptr<globalState>> global = initSystem(44100,preInit.second.at(
-            static_cast<unsigned int>(devNum)),outHandle,event);
+            static_cast<unsigned int>(devNum)),midiOut);
 
     cout << Pa_GetErrorText(global.first) << endl;
     REQUIRE(global.first == paNoError);
@@ -72,8 +71,10 @@ TEST_CASE("Tests the device searching and setup/teardown of the system","[init_c
 
     //check global state seems fine
     shared_ptr<globalState> state = global.second;
-    CHECK(state->callbackData->sampleJump == 10);
-    CHECK(state->callbackData->nextSample == 0);
+    CHECK(state->callbackData->channelCount >= 1);
+    CHECK(state->callbackData->ring.written() == 0);
+    CHECK(state->notes != nullptr);
+    CHECK(state->midiOut == midiOut);
     CHECK(*(state->running));
 
     //tear down the system
@@ -86,10 +87,642 @@ TEST_CASE("Tests the device searching and setup/teardown of the system","[init_c
     REQUIRE(paErr == paNoError);
     cout << "Terminated Port Audio" << endl;
 
-    midiStreamClose(*outHandle);
-    CloseHandle(*event);
 
 
 
+}
+
+/**
+ * tests the audio callback writes channel 0 of the input to the ring
+ * and that every reader sees all of it
+ * no device is needed, the callback is called directly
+ */
+TEST_CASE("Tests the audio callback de-interleaves into the ring buffer","[callback]") {
+
+    const int ringSize = 64; //must be a power of 2
+    passToCallback info(ringSize);
+
+    for(int channels : {1,2,3}) {
+        AudioRingReader update(info.ring);
+        AudioRingReader timer(info.ring);
+        update.skipToNow();
+        timer.skipToNow();
+        info.channelCount = channels;
+
+        //odd sized buffers, so the writes wrap around the end of the ring
+        float next = 0.0f;
+        float expected = 0.0f;
+        for(int call = 0; call < 10; call++) {
+            unsigned long frames = 13 + call;
+            vector<float> input(frames * channels);
+            for(unsigned long f = 0; f < frames; f++) {
+                input.at(f * channels) = next++;
+                for(int c = 1; c < channels; c++) input.at(f * channels + c) = -1.0f; //never wanted
+            }
+
+            REQUIRE(audioCallback(input.data(),nullptr,frames,nullptr,0,&info) == paContinue);
+
+            float fromUpdate[64];
+            float fromTimer[64];
+            REQUIRE(update.read(fromUpdate,frames) == frames);
+            REQUIRE(timer.read(fromTimer,frames) == frames);
+            for(unsigned long f = 0; f < frames; f++) {
+                CHECK(fromUpdate[f] == expected);
+                CHECK(fromTimer[f] == expected);
+                expected++;
+            }
+        }
+        CHECK(update.overruns() == 0);
+        CHECK(timer.overruns() == 0);
+    }
+
+    //a buffer bigger than the ring only leaves its newest samples
+    info.channelCount = 2;
+    AudioRingReader reader(info.ring);
+    reader.skipToNow();
+    vector<float> big(2 * (ringSize + 10));
+    for(int f = 0; f < ringSize + 10; f++) big.at(2 * f) = (float)f;
+    audioCallback(big.data(),nullptr,ringSize + 10,nullptr,0,&info);
+    CHECK(reader.available() == ringSize);
+    float out[ringSize];
+    REQUIRE(reader.read(out,ringSize) == ringSize);
+    CHECK(reader.overruns() == 10);
+    for(int i = 0; i < ringSize; i++) CHECK(out[i] == (float)(i + 10));
+}
+
+/**
+ * tests the audio ring gives each reader its own cursor
+ * and detects when a reader has been lapped by the producer
+ */
+TEST_CASE("Tests the single producer, multiple consumer audio ring","[audioRing]") {
+
+    REQUIRE_THROWS(AudioRing(100)); //not a power of 2
+    REQUIRE_THROWS(AudioRing(0));
+
+    AudioRing ring(16);
+    CHECK(ring.capacity() == 16);
+    CHECK(ring.written() == 0);
+
+    AudioRingReader fast(ring);
+    AudioRingReader slow(ring);
+    CHECK(fast.available() == 0);
+
+    vector<float> input(40);
+    for(int i = 0; i < 40; i++) input.at(i) = (float)i;
+
+    float out[16];
+
+    //the fast reader keeps up the whole way
+    for(int i = 0; i < 40; i += 8) {
+        ring.write(input.data() + i,8,1);
+        REQUIRE(fast.read(out,16) == 8);
+        for(int j = 0; j < 8; j++) CHECK(out[j] == (float)(i + j));
+    }
+    CHECK(fast.overruns() == 0);
+    CHECK(ring.written() == 40);
+
+    //the slow reader was lapped, so only the last 16 samples are left for it
+    CHECK(slow.available() == 16);
+    REQUIRE(slow.read(out,16) == 16);
+    CHECK(slow.overruns() == 24);
+    for(int j = 0; j < 16; j++) CHECK(out[j] == (float)(24 + j));
+
+    //partial reads carry on from where they left off
+    ring.write(input.data(),10,1);
+    REQUIRE(slow.read(out,4) == 4);
+    REQUIRE(slow.read(out + 4,16) == 6);
+    for(int j = 0; j < 10; j++) CHECK(out[j] == (float)j);
+
+    //skipping isn't counted as lost, and a new reader starts at the oldest sample held
+    fast.skipToNow();
+    CHECK(fast.available() == 0);
+    CHECK(fast.overruns() == 0);
+    AudioRingReader late(ring);
+    CHECK(late.available() == 16);
+    REQUIRE(late.read(out,16) == 16);
+    CHECK(out[15] == 9.0f);
+    CHECK(late.overruns() == 0);
+}
+
+/**
+ * tests reading the audio ring in place, and sleeping until data arrives
+ */
+TEST_CASE("Tests reading the audio ring in place","[audioRing]") {
+
+    AudioRing ring(16);
+    AudioRingReader reader(ring);
+    vector<float> input(40);
+    for(int i = 0; i < 40; i++) input.at(i) = (float)i;
+
+    //nothing there yet, so the wait times out
+    CHECK(!reader.wait(4,1));
+
+    //regions wrap around the end of the ring
+    ring.write(input.data(),12,1);
+    const float *region1;
+    const float *region2;
+    unsigned long size1;
+    unsigned long size2;
+    REQUIRE(reader.readRegions(12,region1,size1,region2,size2) == 12);
+    CHECK(size1 == 12);
+    CHECK(size2 == 0);
+    CHECK(reader.finishRead(12) == 0);
+
+    ring.write(input.data() + 12,8,1);
+    REQUIRE(reader.wait(8,1));
+    REQUIRE(reader.readRegions(100,region1,size1,region2,size2) == 8);
+    CHECK(size1 == 4);
+    CHECK(size2 == 4);
+    for(unsigned long i = 0; i < size1; i++) CHECK(region1[i] == (float)(12 + i));
+    for(unsigned long i = 0; i < size2; i++) CHECK(region2[i] == (float)(16 + i));
+
+    //samples overwritten while in use are reported
+    ring.write(input.data() + 20,10,1);
+    CHECK(reader.finishRead(8) == 2);
+    CHECK(reader.overruns() == 2);
+    CHECK(reader.available() == 10);
+
+    //a sleeping reader is woken by the producer
+    reader.skipToNow();
+    boost::thread producer([&ring, &input]{
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+        ring.write(input.data(),6,1);
+    });
+    CHECK(reader.wait(6,5000));
+    producer.join();
+    CHECK(reader.available() == 6);
+}
+
+/**
+ * tests the block levels against a sample at a time
+ */
+TEST_CASE("Tests measuring the levels of a block","[audioRing]") {
+
+    RngStream gen(5);
+    normal_distribution<float> normal(0.0f,0.1f);
+
+    for(long count : {0L, 1L, 3L, 4L, 7L, 256L, 1001L}) {
+        vector<float> samples((unsigned long)count);
+        for(float &x : samples) x = normal(gen);
+
+        double sumSquares = 0.0;
+        float peak = 0.0f;
+        long aboveQuiet = 0;
+        long aboveLoud = 0;
+        for(float x : samples) {
+            sumSquares += (double)x * x;
+            peak = max(peak,fabs(x));
+            if(fabs(x) > 0.05f) aboveQuiet++;
+            if(fabs(x) > 0.2f) aboveLoud++;
+        }
+
+        //measured in two parts, as for a block which wraps around the ring
+        blockLevel level;
+        long split = count / 3;
+        measureBlock(samples.data(),split,0.05f,0.2f,level);
+        measureBlock(samples.data() + split,count - split,0.05f,0.2f,level);
+
+        CHECK(level.count == count);
+        CHECK(level.sumSquares == Approx(sumSquares).epsilon(1e-4));
+        CHECK(level.peak == peak);
+        CHECK(level.aboveQuiet == aboveQuiet);
+        CHECK(level.aboveLoud == aboveLoud);
+        CHECK(level.rms() == Approx(count > 0 ? sqrt(sumSquares / count) : 0.0).epsilon(1e-4));
+    }
+}
+
+/**
+ * used to count the calls to the timing hook
+ * @param seconds how long the analysis took
+ * @param userData a pair of call count and total time
+ */
+static void countTiming(double seconds, void *userData) {
+    auto *totals = (pair<int,double>*)userData;
+    totals->first++;
+    totals->second += seconds;
+}
+
+/**
+ * tests the pitch tracker finds the pitch of a few synthetic notes
+ * to within a few cents, and reports silence and noise as 0
+ */
+TEST_CASE("Tests the hop based pitch tracker","[pitchTracker]") {
+
+    pitchConfig config;
+    PitchTracker tracker(config);
+    REQUIRE(tracker.hopSize() == PITCH_HOP);
+    CHECK(tracker.hopDuration() == Approx(PITCH_HOP / PITCH_RATE));
+
+    vector<float> hop((unsigned long)tracker.hopSize());
+    int hopsPerWindow = PITCH_WINDOW / PITCH_HOP;
+
+    //silence
+    for(int h = 0; h < hopsPerWindow; h++) CHECK(tracker.addHop(hop.data()) == 0.0);
+
+    //a harmonic rich tone at a few frequencies, including between the notes
+    for(double freq : {55.0, 110.0, 196.0, 261.63, 440.0, 450.0, 987.77}) {
+        tracker.reset();
+        long t = 0;
+        double estimate = 0.0;
+        for(int h = 0; h < hopsPerWindow + 2; h++) {
+            for(float &x : hop) {
+                double phase = 2.0 * M_PI * freq * (t++) / PITCH_RATE;
+                x = (float)(0.5 * sin(phase) + 0.25 * sin(2.0 * phase) + 0.1 * sin(3.0 * phase));
+            }
+            estimate = tracker.addHop(hop.data());
+        }
+        REQUIRE(estimate > 0.0);
+        CHECK(fabs(1200.0 * log2(estimate / freq)) < 5.0); //within 5 cents
+    }
+
+    //each hop is timed through the hook, until it's turned off
+    pair<int,double> totals(0,0.0);
+    tracker.setTimingHook(countTiming,&totals);
+    for(int h = 0; h < 3; h++) tracker.addHop(hop.data());
+    CHECK(totals.first == 3);
+    CHECK(totals.second >= 0.0);
+    tracker.setTimingHook(nullptr);
+    tracker.addHop(hop.data());
+    CHECK(totals.first == 3);
+
+    //noise has no pitch
+    tracker.reset();
+    RngStream gen(7);
+    uniform_real_distribution<float> noise(-0.5f,0.5f);
+    double estimate = -1.0;
+    for(int h = 0; h < hopsPerWindow; h++) {
+        for(float &x : hop) x = noise(gen);
+        estimate = tracker.addHop(hop.data());
+    }
+    CHECK(estimate == 0.0);
+
+    //a window which can't hold two periods of the lowest note
+    pitchConfig tooShort;
+    tooShort.windowSize = 512;
+    REQUIRE_THROWS(PitchTracker(tooShort));
+    pitchConfig badHop;
+    badHop.hopSize = PITCH_WINDOW + 1;
+    REQUIRE_THROWS(PitchTracker(badHop));
+}
+
+/**
+ * tests the note segmenter turns per hop estimates into notes
+ */
+TEST_CASE("Tests the segmenting of pitch estimates into notes","[pitchTracker]") {
+
+    NoteSegmenter segmenter(3);
+    pair<int,int> none = make_pair(-1,0);
+
+    //initial silence, and a glitch within it, are ignored
+    CHECK(segmenter.addNote(0) == none);
+    CHECK(segmenter.addNote(40) == none);
+    CHECK(segmenter.addNote(0) == none);
+
+    //the first note is accepted after 3 hops, but nothing has finished yet
+    for(int i = 0; i < 10; i++) CHECK(segmenter.addNote(40) == none);
+
+    //a one hop glitch is absorbed into the note
+    CHECK(segmenter.addNote(52) == none);
+    for(int i = 0; i < 4; i++) CHECK(segmenter.addNote(40) == none);
+
+    //a real change finishes the note, including the glitch
+    CHECK(segmenter.addNote(45) == none);
+    CHECK(segmenter.addNote(45) == none);
+    CHECK(segmenter.addNote(45) == make_pair(40,15));
+
+    //silence ends a note like any other
+    for(int i = 0; i < 2; i++) CHECK(segmenter.addNote(45) == none);
+    for(int i = 0; i < 2; i++) CHECK(segmenter.addNote(0) == none);
+    CHECK(segmenter.addNote(0) == make_pair(45,5));
+
+    //a reset starts from nothing again
+    segmenter.reset();
+    for(int i = 0; i < 5; i++) CHECK(segmenter.addNote(0) == none);
+}
+
+/**
+ * tests the mapping of frequencies onto notes
+ * against a scan over the frequencies of every note in range
+ */
+TEST_CASE("Tests the frequency to note mapping","[noteMap]") {
+
+    NoteMap noteMap;
+
+    //every note maps back to itself, with no offset
+    for(int note = NOTE_LOWEST; note <= NOTE_HIGHEST; note++) {
+        pair<int,double> quantised = noteMap.quantise(noteMap.frequency(note));
+        CHECK(quantised.first == note);
+        CHECK(fabs(quantised.second) < 1e-6);
+    }
+    CHECK(noteMap.frequency(NOTE_REFERENCE) == Approx(NOTE_REFERENCE_FREQ));
+    CHECK(noteMap.frequency(NOTE_REFERENCE + 12) == Approx(2.0 * NOTE_REFERENCE_FREQ));
+
+    //within the range, the closest note by cents
+    RngStream gen(3);
+    uniform_real_distribution<double> inRange(noteMap.frequency(NOTE_LOWEST),noteMap.frequency(NOTE_HIGHEST));
+    for(int i = 0; i < 1000; i++) {
+        double freq = inRange(gen);
+        int expected = NOTE_LOWEST;
+        for(int note = NOTE_LOWEST; note <= NOTE_HIGHEST; note++) {
+            if(fabs(log2(freq / noteMap.frequency(note))) < fabs(log2(freq / noteMap.frequency(expected)))) {
+                expected = note;
+            }
+        }
+        pair<int,double> quantised = noteMap.quantise(freq);
+        CHECK(quantised.first == expected);
+        CHECK(quantised.second == Approx(1200.0 * log2(freq / noteMap.frequency(expected))));
+        CHECK(fabs(quantised.second) <= 50.0);
+    }
+
+    //out of range frequencies are moved by octaves, keeping their cents
+    pair<int,double> low = noteMap.quantise(noteMap.frequency(NOTE_LOWEST - 22) * 1.01);
+    CHECK(low.first == NOTE_LOWEST + 2);
+    CHECK(low.second == Approx(1200.0 * log2(1.01)));
+    CHECK(noteMap.closestNote(noteMap.frequency(NOTE_HIGHEST + 1)) == NOTE_HIGHEST - 11);
+    CHECK(noteMap.closestNote(noteMap.frequency(NOTE_HIGHEST + 30)) == NOTE_HIGHEST - 6);
+
+    //silence
+    CHECK(noteMap.quantise(0.0) == make_pair(0,0.0));
+    CHECK(noteMap.closestNote(-10.0) == 0);
+    CHECK(noteMap.closestNote(nan("")) == 0);
+
+    //other tunings and ranges
+    NoteMap concert(440.0,48,36,60);
+    CHECK(concert.closestNote(442.0) == 48);
+    CHECK(concert.quantise(442.0).second == Approx(1200.0 * log2(442.0 / 440.0)));
+    CHECK(concert.closestNote(880.0) == 60); //top of the range
+    CHECK(concert.closestNote(1760.0) == 60); //folded down an octave
+    CHECK(concert.closestNote(110.0) == 48 - 12); //folded up an octave
+    REQUIRE_THROWS(NoteMap(440.0,48,40,50));
+    REQUIRE_THROWS(NoteMap(0.0));
+}
+
+/**
+ * tests the queue handing notes from the update thread to the model
+ */
+TEST_CASE("Tests the lock free note queue","[noteQueue]") {
+
+    REQUIRE_THROWS(NoteQueue(6)); //not a power of 2
+
+    NoteQueue queue(4);
+    noteEvent event;
+    CHECK(!queue.pop(event));
+    CHECK(queue.size() == 0);
+
+    //first in first out, and a full queue drops new notes
+    for(int i = 0; i < 4; i++) CHECK(queue.push(noteEvent(40 + i,0.5 * i)));
+    CHECK(!queue.push(noteEvent(99,1.0)));
+    CHECK(queue.droppedCount() == 1);
+    CHECK(queue.size() == 4);
+
+    for(int i = 0; i < 4; i++) {
+        REQUIRE(queue.pop(event));
+        CHECK(event.note == 40 + i);
+        CHECK(event.duration == 0.5 * i);
+    }
+    CHECK(!queue.pop(event));
+
+    //one thread pushing while another pops, nothing lost or reordered
+    NoteQueue shared(64);
+    const int total = 200000;
+    boost::thread producer([&shared]{
+        for(int i = 0; i < total; i++) {
+            while(!shared.push(noteEvent(i,(double)i))) boost::this_thread::yield();
+        }
+    });
+
+    int expected = 0;
+    bool inOrder = true;
+    while(expected < total) {
+        if(shared.pop(event)) {
+            inOrder = inOrder && event.note == expected && event.duration == (double)expected;
+            expected++;
+        }
+    }
+    producer.join();
+    CHECK(inOrder);
+    CHECK(shared.size() == 0);
+
+    //notes are only taken up to a point in the audio
+    CHECK(queue.heard() == 0);
+    queue.push(noteEvent(40,0.5,1000));
+    queue.push(noteEvent(41,0.5,2000));
+    queue.markHeard(2500);
+    CHECK(queue.heard() == 2500);
+    REQUIRE(queue.popBefore(1500,event));
+    CHECK(event.note == 40);
+    CHECK(!queue.popBefore(1500,event));
+    CHECK(queue.size() == 1);
+    REQUIRE(queue.popBefore(2000,event));
+    CHECK(event.note == 41);
+    CHECK(!queue.popBefore(5000,event));
+}
+
+/**
+ * makes the levels of a block of constant loudness
+ * @param loud whether the block is loud or silent
+ * @param loudThreshold the threshold loud samples are measured against
+ * @param amplitude the loudness of a loud block
+ * @return the levels
+ */
+blockLevel turnBlock(bool loud, float loudThreshold = NOISE_THRESHOLD, float amplitude = 0.5f) {
+    vector<float> block(SILENCE_BLOCK, loud ? amplitude : 0.0f);
+    blockLevel level;
+    measureBlock(block.data(), (long)block.size(), SILENCE_THRESHOLD, loudThreshold, level);
+    return level;
+}
+
+TEST_CASE("Tests the turn taking state machine","[timers]") {
+
+    TurnTaker turns;
+    uint64_t position = 0;
+    CHECK(turns.getState() == waitingForUser);
+
+    //silence doesn't start anything
+    for(int i = 0; i < 100; i++) {
+        position += SILENCE_BLOCK;
+        CHECK(turns.addBlock(turnBlock(false),position) == noTurnEvent);
+    }
+    CHECK(turns.getState() == waitingForUser);
+
+    //the user starts once enough loud samples have been heard
+    int blocks = 0;
+    turnEvent event = noTurnEvent;
+    while(event == noTurnEvent && blocks < 100) {
+        position += SILENCE_BLOCK;
+        event = turns.addBlock(turnBlock(true),position);
+        blocks++;
+    }
+    CHECK(event == userStarted);
+    CHECK(blocks == START_THRESHOLD / SILENCE_BLOCK + 1);
+    CHECK(turns.getState() == userPlaying);
+
+    //and finishes after enough silence, which is where the phrase ended
+    uint64_t lastLoud = position;
+    blocks = 0;
+    event = noTurnEvent;
+    while(event == noTurnEvent && blocks < 100) {
+        position += SILENCE_BLOCK;
+        event = turns.addBlock(turnBlock(false),position);
+        blocks++;
+    }
+    CHECK(event == userFinished);
+    CHECK(turns.getState() == responding);
+    CHECK(turns.getPhraseEnd() == lastLoud);
+    CHECK(position - lastLoud >= SAMPLES_TILL_STOP);
+
+    //with nobody playing over the response, it goes back to waiting
+    turns.responseFinished();
+    CHECK(turns.getState() == waitingForUser);
+
+    //the user can start during the response, and has the turn as soon as it finishes
+    for(int i = 0; i < 10; i++) turns.addBlock(turnBlock(true),position += SILENCE_BLOCK);
+    for(int i = 0; i < 50; i++) turns.addBlock(turnBlock(false),position += SILENCE_BLOCK);
+    CHECK(turns.getState() == responding);
+
+    //the response coming back through the mic isn't the user, whether it's a short burst or quiet
+    CHECK(turns.loudThreshold() > NOISE_THRESHOLD);
+    for(int i = 0; i < 4; i++) {
+        CHECK(turns.addBlock(turnBlock(true,turns.loudThreshold()),position += SILENCE_BLOCK) == noTurnEvent);
+    }
+    CHECK(turns.addBlock(turnBlock(false,turns.loudThreshold()),position += SILENCE_BLOCK) == noTurnEvent);
+    for(int i = 0; i < 100; i++) {
+        CHECK(turns.addBlock(turnBlock(true,turns.loudThreshold(),0.03f),position += SILENCE_BLOCK) == noTurnEvent);
+    }
+    CHECK(turns.addBlock(turnBlock(false,turns.loudThreshold()),position += SILENCE_BLOCK) == noTurnEvent);
+
+    //but the user playing over it for long enough is
+    uint64_t userStart = position;
+    blocks = 0;
+    event = noTurnEvent;
+    while(event == noTurnEvent && blocks < 100) {
+        event = turns.addBlock(turnBlock(true,turns.loudThreshold()),position += SILENCE_BLOCK);
+        blocks++;
+    }
+    CHECK(event == userStarted);
+    CHECK(blocks > RESPONSE_START_THRESHOLD / SILENCE_BLOCK);
+    CHECK(turns.getUserStart() == userStart);
+    CHECK(turns.getState() == responding);
+    CHECK(turns.loudThreshold() == Approx(NOISE_THRESHOLD));
+
+    //their phrase can't finish while the response is still going
+    lastLoud = position;
+    for(int i = 0; i < 50; i++) {
+        CHECK(turns.addBlock(turnBlock(false),position += SILENCE_BLOCK) == noTurnEvent);
+    }
+    turns.responseFinished();
+    CHECK(turns.getState() == userPlaying);
+
+    //the silence heard during the response still counts
+    CHECK(turns.addBlock(turnBlock(false),position += SILENCE_BLOCK) == userFinished);
+    CHECK(turns.getPhraseEnd() == lastLoud);
+
+    turns.reset();
+    CHECK(turns.getState() == waitingForUser);
+    CHECK(turns.getPhraseEnd() == 0);
+}
+
+TEST_CASE("Tests throwing away what the mic picked up from the response","[timers]") {
+
+    //the response is placed in the audio from its midi
+    MatrixXd output(4,2);
+    output << 40, 0.1,
+              0, 0.05,
+              45, 0.1,
+              47, 0.2;
+    vector<responseNote> response = placeResponse(predictionToEvents(output), 1000, 44100.0);
+    REQUIRE(response.size() == 3);
+    CHECK(response.at(0).note == 40);
+    CHECK(response.at(0).start == 1000);
+    CHECK(response.at(0).end == 5410);
+    CHECK(response.at(1).note == 45);
+    CHECK(response.at(1).start == 7615);
+    CHECK(response.at(1).end == 12025);
+    CHECK(response.at(2).end == 20845);
+
+    NoteQueue queue;
+    queue.push(noteEvent(40,0.1,6000)); //the response, before the user started
+    queue.push(noteEvent(0,0.1,7000));
+    queue.push(noteEvent(52,0.1,9000)); //the user's first note
+    queue.push(noteEvent(45,0.1,13000)); //the response again, while the user plays
+    queue.push(noteEvent(40,0.1,15000)); //the user, with a note the response played earlier
+    queue.push(noteEvent(0,0.1,16000));
+    queue.push(noteEvent(53,0.3,19000));
+    queue.push(noteEvent(55,0.3,30000)); //after the response, so left for later
+
+    vector<noteEvent> phrase;
+    vector<noteEvent> dropped;
+    CHECK(dropResponseNotes(queue, 7000, 25000, response, phrase, &dropped) == 3);
+    REQUIRE(phrase.size() == 4);
+    CHECK(phrase.at(0).note == 52);
+    CHECK(phrase.at(1).note == 40);
+    CHECK(phrase.at(2).note == 0);
+    CHECK(phrase.at(3).note == 53);
+    REQUIRE(dropped.size() == 3);
+    CHECK(dropped.at(1).note == 0);
+    CHECK(dropped.at(2).note == 45);
+    CHECK(queue.size() == 1);
+
+    //if the user didn't play over the response, everything heard during it goes
+    phrase.clear();
+    queue.push(noteEvent(60,0.3,32000));
+    CHECK(dropResponseNotes(queue, 40000, 40000, response, phrase) == 2);
+    CHECK(phrase.empty());
+    CHECK(queue.size() == 0);
+}
+
+TEST_CASE("Tests detecting timestamped notes hop by hop","[noteDetector]") {
+
+    NoteQueue notes;
+    NoteDetector detector(&notes);
+    NoteMap noteMap;
+    const int hop = detector.hopSize();
+    const int noteHops = 80; //~0.46s each
+
+    //two notes then silence, a hop at a time
+    vector<int> played = {40, 47, 0};
+    vector<float> samples(hop);
+    uint64_t position = 0;
+    for(int note : played) {
+        double freq = note == 0 ? 0.0 : noteMap.frequency(note);
+        for(int h = 0; h < noteHops; h++) {
+            for(int i = 0; i < hop; i++) {
+                samples.at(i) = (float)(0.5 * sin(2.0 * M_PI * freq * (position + i) / PITCH_RATE));
+            }
+            position += hop;
+            detector.addHop(samples.data(), position);
+        }
+    }
+
+    //both notes have finished, and end about where they stopped
+    noteEvent event;
+    REQUIRE(notes.pop(event));
+    CHECK(event.note == 40);
+    CHECK(std::abs((double)event.endSample - noteHops * hop) < 16.0 * hop);
+    CHECK(event.duration > 0.3);
+    REQUIRE(notes.pop(event));
+    CHECK(event.note == 47);
+    CHECK(std::abs((double)event.endSample - 2.0 * noteHops * hop) < 16.0 * hop);
+    CHECK(!notes.pop(event)); //the silence hasn't finished yet
+
+    //the phrase is taken off the queue up to where it ended
+    NoteQueue queue;
+    queue.push(noteEvent(0,1.0,1000)); //silence before the phrase
+    queue.push(noteEvent(40,0.5,20000));
+    queue.push(noteEvent(0,0.1,25000));
+    queue.push(noteEvent(42,0.5,50000)); //the next phrase
+    queue.markHeard(60000);
+
+    //notes heard while the user plays are taken straight away, without the silence before them
+    vector<noteEvent> phrase;
+    CHECK(takePhraseNotes(queue, 20001, phrase) == 1);
+    CHECK(phrase.at(0).note == 40);
+    CHECK(queue.size() == 2);
 
+    //and the rest of the phrase is added once it has finished
+    atomic<bool> running(true);
+    CHECK(collectPhrase(queue, 25000 - PHRASE_END_GRACE, phrase, running) == 2);
+    CHECK(phrase.at(0).note == 40);
+    CHECK(phrase.at(1).note == 0);
+    CHECK(queue.size() == 1);
 }
@@ -8,6 +8,10 @@
 
 #include "../../include/test/catch.hpp"
 #include "../../include/training_lstm/readTraining.h"
+#include "../../include/lstm/lstm.h"
+#include "../../include/lstm/auxillary_functions.h"
+#include "../../include/training_lstm/errorCalculation.h"
+#include "../../include/training_lstm/lstmTraining.h"
 
 #define TRAINING_FILE "../test/training_lstm/testTraining.csv"
 
@@ -41,4 +45,225 @@ TEST_CASE("Test functionality to read in the training data file","[readTraining]
     }
 
     CHECK(duration == Approx(2.6));
-}
\ No newline at end of file
+}
+
+/**
+ * the packed gate update should give the same result as
+ * calculating each gate separately through the per-gate views
+ */
+TEST_CASE("Test the fused gate update matches the separate gates","[fusedUpdate]") {
+
+    LSTMLayer layer(3,10);
+
+    //the views should alias the packed weights, so writes go through
+    layer.theta_xf(2,1) = 0.75;
+    layer.bias_g(4) = -0.3;
+    REQUIRE(layer.theta_xf(2,1) == Approx(0.75));
+    REQUIRE(layer.bias_g(4) == Approx(-0.3));
+
+    VectorXd h = VectorXd::Zero(10);
+    VectorXd C = VectorXd::Zero(10);
+
+    for(int t = 0; t < 20; t++) {
+        VectorXd x_t(3);
+        x_t << sin(0.3 * t), cos(0.2 * t), 0.5;
+
+        //the original eight matrix-vector products
+        VectorXd i_t = applyToAll(sigmoid,(layer.theta_xi * x_t) + (layer.theta_hi * h) + layer.bias_i);
+        VectorXd f_t = applyToAll(sigmoid,(layer.theta_xf * x_t) + (layer.theta_hf * h) + layer.bias_f);
+        VectorXd o_t = applyToAll(sigmoid,(layer.theta_xo * x_t) + (layer.theta_ho * h) + layer.bias_o);
+        VectorXd g_t = applyToAll(tanh,(layer.theta_xg * x_t) + (layer.theta_hg * h) + layer.bias_g);
+        C = f_t.cwiseProduct(C) + i_t.cwiseProduct(g_t);
+        h = o_t.cwiseProduct(applyToAll(tanh,C));
+
+        VectorXd fused = layer.update(x_t);
+        for(int i = 0; i < 10; i++) {
+            CHECK(fused(i) == Approx(h(i)));
+        }
+    }
+
+    //resetting clears the state
+    layer.resetState();
+    VectorXd x_t = VectorXd::Zero(3);
+    VectorXd fromZero = layer.update(x_t);
+    VectorXd expected = applyToAll(sigmoid,layer.bias_o).cwiseProduct(
+            applyToAll(tanh,applyToAll(sigmoid,layer.bias_i).cwiseProduct(applyToAll(tanh,layer.bias_g))));
+    for(int i = 0; i < 10; i++) {
+        CHECK(fromZero(i) == Approx(expected(i)));
+    }
+}
+
+/**
+ * squared error cost used by the error tests
+ * @param gt the ground truth
+ * @param prediction the network prediction
+ * @return the squared error
+ */
+double squaredError(VectorXd gt, VectorXd prediction) {
+    return (gt - prediction).squaredNorm();
+}
+
+/**
+ * saved weights should load back into a network of the same size,
+ * and files of the wrong shape should be rejected rather than loaded
+ */
+TEST_CASE("Test saved lstm weights load back only into the right shape","[loadWeights]") {
+
+    LSTMNet saved(3,6,2,nullptr,squaredError);
+    saved.saveNetwork();
+
+    LSTMNet loaded(3,6,nullptr,squaredError,"lstmWeightMatrix_");
+    shared_ptr<LSTMLayer> a = saved.lstmLayer;
+    shared_ptr<LSTMLayer> b = loaded.lstmLayer;
+    CHECK(MatrixXd(b->theta_xi) == MatrixXd(a->theta_xi));
+    CHECK(MatrixXd(b->theta_xg) == MatrixXd(a->theta_xg));
+    CHECK(MatrixXd(b->theta_hf) == MatrixXd(a->theta_hf));
+    CHECK(MatrixXd(b->theta_ho) == MatrixXd(a->theta_ho));
+    CHECK(VectorXd(b->bias_i) == VectorXd(a->bias_i));
+    CHECK(VectorXd(b->bias_g) == VectorXd(a->bias_g));
+
+    REQUIRE_THROWS(LSTMNet(4,6,nullptr,squaredError,"lstmWeightMatrix_")); //wrong input size
+    REQUIRE_THROWS(LSTMNet(3,5,nullptr,squaredError,"lstmWeightMatrix_")); //wrong hidden size
+
+    for(const string &name : {"theta_xi","theta_xf","theta_xo","theta_xg","bias_i","bias_f","bias_o","bias_g",
+                              "theta_hi","theta_hf","theta_ho","theta_hg","outputWeights"}) {
+        remove(("lstmWeightMatrix_" + name + ".csv").c_str());
+        remove(("lstmWeightMatrix_" + name + ".wgt").c_str());
+    }
+}
+
+/**
+ * the batched, threaded error should match the sequential error
+ * including when the samples have very different lengths
+ */
+TEST_CASE("Test batched error calculation matches the sequential version","[getErrorBatched]") {
+
+    shared_ptr<LSTMNet> lstm = std::make_shared<LSTMNet>(2,16,2,nullptr,squaredError);
+
+    //ragged samples, including ones too short to predict anything
+    training_set_t samples;
+    for(int i = 0; i < 23; i++) {
+        vector<VectorXd> sample;
+        int length = (i * 7) % 13;
+        for(int j = 0; j < length; j++) {
+            VectorXd note(2);
+            note << compressNote(60 + (i + j) % 12), 0.1 * ((i * j) % 5);
+            sample.push_back(note);
+        }
+        samples.push_back(sample);
+    }
+
+    double expected = getError(lstm,samples);
+    REQUIRE(expected > 0.0);
+
+    for(unsigned int batchSize : {1u, 4u, 32u}) {
+        for(unsigned int threads : {1u, 3u, 0u}) {
+            double batched = getErrorBatched(lstm,samples,batchSize,threads);
+            CHECK(batched == Approx(expected));
+        }
+    }
+
+    //the training set from file should work too
+    training_set_t fromFile = readTrainingSet(TRAINING_FILE);
+    CHECK(getErrorBatched(lstm,fromFile) == Approx(getError(lstm,fromFile)));
+
+    //an empty set has no error either way
+    CHECK(getError(lstm,training_set_t()) == 0.0);
+    CHECK(getErrorBatched(lstm,training_set_t()) == 0.0);
+}
+
+/**
+ * makes a small ragged set of samples for the training tests
+ * @param numSamples the number of samples
+ * @return the samples
+ */
+training_set_t makeRaggedSamples(int numSamples) {
+    training_set_t samples;
+    for(int i = 0; i < numSamples; i++) {
+        vector<VectorXd> sample;
+        int length = 3 + (i * 5) % 7;
+        for(int j = 0; j < length; j++) {
+            VectorXd note(2);
+            note << compressNote(60 + ((i + 2 * j) % 12)), 0.25 * (1 + (j % 3));
+            sample.push_back(note);
+        }
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+/**
+ * the back propagated gradients should match finite differences
+ */
+TEST_CASE("Test lstm gradients against finite differences","[gradients]") {
+
+    shared_ptr<LSTMNet> lstm = std::make_shared<LSTMNet>(2,5,2,nullptr,squaredErrorCost);
+    training_set_t samples = makeRaggedSamples(4);
+    vector<unsigned int> batch = {0,1,2,3};
+
+    trainingConfig config;
+    config.numThreads = 2;
+    config.bpttSteps = 100; //no truncation, so the gradient is exact
+    LSTMTrainer trainer(lstm,config);
+
+    lstmGradients grads(2,5,2);
+    trainer.computeGradients(samples,batch,grads);
+    lstmGradients scratch(2,5,2);
+
+    double epsilon = 1e-6;
+
+    //checks one parameter, through a reference to it
+    auto check = [&](double &param, double analytic) {
+        double original = param;
+        param = original + epsilon;
+        double up = trainer.computeGradients(samples,batch,scratch);
+        param = original - epsilon;
+        double down = trainer.computeGradients(samples,batch,scratch);
+        param = original;
+        CHECK(analytic == Approx((up - down) / (2 * epsilon)).epsilon(1e-4).margin(1e-8));
+    };
+
+    for(int r = 0; r < 5; r++) {
+        check(lstm->lstmLayer->theta_xi(r,0), grads.theta_x(r,0));
+        check(lstm->lstmLayer->theta_xf(r,1), grads.theta_x(5 + r,1));
+        check(lstm->lstmLayer->theta_ho(r,2), grads.theta_h(10 + r,2));
+        check(lstm->lstmLayer->theta_hg(r,4), grads.theta_h(15 + r,4));
+        check(lstm->lstmLayer->bias_f(r), grads.bias(5 + r));
+        check(lstm->lstmLayer->bias_g(r), grads.bias(15 + r));
+        check(lstm->outputWeights(1,r), grads.outputWeights(1,r));
+    }
+
+    //threads only change how the work is split
+    config.numThreads = 1;
+    LSTMTrainer singleThread(lstm,config);
+    lstmGradients singleGrads(2,5,2);
+    singleThread.computeGradients(samples,batch,singleGrads);
+    REQUIRE(singleGrads.theta_h.isApprox(grads.theta_h));
+    REQUIRE(singleGrads.outputWeights.isApprox(grads.outputWeights));
+}
+
+/**
+ * training with truncated bptt should bring the error down
+ */
+TEST_CASE("Test lstm training reduces the error","[training]") {
+
+    shared_ptr<LSTMNet> lstm = std::make_shared<LSTMNet>(2,8,2,nullptr,squaredErrorCost);
+    training_set_t samples = makeRaggedSamples(12);
+
+    trainingConfig config;
+    config.numThreads = 3;
+    config.bpttSteps = 3;
+    config.minibatchSize = 4;
+    config.learningRate = 0.01;
+    LSTMTrainer trainer(lstm,config);
+
+    double before = getError(lstm,samples);
+
+    RngStream gen(42);
+    for(int epoch = 0; epoch < 40; epoch++) {
+        trainer.trainEpoch(samples,gen);
+    }
+
+    double after = getError(lstm,samples);
+    CHECK(after < 0.5 * before);
+}
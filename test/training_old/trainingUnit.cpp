@@ -262,6 +262,27 @@ TEST_CASE("Tests formTrainingSet works correctly","[formTrainingSet]") {
     REQUIRE(allFound);
 }
 
+/**
+ * the batched training set formation should produce the same
+ * reservoir states as reading each file on its own, in the order of the training file
+ */
+TEST_CASE("Tests formTrainingSetBatched matches reading each file on its own","[formTrainingSetBatched]") {
+
+    shared_ptr<ESN> echo = std::make_shared<ESN>(1.0,0.9,0.4,200,13,1,8,nullptr,nullptr);
+
+    shared_ptr<training_set_t> batchedSet = formTrainingSetBatched(echo,TRAINING_SAMPLE,10,3); //uneven batches
+    vector<pair<string,VectorXd>> namesAndTruth = readTrainingFile(TRAINING_SAMPLE,(echo->resOutWeights).rows());
+
+    REQUIRE(batchedSet->size() == namesAndTruth.size());
+
+    //the batched set keeps the order of the training file, so each sample is checked against its own file
+    for(unsigned long i = 0; i < namesAndTruth.size(); i++) {
+        VectorXd expected = wavToEcho(*echo,namesAndTruth.at(i).first,10);
+        CHECK(batchedSet->at(i).first.isApprox(expected));
+        CHECK(batchedSet->at(i).second.isApprox(namesAndTruth.at(i).second));
+    }
+}
+
 /**
  * this test case covers the testing of the interval cost function to test things are correct
  */
@@ -349,7 +370,7 @@ TEST_CASE("Tests simulated annealing functions","[simulatedAnnealing]") {
 
 
     //test neighbourhood generation function
-    std::default_random_engine generator;
+    RngStream generator(0);
     std::uniform_real_distribution<double> distribution(-SIGMA,SIGMA);
 
     MatrixXd initMat = MatrixXd::Random(8,200);
@@ -0,0 +1,187 @@
+/**
+ * file tests the csv and binary weight file formats
+ * Author: Charlie Street
+ */
+
+#define CATCH_CONFIG_MAIN
+
+#include "../../include/test/catch.hpp"
+#include "../../include/weights/weightFile.h"
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+/**
+ * a matrix written in either format should read back unchanged
+ */
+TEST_CASE("Tests weight matrices survive a round trip", "[roundTrip]") {
+    MatrixXd weights = MatrixXd::Random(7,13);
+    weights(0,0) = 1e-300; //values which need all the precision
+    weights(6,12) = -123456.789012345;
+
+    REQUIRE(writeWeightFile("weightTest.wgt",weights));
+    REQUIRE(isWeightFile("weightTest.wgt"));
+    REQUIRE(readWeightFile("weightTest.wgt") == weights); //binary is exact
+
+    MappedWeightFile mapped("weightTest.wgt");
+    REQUIRE(mapped.matrix() == weights);
+
+    REQUIRE(writeCsvMatrix("weightTest.csv",weights));
+    REQUIRE(!isWeightFile("weightTest.csv"));
+    MatrixXd fromCsv = readCsvMatrix("weightTest.csv");
+    REQUIRE(fromCsv.rows() == 7);
+    REQUIRE(fromCsv.cols() == 13);
+    REQUIRE(fromCsv == weights); //max_digits10 reads back exactly
+
+    //vectors are stored as a single column
+    VectorXd bias = VectorXd::Random(5);
+    REQUIRE(writeWeightFile("weightTestBias.wgt",bias));
+    MatrixXd readBias = readWeightFile("weightTestBias.wgt");
+    REQUIRE(readBias.rows() == 5);
+    REQUIRE(readBias.cols() == 1);
+    REQUIRE(readBias == bias);
+
+    remove("weightTest.wgt");
+    remove("weightTest.csv");
+    remove("weightTestBias.wgt");
+}
+
+/**
+ * the original csv files end every row with a trailing comma
+ */
+TEST_CASE("Tests the existing csv layout can be read", "[csv]") {
+    ofstream csvFile("weightTestLayout.csv");
+    csvFile << "0.732582,0.205859,0.22065,\n";
+    csvFile << "0.154381,-0.683609,1e-05,\r\n"; //windows line ending
+    csvFile.close();
+
+    MatrixXd mat = readCsvMatrix("weightTestLayout.csv");
+    REQUIRE(mat.rows() == 2);
+    REQUIRE(mat.cols() == 3);
+    CHECK(mat(0,0) == Approx(0.732582));
+    CHECK(mat(1,1) == Approx(-0.683609));
+    CHECK(mat(1,2) == Approx(1e-05));
+
+    //rows of different lengths are rejected
+    csvFile.open("weightTestLayout.csv");
+    csvFile << "1,2,3,\n4,5,\n";
+    csvFile.close();
+
+    REQUIRE_THROWS(readCsvMatrix("weightTestLayout.csv"));
+
+    //infinities and nans survive, but trailing rubbish in a value doesn't
+    csvFile.open("weightTestLayout.csv");
+    csvFile << "inf,-inf,nan,\n";
+    csvFile.close();
+    MatrixXd special = readCsvMatrix("weightTestLayout.csv");
+    CHECK(special(0,0) == numeric_limits<double>::infinity());
+    CHECK(special(0,1) == -numeric_limits<double>::infinity());
+    CHECK(special(0,2) != special(0,2));
+
+    csvFile.open("weightTestLayout.csv");
+    csvFile << "1.5x,2,\n";
+    csvFile.close();
+    REQUIRE_THROWS(readCsvMatrix("weightTestLayout.csv"));
+
+    remove("weightTestLayout.csv");
+}
+
+/**
+ * saving writes both formats, and loading prefers an up to date binary twin
+ */
+TEST_CASE("Tests loading picks the right format", "[load]") {
+    REQUIRE(binaryTwinPath("matrices/NNote.csv") == "matrices/NNote.wgt");
+    REQUIRE(binaryTwinPath("matrices/NNote.wgt") == "matrices/NNote.wgt");
+    REQUIRE(binaryTwinPath("NNote") == "NNote.wgt");
+
+    MatrixXd weights = MatrixXd::Random(4,6);
+    REQUIRE(saveWeightMatrix("weightTestLoad.csv",weights));
+    REQUIRE(isWeightFile("weightTestLoad.wgt"));
+
+    //the twin is exact, so this only holds if it was used
+    REQUIRE(loadWeightMatrix("weightTestLoad.csv") == weights);
+    REQUIRE(loadWeightMatrix("weightTestLoad.wgt") == weights);
+
+    //it can also go straight into part of a larger matrix, but only one of the same shape
+    MatrixXd packed = MatrixXd::Zero(8,6);
+    loadWeightMatrix("weightTestLoad.csv",packed.block(2,0,4,6));
+    REQUIRE(packed.block(2,0,4,6) == weights);
+    REQUIRE(packed.topRows(2).isZero());
+    REQUIRE_THROWS(loadWeightMatrix("weightTestLoad.csv",packed.block(0,0,4,5)));
+
+    //a csv changed after its twin was made is parsed instead
+    //(the change of size is enough, even if it lands on the same tick of the clock)
+    MatrixXd changed = MatrixXd::Random(4,7);
+    REQUIRE(writeCsvMatrix("weightTestLoad.csv",changed));
+    REQUIRE(loadWeightMatrix("weightTestLoad.csv") == changed);
+
+    //a twin written without a source is never taken for the csv's
+    REQUIRE(writeWeightFile("weightTestLoad.wgt",weights));
+    REQUIRE(loadWeightMatrix("weightTestLoad.csv") == changed);
+
+    //with no twin the csv is parsed
+    remove("weightTestLoad.wgt");
+    REQUIRE(loadWeightMatrix("weightTestLoad.csv") == changed);
+
+    remove("weightTestLoad.csv");
+}
+
+/**
+ * corrupted or foreign files should be caught rather than loaded
+ */
+TEST_CASE("Tests damaged weight files are rejected", "[checksum]") {
+    MatrixXd weights = MatrixXd::Random(3,3);
+    REQUIRE(writeWeightFile("weightTestBad.wgt",weights));
+
+    //flip a byte in the data section
+    fstream binFile("weightTestBad.wgt", ios::in | ios::out | ios::binary);
+    binFile.seekp(sizeof(weightFileHeader) + 5);
+    binFile.put(0x5A);
+    binFile.close();
+
+    REQUIRE_THROWS(readWeightFile("weightTestBad.wgt"));
+    REQUIRE_THROWS(MappedWeightFile("weightTestBad.wgt"));
+
+    remove("weightTestBad.wgt");
+}
+
+/**
+ * a file written on a machine with the opposite byte order can still be copied in
+ */
+TEST_CASE("Tests foreign byte order files are swapped", "[endian]") {
+    MatrixXd weights = MatrixXd::Random(2,3);
+
+    //byte swap the data by hand, as a foreign machine would have stored it
+    MatrixXd swappedData = weights;
+    auto *dataBytes = (unsigned char*)swappedData.data();
+    for(long i = 0; i < swappedData.size(); i++) {
+        reverse(dataBytes + i * sizeof(double),dataBytes + (i + 1) * sizeof(double));
+    }
+
+    //writing the swapped data natively gives the right data section and checksum
+    REQUIRE(writeWeightFile("weightTestEndian.wgt",swappedData));
+
+    //then swap every header field after the magic
+    fstream binFile("weightTestEndian.wgt", ios::in | ios::out | ios::binary);
+    unsigned char header[sizeof(weightFileHeader)];
+    binFile.read((char*)header,sizeof(header));
+    reverse(header + 4,header + 8); //endian tag
+    reverse(header + 8,header + 10); //version
+    reverse(header + 10,header + 12); //dtype
+    reverse(header + 12,header + 16); //rows
+    reverse(header + 16,header + 20); //cols
+    reverse(header + 20,header + 24); //checksum
+    reverse(header + 24,header + 28); //source size
+    reverse(header + 28,header + 32); //source stamp
+    binFile.seekp(0);
+    binFile.write((const char*)header,sizeof(header));
+    binFile.close();
+
+    REQUIRE(readWeightFile("weightTestEndian.wgt") == weights);
+
+    //the mapped view can't swap, so it refuses
+    REQUIRE_THROWS(MappedWeightFile("weightTestEndian.wgt"));
+
+    remove("weightTestEndian.wgt");
+}
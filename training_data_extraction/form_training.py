@@ -33,22 +33,25 @@ def centOffset(freq1,freq2):
 
 # for a given frequency, find the closest note to it
 # using lists of frequencies and corresponding notes
+# this follows the same rule as NoteMap in the runtime:
+# halfway between two notes goes to the lower one, and anything
+# outside the range is moved in by whole octaves
+# 0 (silence) is returned if freq isn't positive
 def findClosestNote(freq,freqList,noteList):
 
-	if (freq <= freqList[0]): # if note smaller than our range
-		return noteList[0]
-	elif (freq >= freqList[len(freqList)-1]): # if note larger than our range
-		return noteList[len(noteList)-1]
-	else:
-		for i in range(0,len(freqList)-1): # only want up to the penultimate item
-			if (freq >= freqList[i] and freq < freqList[i+1]):
-				# calculate offsets
-				leftOffset = abs(centOffset(freq,freqList[i]))
-				rightOffset = abs(centOffset(freq,freqList[i+1]))
-				if (leftOffset <= rightOffset):
-					return noteList[i]
-				else:
-					return noteList[i+1]
+	if (not freq > 0.0 or math.isinf(freq)): # also catches nan
+		return 0
+
+	semitones = noteList[0] + 12 * math.log(freq/freqList[0], 2.0)
+	note = int(math.ceil(semitones - 0.5)) # halfway between goes to the lower note
+
+	# move into range by whole octaves
+	if (note < noteList[0]):
+		note += 12 * ((noteList[0] - note + 11) // 12)
+	elif (note > noteList[len(noteList)-1]):
+		note -= 12 * ((note - noteList[len(noteList)-1] + 11) // 12)
+
+	return note
 
 
 # takes the wav file at filePath and segments it based on silences that appear within it